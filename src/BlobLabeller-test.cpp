@@ -0,0 +1,313 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Checks that BlobLabeller labels synthetic spoke planes as documented: the area, bounding box,
+ * centroid and seed of a blob, runs that are united into one blob, a blob across north, gaps and
+ * steps back in the spokes, and running out of blobs. Then times the labelling of random echoes
+ * at 2048 spokes of 1024 samples.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+
+#include "BlobLabeller.h"
+
+using namespace std;
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define TEST_SPOKES (64)
+#define TEST_LEN (4096)
+#define TEST_WORDS (HISTORY_WORDS(TEST_LEN))
+#define TEST_MIN_AREA (2)
+
+// Echoes from spoke first_angle to last_angle and from first_r to last_r, all included. The
+// spokes are counted on like the sweep, so last_angle may be beyond TEST_SPOKES.
+struct Rect {
+  int first_angle;
+  int last_angle;
+  int first_r;
+  int last_r;
+};
+
+// Feeds the spokes from..to (counted on, both included) with the echoes of the rectangles
+static void ProcessSpokes(BlobLabeller *labeller, const Rect *rects, int n, int from, int to, int min_area) {
+  HistoryWord plane[TEST_WORDS];
+
+  for (int s = from; s <= to; s++) {
+    memset(plane, 0, sizeof(plane));
+    for (int i = 0; i < n; i++) {
+      if (s >= rects[i].first_angle && s <= rects[i].last_angle) {
+        HistorySet(plane, rects[i].first_r, rects[i].last_r);
+      }
+    }
+    labeller->ProcessSpoke(s % TEST_SPOKES, plane, TEST_LEN, wxLongLong(s), min_area);
+  }
+}
+
+static int CountListed(BlobLabeller *labeller, int bearing) {
+  int count = 0;
+
+  for (int b = labeller->GetFirstDone(bearing); b != BLOB_NONE; b = labeller->GetBlob(b)->next) {
+    count++;
+  }
+  return count;
+}
+
+static int CountAllListed(BlobLabeller *labeller) {
+  int count = 0;
+
+  for (int s = 0; s < TEST_SPOKES; s++) {
+    count += CountListed(labeller, s);
+  }
+  return count;
+}
+
+struct Expected {
+  int min_angle;
+  int max_angle;
+  int min_r;
+  int max_r;
+  int area;
+  int centroid_angle;
+  int centroid_r;
+  int seed_angle;
+  int seed_r;
+};
+
+// Checks that the blob listed at bearing is the only one listed there, that total blobs are
+// listed in all, and that the blob has the expected fields
+static int CheckBlob(const char *name, BlobLabeller *labeller, int bearing, int total, const Expected &expected) {
+  int n = labeller->GetFirstDone(bearing);
+
+  if (n == BLOB_NONE || CountListed(labeller, bearing) != 1 || CountAllListed(labeller) != total) {
+    cout << "ERROR: " << name << " lists " << CountListed(labeller, bearing) << " blobs at " << bearing << " and "
+         << CountAllListed(labeller) << " in all, expected 1 and " << total << "\n";
+    return 1;
+  }
+  const Blob *blob = labeller->GetBlob(n);
+  if (blob->min_angle != expected.min_angle || blob->max_angle != expected.max_angle || blob->min_r != expected.min_r ||
+      blob->max_r != expected.max_r) {
+    cout << "ERROR: " << name << " box " << blob->min_angle << ".." << blob->max_angle << " x " << blob->min_r << ".."
+         << blob->max_r << ", expected " << expected.min_angle << ".." << expected.max_angle << " x " << expected.min_r << ".."
+         << expected.max_r << "\n";
+    return 1;
+  }
+  if (blob->area != expected.area || blob->CentroidAngle() != expected.centroid_angle ||
+      blob->CentroidR() != expected.centroid_r) {
+    cout << "ERROR: " << name << " area " << blob->area << " centroid " << blob->CentroidAngle() << "," << blob->CentroidR()
+         << ", expected " << expected.area << " and " << expected.centroid_angle << "," << expected.centroid_r << "\n";
+    return 1;
+  }
+  if (blob->seed_angle != expected.seed_angle || blob->seed_r != expected.seed_r) {
+    cout << "ERROR: " << name << " seed " << blob->seed_angle << "," << blob->seed_r << ", expected " << expected.seed_angle
+         << "," << expected.seed_r << "\n";
+    return 1;
+  }
+  if (blob->time != wxLongLong(expected.max_angle)) {
+    cout << "ERROR: " << name << " has the time of the wrong spoke\n";
+    return 1;
+  }
+  return 0;
+}
+
+static int CheckRectangle(BlobLabeller *labeller) {
+  // A single sample is below the minimum area and is not listed
+  Rect rects[] = {{10, 14, 20, 22}, {10, 10, 40, 40}};
+
+  labeller->Clear();
+  ProcessSpokes(labeller, rects, 2, 8, 17, TEST_MIN_AREA);
+  // 3 samples on 5 spokes, done at the first spoke without echoes
+  return CheckBlob("rectangle", labeller, 15, 1, Expected{10, 14, 20, 22, 15, 12, 21, 10, 20});
+}
+
+// A U that opens to lower spokes: the two arms start as separate blobs and are united by the run
+// of the base. The right arm starts four spokes earlier, so its seed remains.
+static int CheckU(BlobLabeller *labeller, int offset) {
+  Rect rects[] = {{offset + 10, offset + 14, 20, 22}, {offset + 6, offset + 14, 30, 32}, {offset + 15, offset + 15, 20, 32}};
+  int first = (offset + 6) % TEST_SPOKES;
+  char name[32];
+
+  labeller->Clear();
+  ProcessSpokes(labeller, rects, 3, offset + 4, offset + 18, TEST_MIN_AREA);
+  snprintf(name, sizeof(name), "U at spoke %d", first);
+  // Area 15 + 27 + 13. The angles of the samples, counted from the first spoke, add up to
+  // 90 + 108 + 117 and their ranges to 315 + 837 + 338.
+  return CheckBlob(name, labeller, (offset + 16) % TEST_SPOKES, 1,
+                   Expected{first, first + 9, 20, 32, 55, first + 315 / 55, 1490 / 55, first, 30});
+}
+
+static int CheckNorth(BlobLabeller *labeller) {
+  Rect rects[] = {{62, 65, 100, 101}};
+
+  labeller->Clear();
+  ProcessSpokes(labeller, rects, 1, 60, 67, TEST_MIN_AREA);
+  // The spokes are counted on across north, so max_angle and the centroid are beyond TEST_SPOKES
+  return CheckBlob("north", labeller, 2, 1, Expected{62, 65, 100, 101, 8, 63, 100, 62, 100});
+}
+
+static int CheckGap(BlobLabeller *labeller) {
+  Rect rects[] = {{20, 25, 40, 45}};
+  int ret = 0;
+
+  labeller->Clear();
+  // Spoke 22 is missing, so the part before it is done at the last spoke before the gap
+  ProcessSpokes(labeller, rects, 1, 18, 21, TEST_MIN_AREA);
+  ProcessSpokes(labeller, rects, 1, 23, 27, TEST_MIN_AREA);
+  ret |= CheckBlob("before the gap", labeller, 21, 2, Expected{20, 21, 40, 45, 12, 20, 42, 20, 40});
+  ret |= CheckBlob("after the gap", labeller, 26, 2, Expected{23, 25, 40, 45, 18, 24, 42, 23, 40});
+  return ret;
+}
+
+static int CheckStepBack(BlobLabeller *labeller) {
+  Rect rects[] = {{30, 33, 50, 52}};
+  int ret = 0;
+
+  labeller->Clear();
+  // The heading changes after spoke 32, and spoke 31 comes again
+  ProcessSpokes(labeller, rects, 1, 28, 32, TEST_MIN_AREA);
+  ProcessSpokes(labeller, rects, 1, 31, 31, TEST_MIN_AREA);
+  ret |= CheckBlob("before the step back", labeller, 32, 1, Expected{30, 32, 50, 52, 9, 31, 51, 30, 50});
+  // When the sweep passes spoke 32 again the blob listed there is replaced
+  ProcessSpokes(labeller, rects, 1, 32, 35, TEST_MIN_AREA);
+  ret |= CheckBlob("after the step back", labeller, 34, 1, Expected{31, 33, 50, 52, 9, 32, 51, 31, 50});
+  return ret;
+}
+
+// Single samples every 4 samples, shifted by 2 on odd spokes so that no two touch. Every spoke
+// has TEST_LEN / 4 blobs, so the blobs run out halfway the sweep.
+static void ProcessDots(BlobLabeller *labeller, int from, int to) {
+  HistoryWord plane[TEST_WORDS];
+
+  for (int s = from; s <= to; s++) {
+    memset(plane, 0, sizeof(plane));
+    for (int r = 1 + (s % 2) * 2; r < TEST_LEN; r += 4) {
+      HistorySet(plane, r, r);
+    }
+    labeller->ProcessSpoke(s % TEST_SPOKES, plane, TEST_LEN, wxLongLong(s), 1);
+  }
+}
+
+static int CheckExhausted(BlobLabeller *labeller) {
+  int per_spoke = TEST_LEN / 4;
+  int full = BLOB_MAX / per_spoke;
+
+  labeller->Clear();
+  ProcessDots(labeller, 0, TEST_SPOKES);
+  // The blobs of the first spokes are listed, the runs after that are not labelled
+  if (CountAllListed(labeller) != BLOB_MAX || CountListed(labeller, full) != per_spoke ||
+      CountListed(labeller, full + 1) != 0) {
+    cout << "ERROR: out of blobs lists " << CountAllListed(labeller) << " blobs, expected " << BLOB_MAX << "\n";
+    return 1;
+  }
+  // The next sweep releases the blobs listed at the spokes it passes, and labels again
+  ProcessDots(labeller, TEST_SPOKES + 1, TEST_SPOKES + 2);
+  if (CountAllListed(labeller) != BLOB_MAX - per_spoke || CountListed(labeller, 1) != 0 ||
+      CountListed(labeller, 2) != per_spoke) {
+    cout << "ERROR: out of blobs does not label again in the next sweep\n";
+    return 1;
+  }
+  labeller->Clear();
+  if (CountAllListed(labeller) != 0) {
+    cout << "ERROR: Clear leaves blobs listed\n";
+    return 1;
+  }
+  cout << "INFO: out of blobs after " << full << " spokes of " << per_spoke << " blobs\n";
+  return 0;
+}
+
+static void Time() {
+  const int spokes = 2048;
+  const int len = 1024;
+  const int revolutions = 10;
+  BlobLabeller labeller(spokes, len);
+  HistoryWord *planes = (HistoryWord *)calloc(spokes * HISTORY_WORDS(len), sizeof(HistoryWord));
+  uint32_t seed = 12345;
+
+  if (!planes || !labeller.IsAllocated()) {
+    cout << "ERROR: BlobLabeller out of memory\n";
+    free(planes);
+    return;
+  }
+  // Random echoes of a few samples, about one in eight samples set
+  for (int s = 0; s < spokes; s++) {
+    for (int r = 1; r < len; r++) {
+      seed = seed * 1664525 + 1013904223;
+      if ((seed >> 24) < 16) {
+        HistorySet(planes + s * HISTORY_WORDS(len), r, wxMin(r + 3, len - 1));
+      }
+    }
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int revolution = 0; revolution < revolutions; revolution++) {
+    for (int s = 0; s < spokes; s++) {
+      labeller.ProcessSpoke(s, planes + s * HISTORY_WORDS(len), len, wxLongLong(s), TEST_MIN_AREA);
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  free(planes);
+
+  cout << "INFO: " << std::chrono::duration<double, std::nano>(end - start).count() / ((double)spokes * revolutions)
+       << " ns/spoke\n";
+}
+
+int main() {
+  int ret = 0;
+  BlobLabeller labeller(TEST_SPOKES, TEST_LEN);
+
+  if (!labeller.IsAllocated()) {
+    cout << "ERROR: BlobLabeller out of memory\n";
+    exit(1);
+  }
+  ret |= CheckRectangle(&labeller);
+  ret |= CheckU(&labeller, 0);
+  ret |= CheckU(&labeller, TEST_SPOKES - 12);  // the arms start before north and the base is after it
+  ret |= CheckNorth(&labeller);
+  ret |= CheckGap(&labeller);
+  ret |= CheckStepBack(&labeller);
+  ret |= CheckExhausted(&labeller);
+  Time();
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { RadarPlugin::main(); }
@@ -0,0 +1,282 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "BlobLabeller.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+BlobLabeller::BlobLabeller(size_t spokes, size_t spoke_len) {
+  m_spokes = spokes;
+  m_spoke_len = spoke_len;
+  m_blobs = (Blob *)malloc(sizeof(Blob) * BLOB_MAX);
+  m_done = (int *)malloc(sizeof(int) * spokes);
+  // A spoke has at most one run for every two samples
+  m_runs[0] = (Run *)malloc(sizeof(Run) * (spoke_len / 2 + 1));
+  m_runs[1] = (Run *)malloc(sizeof(Run) * (spoke_len / 2 + 1));
+  if (IsAllocated()) {
+    Clear();
+  }
+}
+
+BlobLabeller::~BlobLabeller() {
+  free(m_blobs);
+  free(m_done);
+  free(m_runs[0]);
+  free(m_runs[1]);
+}
+
+void BlobLabeller::Clear() {
+  for (int b = 0; b < BLOB_MAX; b++) {
+    m_blobs[b].next = b + 1;
+  }
+  m_blobs[BLOB_MAX - 1].next = BLOB_NONE;
+  m_free = 0;
+  for (size_t s = 0; s < m_spokes; s++) {
+    m_done[s] = BLOB_NONE;
+  }
+  m_merged = BLOB_NONE;
+  m_run_count[0] = 0;
+  m_run_count[1] = 0;
+  m_previous = 0;
+  m_last_bearing = -1;
+  m_count = 0;
+}
+
+void BlobLabeller::ProcessSpoke(int bearing, const HistoryWord *echo, size_t len, wxLongLong time, int min_area) {
+  bool adjacent = false;
+
+  if (m_last_bearing < 0) {
+    ReleaseDone(bearing);
+  } else {
+    int step = (bearing - m_last_bearing + (int)m_spokes) % (int)m_spokes;
+
+    if (step > 0 && step <= (int)m_spokes / 2) {
+      // The blobs of the last sweep at the spokes that the sweep passes are replaced
+      for (int s = 1; s <= step; s++) {
+        ReleaseDone((m_last_bearing + s) % m_spokes);
+      }
+      m_count += step;
+      adjacent = step == 1;
+    } else if (step > 0) {
+      m_count -= m_spokes - step;  // a step back, as when the heading changes
+    }
+    if (!adjacent) {
+      FinishRuns(m_last_bearing, min_area);  // nothing continues across a gap
+    }
+  }
+  m_last_bearing = bearing;
+
+  int current = 1 - m_previous;
+  Run *runs = m_runs[current];
+  Run *previous = m_runs[m_previous];
+  int previous_count = adjacent ? m_run_count[m_previous] : 0;
+  int count = 0;
+  int length = len < m_spoke_len ? (int)len : (int)m_spoke_len;
+  int p = 0;
+
+  // Sample 0 is never part of a target, see Pix()
+  for (int start = HistoryFind(echo, 1, length); start < length;) {
+    int end = HistoryFindClear(echo, start, length) - 1;
+    int blob = BLOB_NONE;
+
+    // Join the blobs of all runs of the previous spoke that this run touches
+    while (p < previous_count && previous[p].end < start) {
+      p++;
+    }
+    for (int k = p; k < previous_count && previous[k].start <= end; k++) {
+      if (previous[k].blob != BLOB_NONE) {
+        int root = Find(previous[k].blob);
+        blob = blob == BLOB_NONE || blob == root ? root : Unite(blob, root);
+      }
+    }
+    if (blob == BLOB_NONE) {
+      blob = NewBlob(bearing, start);
+    }
+    if (blob != BLOB_NONE) {
+      AddRun(blob, start, end, time);
+    }
+    runs[count].start = start;
+    runs[count].end = end;
+    runs[count].blob = blob;
+    count++;
+    start = HistoryFind(echo, end + 1, length);
+  }
+
+  for (int k = 0; k < count; k++) {
+    if (runs[k].blob != BLOB_NONE) {
+      runs[k].blob = Find(runs[k].blob);
+    }
+  }
+  // A blob of the previous spoke that no run of this spoke touched is done
+  for (int k = 0; k < previous_count; k++) {
+    if (previous[k].blob != BLOB_NONE) {
+      int root = Find(previous[k].blob);
+      if (!m_blobs[root].done && m_blobs[root].last != m_count) {
+        Done(root, bearing, min_area);
+      }
+    }
+  }
+  // No run refers to the blobs that were united into others any more
+  while (m_merged != BLOB_NONE) {
+    int next = m_blobs[m_merged].next;
+    Release(m_merged);
+    m_merged = next;
+  }
+
+  m_run_count[current] = count;
+  m_previous = current;
+}
+
+int BlobLabeller::NewBlob(int bearing, int start) {
+  int n = m_free;
+
+  if (n == BLOB_NONE) {
+    return BLOB_NONE;  // all in use, the run is not labelled
+  }
+  Blob *blob = &m_blobs[n];
+  m_free = blob->next;
+  blob->min_angle = bearing;
+  blob->max_angle = bearing;
+  blob->min_r = start;
+  blob->max_r = start;
+  blob->area = 0;
+  blob->seed_angle = bearing;
+  blob->seed_r = start;
+  blob->sum_angle = 0;
+  blob->sum_r = 0;
+  blob->first = m_count;
+  blob->last = m_count;
+  blob->parent = n;
+  blob->next = BLOB_NONE;
+  blob->done = false;
+  return n;
+}
+
+void BlobLabeller::AddRun(int n, int start, int end, wxLongLong time) {
+  Blob *blob = &m_blobs[n];
+  int samples = end - start + 1;
+
+  blob->area += samples;
+  blob->sum_angle += (int64_t)(m_count - blob->first) * samples;
+  blob->sum_r += (int64_t)(start + end) * samples / 2;
+  if (start < blob->min_r) {
+    blob->min_r = start;
+  }
+  if (end > blob->max_r) {
+    blob->max_r = end;
+  }
+  blob->last = m_count;
+  blob->max_angle = blob->min_angle + (int)(blob->last - blob->first);
+  blob->time = time;
+}
+
+int BlobLabeller::Find(int n) {
+  while (m_blobs[n].parent != n) {
+    m_blobs[n].parent = m_blobs[m_blobs[n].parent].parent;  // path halving
+    n = m_blobs[n].parent;
+  }
+  return n;
+}
+
+// Unites two root blobs. The one that started first remains, so that its seed stays on the contour.
+int BlobLabeller::Unite(int a, int b) {
+  if ((int32_t)(m_blobs[b].first - m_blobs[a].first) < 0) {
+    int swap = a;
+    a = b;
+    b = swap;
+  }
+  Blob *root = &m_blobs[a];
+  Blob *child = &m_blobs[b];
+
+  root->area += child->area;
+  root->sum_angle += child->sum_angle + (int64_t)(child->first - root->first) * child->area;
+  root->sum_r += child->sum_r;
+  if (child->min_r < root->min_r) {
+    root->min_r = child->min_r;
+  }
+  if (child->max_r > root->max_r) {
+    root->max_r = child->max_r;
+  }
+  if ((int32_t)(child->last - root->last) > 0) {
+    root->last = child->last;
+    root->time = child->time;
+  }
+  root->max_angle = root->min_angle + (int)(root->last - root->first);
+
+  child->parent = a;
+  child->next = m_merged;
+  m_merged = b;
+  return a;
+}
+
+void BlobLabeller::Done(int n, int bearing, int min_area) {
+  Blob *blob = &m_blobs[n];
+
+  blob->done = true;
+  if (blob->area < min_area) {
+    Release(n);
+    return;
+  }
+  blob->next = m_done[bearing];
+  m_done[bearing] = n;
+}
+
+void BlobLabeller::FinishRuns(int bearing, int min_area) {
+  Run *previous = m_runs[m_previous];
+
+  for (int k = 0; k < m_run_count[m_previous]; k++) {
+    if (previous[k].blob != BLOB_NONE) {
+      int root = Find(previous[k].blob);
+      if (!m_blobs[root].done) {
+        Done(root, bearing, min_area);
+      }
+    }
+  }
+  m_run_count[m_previous] = 0;
+}
+
+void BlobLabeller::ReleaseDone(int bearing) {
+  int n = m_done[bearing];
+
+  while (n != BLOB_NONE) {
+    int next = m_blobs[n].next;
+    Release(n);
+    n = next;
+  }
+  m_done[bearing] = BLOB_NONE;
+}
+
+void BlobLabeller::Release(int n) {
+  m_blobs[n].next = m_free;
+  m_free = n;
+}
+
+PLUGIN_END_NAMESPACE
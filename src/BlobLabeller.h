@@ -0,0 +1,126 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _BLOB_LABELLER_H_
+#define _BLOB_LABELLER_H_
+
+#include "HistoryPlane.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Labels the connected echoes of the spoke history as the spokes come in, one spoke at a time.
+// A spoke is split into runs of echoes. A run that overlaps a run of the previous spoke joins
+// the blob of that run, and when it overlaps runs of two blobs these are united (union-find).
+// A blob is done when no run of the next spoke touches it. The spokes are counted on without
+// wrapping, so a blob across north is not a special case.
+//
+// Done blobs are listed at the spoke where they were done, until the sweep passes that spoke
+// again. So there is always one sweep of blobs, with their bounding box, area and centroid,
+// that ARPA can look up instead of tracing contours from every echo.
+//
+
+#define BLOB_NONE (-1)
+#define BLOB_MAX (32768)  // blobs that can be in use at the same time, open or done
+
+struct Blob {
+  int min_angle;  // the spoke the blob starts in, 0 <= min_angle < spokes
+  int max_angle;  // the spoke it ends in, counted on from min_angle so it may be beyond spokes
+  int min_r;
+  int max_r;
+  int area;        // number of samples
+  int seed_angle;  // first sample of the blob, which lies on its contour
+  int seed_r;
+  int64_t sum_angle;  // of all samples, counted from min_angle
+  int64_t sum_r;
+  wxLongLong time;  // of the last spoke of the blob
+
+  int CentroidAngle() const { return min_angle + (int)(sum_angle / area); }  // may be beyond spokes
+  int CentroidR() const { return (int)(sum_r / area); }
+
+  // Private to BlobLabeller
+  uint32_t first;  // spoke count of min_angle
+  uint32_t last;   // spoke count of max_angle
+  int parent;      // the blob itself when it is a root
+  int next;        // next done blob at the same spoke, or next free blob
+  bool done;
+};
+
+class BlobLabeller {
+ public:
+  BlobLabeller(size_t spokes, size_t spoke_len);
+  ~BlobLabeller();
+
+  bool IsAllocated() { return m_blobs && m_done && m_runs[0] && m_runs[1]; }
+
+  // Call for every spoke, with the echoes of the spoke in a history plane.
+  // Blobs with fewer than min_area samples are not listed.
+  void ProcessSpoke(int bearing, const HistoryWord *echo, size_t len, wxLongLong time, int min_area);
+  void Clear();
+
+  // The blobs that were done at a spoke in the last sweep
+  int GetFirstDone(int bearing) { return m_done[bearing]; }
+  const Blob *GetBlob(int n) { return &m_blobs[n]; }
+
+ private:
+  struct Run {
+    int start;
+    int end;  // inclusive
+    int blob;
+  };
+
+  int NewBlob(int bearing, int start);
+  void AddRun(int blob, int start, int end, wxLongLong time);
+  int Find(int blob);
+  int Unite(int a, int b);
+  void Done(int blob, int bearing, int min_area);
+  void FinishRuns(int bearing, int min_area);
+  void ReleaseDone(int bearing);
+  void Release(int blob);
+
+  size_t m_spokes;
+  size_t m_spoke_len;
+  int m_last_bearing;  // -1 before the first spoke
+  uint32_t m_count;    // of the spoke that is processed, counts on forever
+
+  Blob *m_blobs;  // BLOB_MAX
+  int m_free;     // first free blob
+  int *m_done;    // first done blob at each spoke
+  int m_merged;   // blobs united into another during this spoke, to free at its end
+
+  Run *m_runs[2];   // the runs of the previous and this spoke
+  int m_run_count[2];
+  int m_previous;  // index of the previous spoke in m_runs
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _BLOB_LABELLER_H_ */
@@ -0,0 +1,106 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "ClutterMap.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+PLUGIN_BEGIN_NAMESPACE
+
+ClutterMap::ClutterMap(size_t spokes, size_t spoke_len) {
+  size_t columns = (spokes + CLUTTER_CELL_SPOKES - 1) / CLUTTER_CELL_SPOKES;
+
+  m_spokes = spokes;
+  m_words = HISTORY_WORDS(spoke_len);
+  m_mean = (float *)malloc(sizeof(float) * columns * m_words);
+  m_square = (float *)malloc(sizeof(float) * columns * m_words);
+  m_updates = (uint16_t *)malloc(sizeof(uint16_t) * columns);
+  m_threshold = (uint8_t *)malloc(m_words);
+  if (IsAllocated()) {
+    Clear();
+  }
+}
+
+ClutterMap::~ClutterMap() {
+  free(m_mean);
+  free(m_square);
+  free(m_updates);
+  free(m_threshold);
+}
+
+void ClutterMap::Clear() {
+  size_t columns = (m_spokes + CLUTTER_CELL_SPOKES - 1) / CLUTTER_CELL_SPOKES;
+
+  memset(m_mean, 0, sizeof(float) * columns * m_words);
+  memset(m_square, 0, sizeof(float) * columns * m_words);
+  memset(m_updates, 0, sizeof(uint16_t) * columns);
+  memset(m_threshold, 0, m_words);
+}
+
+void ClutterMap::ProcessSpoke(int bearing, const uint8_t *data, size_t len) {
+  size_t column = (size_t)bearing / CLUTTER_CELL_SPOKES;
+  float *mean = m_mean + column * m_words;
+  float *square = m_square + column * m_words;
+  size_t words = HISTORY_WORDS(len);
+
+  if (words > m_words) {
+    words = m_words;
+    len = m_words * HISTORY_WORD_BITS;
+  }
+
+  // Until a column has seen CLUTTER_UPDATES spokes it is a plain average of the spokes so far,
+  // after that the older spokes fade out.
+  if (m_updates[column] < CLUTTER_UPDATES) {
+    m_updates[column]++;
+  }
+  float weight = 1.0f / m_updates[column];
+
+  for (size_t w = 0; w < words; w++, data += HISTORY_WORD_BITS) {
+    float variance = square[w] - mean[w] * mean[w];
+    float threshold = mean[w] + CLUTTER_SIGMAS * sqrtf(variance > 0.f ? variance : 0.f);
+    m_threshold[w] = threshold >= 255.f ? 255 : (uint8_t)ceilf(threshold);
+
+    int n = w < len / HISTORY_WORD_BITS ? HISTORY_WORD_BITS : (int)(len % HISTORY_WORD_BITS);
+    uint32_t sum = 0;
+    uint32_t sum_square = 0;
+    for (int b = 0; b < n; b++) {
+      sum += data[b];
+      sum_square += data[b] * data[b];
+    }
+    mean[w] += weight * ((float)sum / n - mean[w]);
+    square[w] += weight * ((float)sum_square / n - square[w]);
+  }
+  // Beyond the end of a short spoke nothing is known, so only the fixed threshold is used there
+  memset(m_threshold + words, 0, m_words - words);
+}
+
+PLUGIN_END_NAMESPACE
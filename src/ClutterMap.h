@@ -0,0 +1,82 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _CLUTTER_MAP_H_
+#define _CLUTTER_MAP_H_
+
+#include "HistoryPlane.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// A clutter map for a constant false alarm rate (CFAR) detection. The picture is divided in
+// cells of CLUTTER_CELL_SPOKES spokes by HISTORY_WORD_BITS samples, so a cell covers one word
+// of the history planes. Every cell keeps the running mean and mean square of its samples over
+// the last CLUTTER_REVOLUTIONS revolutions or so. A sample is only an echo when it stands
+// CLUTTER_SIGMAS standard deviations above the mean of its cell, so sea clutter and rain that
+// are there every revolution raise the threshold where they are, and nowhere else.
+//
+// The cells are indexed by bearing, like the history, and start again when the range changes.
+//
+
+#define CLUTTER_CELL_SPOKES (8)   // spokes in a cell, a cell is HISTORY_WORD_BITS samples long
+#define CLUTTER_REVOLUTIONS (8)   // revolutions that the statistics run over
+#define CLUTTER_SIGMAS (3.0f)     // how far above the mean of a cell an echo must be
+#define CLUTTER_UPDATES (CLUTTER_CELL_SPOKES * CLUTTER_REVOLUTIONS)  // 1 / weight of a new spoke
+
+class ClutterMap {
+ public:
+  ClutterMap(size_t spokes, size_t spoke_len);
+  ~ClutterMap();
+
+  bool IsAllocated() { return m_mean && m_square && m_updates && m_threshold; }
+
+  // Call for every spoke. Computes the threshold for every word of the spoke from the cells so
+  // far, and then adds the spoke to the cells. The spoke itself thus never hides its own echoes.
+  void ProcessSpoke(int bearing, const uint8_t *data, size_t len);
+  void Clear();
+
+  // The thresholds of the last spoke, one for each word of a history plane
+  const uint8_t *GetThresholds() { return m_threshold; }
+
+ private:
+  size_t m_spokes;
+  size_t m_words;  // cells in a column of CLUTTER_CELL_SPOKES spokes
+
+  float *m_mean;        // columns * m_words
+  float *m_square;      // columns * m_words, mean of the square of the samples
+  uint16_t *m_updates;  // spokes added to each column, up to CLUTTER_UPDATES
+  uint8_t *m_threshold;  // m_words
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _CLUTTER_MAP_H_ */
@@ -117,7 +117,7 @@ string ControlTypeNames[CT_MAX] = {
 #undef CONTROL_TYPE
 };
 
-wxString guard_zone_names[2];
+wxString guard_zone_names[3];
 
 void RadarControlButton::AdjustValue(int adjustment) {
   int oldValue = m_item->GetValue();
@@ -339,6 +339,7 @@ bool ControlsDialog::Create(wxWindow* parent, radar_pi* ppi, RadarInfo* ri, wxWi
   /*guard_zone_names[0] = _("Off");*/
   guard_zone_names[0] = _("Arc");
   guard_zone_names[1] = _("Circle");
+  guard_zone_names[2] = _("Polygon");
 
   if (!wxDialog::Create(parent, id, caption, pos, wxDefaultSize, wstyle)) {
     return false;
@@ -450,7 +451,7 @@ void ControlsDialog::SetGuardZoneVisibility() {
   GuardZoneType zoneType = (GuardZoneType)m_guard_zone_type->GetSelection();
   m_guard_zone->SetType(zoneType);
 
-  if (zoneType == GZ_CIRCLE) {
+  if (zoneType == GZ_CIRCLE || zoneType == GZ_POLYGON) {  // The corners of a polygon are set in the config file
     m_start_bearing->Disable();
     m_end_bearing->Disable();
     m_inner_range->Enable();
@@ -1455,7 +1456,11 @@ void ControlsDialog::OnTransmitButtonClick(wxCommandEvent& event) {
   }
 }
 
-void ControlsDialog::OnClearTrailsButtonClick(wxCommandEvent& event) { m_ri->ClearTrails(); }
+void ControlsDialog::OnClearTrailsButtonClick(wxCommandEvent& event) {
+  // The trails are written by the RadarProcess thread
+  wxCriticalSectionLocker lock(m_ri->m_exclusive);
+  m_ri->ClearTrails();
+}
 
 void ControlsDialog::OnOrientationButtonClick(wxCommandEvent& event) {
   int value = m_ri->m_orientation.GetValue() + 1;
@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "GeoIndex.h"
+
+#include <limits.h>
+#include <math.h>
+#include <algorithm>
+
+PLUGIN_BEGIN_NAMESPACE
+
+GeoIndex::GeoIndex(double cell) {
+  m_cell = cell;
+  m_sorted = true;
+  m_min_row = m_max_row = 0;
+  m_min_col = m_max_col = 0;
+}
+
+void GeoIndex::Clear() {
+  m_entries.clear();
+  m_sorted = true;
+}
+
+void GeoIndex::Add(int id, double lat, double lon) {
+  Entry e;
+
+  e.cell = Cell(Row(lat), Col(lon));
+  e.id = id;
+  e.lat = lat;
+  e.lon = lon;
+  m_entries.push_back(e);
+  m_sorted = false;
+}
+
+int GeoIndex::Row(double lat) const { return (int)floor(lat / m_cell); }
+
+int GeoIndex::Col(double lon) const { return (int)floor(lon / m_cell); }
+
+// The row goes in the top half, so all cells of a row sort together. Both halves are
+// offset so that negative rows and columns sort before positive ones.
+uint64_t GeoIndex::Cell(int row, int col) {
+  return ((uint64_t)((uint32_t)row ^ 0x80000000u) << 32) | (uint64_t)((uint32_t)col ^ 0x80000000u);
+}
+
+void GeoIndex::Sort() {
+  if (m_sorted) {
+    return;
+  }
+  std::sort(m_entries.begin(), m_entries.end());
+  m_min_row = m_min_col = INT_MAX;
+  m_max_row = m_max_col = INT_MIN;
+  for (size_t i = 0; i < m_entries.size(); i++) {
+    int row = Row(m_entries[i].lat);
+    int col = Col(m_entries[i].lon);
+
+    m_min_row = std::min(m_min_row, row);
+    m_max_row = std::max(m_max_row, row);
+    m_min_col = std::min(m_min_col, col);
+    m_max_col = std::max(m_max_col, col);
+  }
+  m_sorted = true;
+}
+
+// Index of the first entry at or after cell (row, col)
+size_t GeoIndex::FirstInRow(int row, int col) {
+  Entry key;
+
+  key.cell = Cell(row, col);
+  return std::lower_bound(m_entries.begin(), m_entries.end(), key) - m_entries.begin();
+}
+
+size_t GeoIndex::FindInBox(double lat, double lon, double d_lat, double d_lon, int *ids, size_t max_ids) {
+  size_t found = 0;
+
+  Sort();
+  if (m_entries.empty() || max_ids == 0) {
+    return 0;
+  }
+  int first_row = std::max(Row(lat - d_lat), m_min_row);
+  int last_row = std::min(Row(lat + d_lat), m_max_row);
+  int first_col = std::max(Col(lon - d_lon), m_min_col);
+  int last_col = std::min(Col(lon + d_lon), m_max_col);
+  if (first_col > last_col) {
+    return 0;
+  }
+
+  for (int row = first_row; row <= last_row; row++) {
+    uint64_t end = Cell(row, last_col);
+
+    for (size_t i = FirstInRow(row, first_col); i < m_entries.size() && m_entries[i].cell <= end; i++) {
+      const Entry &e = m_entries[i];
+
+      if (fabs(e.lat - lat) < d_lat && fabs(e.lon - lon) < d_lon) {
+        ids[found++] = e.id;
+        if (found == max_ids) {
+          return found;
+        }
+      }
+    }
+  }
+  return found;
+}
+
+PLUGIN_END_NAMESPACE
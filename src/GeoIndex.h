@@ -0,0 +1,93 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _GEO_INDEX_H_
+#define _GEO_INDEX_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// A grid over latitude and longitude that finds the positions near a position without
+// looking at all of them. Every position is stored with the cell it lies in. The entries
+// are kept sorted by cell, row by row, so the cells of one row that a search covers are
+// next to each other and are found with a single binary search. A search for a box thus
+// costs O(log n) per row of cells, no matter how many positions there are elsewhere.
+//
+// The positions are added with Add() and sorted at the first search after that, so a
+// caller that changes many positions between searches sorts only once.
+// Positions across the antimeridian are not near each other.
+//
+
+#define GEO_INDEX_CELL (1. / 128.)  // degrees, about 870 m of latitude
+
+class GeoIndex {
+ public:
+  GeoIndex(double cell = GEO_INDEX_CELL);
+
+  void Clear();
+  void Add(int id, double lat, double lon);
+  size_t GetCount() const { return m_entries.size(); }
+
+  // Puts the ids of at most 'max_ids' positions with |lat - pos lat| < d_lat and |lon - pos lon| < d_lon
+  // in 'ids' and returns how many it found.
+  size_t FindInBox(double lat, double lon, double d_lat, double d_lon, int *ids, size_t max_ids);
+
+ private:
+  struct Entry {
+    uint64_t cell;
+    int id;
+    double lat;
+    double lon;
+
+    bool operator<(const Entry &other) const { return cell < other.cell; }
+  };
+
+  double m_cell;
+  bool m_sorted;
+  int m_min_row, m_max_row;  // extent of the rows and columns in use, valid when sorted
+  int m_min_col, m_max_col;
+  std::vector<Entry> m_entries;
+
+  int Row(double lat) const;
+  int Col(double lon) const;
+  static uint64_t Cell(int row, int col);
+  void Sort();
+  size_t FirstInRow(int row, int col);
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _GEO_INDEX_H_ */
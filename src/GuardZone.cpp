@@ -29,6 +29,8 @@
  */
 
 #include "GuardZone.h"
+#include <wx/tokenzr.h>
+#include "BlobLabeller.h"
 #include "RadarMarpa.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -46,61 +48,99 @@ GuardZone::GuardZone(radar_pi* pi, RadarInfo* ri, int zone) {
   m_outer_range = 0;
   m_arpa_on = 0;
   m_alarm_on = 0;
+  m_polygon_geo = 0;
+  m_polygon_exclude = 0;
   m_show_time = 0;
   CLEAR_STRUCT(arpa_update_time);
+  m_span_spokes = -1;  // ProcessSpoke computes the spans first
+  m_polygon_count = 0;
+  m_polygon_version = 0;
+  m_mask = 0;
+  m_mask_words = 0;
+  m_mask_spokes = 0;  // no mask yet
   ResetBogeys();
 }
 
-void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, uint8_t* hist, size_t len) {
-  size_t range_start = m_inner_range * m_ri->m_pixels_per_meter;  // Convert from meters to [0..spoke_len_max>
-  size_t range_end = m_outer_range * m_ri->m_pixels_per_meter;    // Convert from meters to [0..spoke_len_max>
+// Computes which samples of each spoke are in the zone, so ProcessSpoke does not have to.
+void GuardZone::ComputeSpans() {
+  size_t range_start = m_inner_range * m_ri->m_pixels_per_meter;   // Convert from meters to [0..spoke_len_max>
+  size_t range_end = m_outer_range * m_ri->m_pixels_per_meter + 1;  // The outer range itself is in the zone
+
+  if (range_start > SPOKE_LEN_MAX) {
+    range_start = SPOKE_LEN_MAX;
+  }
+  if (range_end > SPOKE_LEN_MAX) {
+    range_end = SPOKE_LEN_MAX;
+  }
+
+  for (int angle = 0; angle < m_ri->m_spokes; angle++) {
+    AngleDegrees degAngle = SCALE_SPOKES_TO_DEGREES(angle);
+    bool in_zone = m_type == GZ_CIRCLE || (m_type == GZ_ARC && ((degAngle >= m_start_bearing && degAngle < m_end_bearing) ||
+                                                                 (m_start_bearing >= m_end_bearing &&
+                                                                  (degAngle >= m_start_bearing || degAngle < m_end_bearing))));
+
+    m_span[angle].begin = in_zone ? (uint16_t)range_start : 0;
+    m_span[angle].end = in_zone ? (uint16_t)range_end : 0;
+  }
+
+  m_span_type = m_type;
+  m_span_start_bearing = m_start_bearing;
+  m_span_end_bearing = m_end_bearing;
+  m_span_inner_range = m_inner_range;
+  m_span_outer_range = m_outer_range;
+  m_span_pixels_per_meter = m_ri->m_pixels_per_meter;
+  m_span_spokes = m_ri->m_spokes;
+}
+
+void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, const HistoryWord* strong, size_t len) {
+  if (m_span_spokes != m_ri->m_spokes || m_span_pixels_per_meter != m_ri->m_pixels_per_meter || m_span_type != m_type ||
+      m_span_start_bearing != m_start_bearing || m_span_end_bearing != m_end_bearing || m_span_inner_range != m_inner_range ||
+      m_span_outer_range != m_outer_range) {
+    ComputeSpans();
+  }
+  if (angle >= m_span_spokes) {
+    return;
+  }
+
+  GuardZoneSpan span = m_span[angle];
+  size_t range_start = span.begin;
+  size_t range_end = span.end < len ? span.end : len;
   bool in_guard_zone = false;
-  AngleDegrees degAngle = SCALE_SPOKES_TO_DEGREES(angle);
 
-  switch (m_type) {
-    case GZ_ARC:
-      if ((degAngle >= m_start_bearing && degAngle < m_end_bearing) ||
-          (m_start_bearing >= m_end_bearing && (degAngle >= m_start_bearing || degAngle < m_end_bearing))) {
-        if (range_start < len) {
-          if (range_end > len) {
-            range_end = len;
-          }
-          for (size_t r = range_start; r <= range_end; r++) {
-            if (data[r] >= m_pi->m_settings.threshold_blue) {
-              m_running_count++;
-            }
+  if (span.end > 0 && range_start < len) {
+    m_running_count += HistoryCount(strong, (int)range_start, (int)range_end);
 #ifdef TEST_GUARD_ZONE_LOCATION
-            // Zap guard zone computation location to green so this is visible on screen
-            else {
-              data[r] = m_pi->m_settings.threshold_green;
-            }
-#endif
-          }
-        }
-        in_guard_zone = true;
+    // Zap guard zone computation location to green so this is visible on screen
+    for (size_t r = range_start; r < range_end; r++) {
+      if (data[r] < m_pi->m_settings.threshold_blue) {
+        data[r] = m_pi->m_settings.threshold_green;
       }
+    }
+#endif
+  }
+
+  switch (m_type) {
+    case GZ_ARC:
+      in_guard_zone = span.end > 0;
       break;
 
     case GZ_CIRCLE:
-      if (range_start < len) {
-        if (range_end > len) {
-          range_end = len;
-        }
+      if (range_start < len && angle > m_last_angle) {
+        in_guard_zone = true;
+      }
+      break;
 
-        for (size_t r = range_start; r <= range_end; r++) {
-          if (data[r] >= m_pi->m_settings.threshold_blue) {
-            m_running_count++;
-          }
-#ifdef TEST_GUARD_ZONE_LOCATION
-          // Zap guard zone computation location to green so this is visible on screen
-          else {
-            data[r] = m_pi->m_settings.threshold_green;
-          }
-#endif
-        }
-        if (angle > m_last_angle) {
-          in_guard_zone = true;
+    case GZ_POLYGON:
+      if (angle < m_last_angle || m_mask_spokes == 0) {  // a new rotation
+        UpdateMask();
+      }
+      if (angle < m_mask_spokes) {
+        size_t words = HISTORY_WORDS(len);
+        if (words > m_mask_words) {
+          words = m_mask_words;
         }
+        m_running_count += HistoryCountMasked(strong, m_mask + angle * m_mask_words, words);
+        in_guard_zone = angle > m_last_angle;
       }
       break;
 
@@ -130,8 +170,8 @@ void GuardZone::ProcessSpoke(SpokeBearing angle, uint8_t* data, uint8_t* hist, s
   m_last_angle = angle;
 }
 
-// Search guard zone for ARPA targets
-void GuardZone::SearchTargets() {
+// Search the part of the guard zone between spokes 'first' and 'end' for ARPA targets
+void GuardZone::SearchTargets(int first, int end) {
   ExtendedPosition own_pos;
   if (!m_arpa_on) {
     return;
@@ -169,43 +209,62 @@ void GuardZone::SearchTargets() {
   if (start_bearing > end_bearing) {
     end_bearing += m_ri->m_spokes;
   }
-  if (m_type == GZ_CIRCLE) {
+  if (m_type == GZ_CIRCLE || m_type == GZ_POLYGON) {
     start_bearing = 0;
     end_bearing = m_ri->m_spokes;
   }
+  if (m_type == GZ_POLYGON && !UpdateMask()) {
+    return;
+  }
+  int zone_spokes = end_bearing - start_bearing;
   if (range_start < m_ri->m_spoke_len_max) {
     if (range_end > m_ri->m_spoke_len_max) {
       range_end = m_ri->m_spoke_len_max;
     }
     if (range_end < range_start) return;
 
-    // loop with +2 increments as target must be larger than 2 pixels in width
-    for (int angleIter = start_bearing; angleIter < end_bearing; angleIter += 2) {
+    // The blobs in the history are listed at the spoke after the one where they ended, which can be
+    // outside an arc zone that holds the blob. So visit every spoke, and test where the blob is.
+    for (int angleIter = first; angleIter < end; angleIter++) {
       SpokeBearing angle = MOD_SPOKES(angleIter);
       wxLongLong time1 = m_ri->m_history[angle].time;
       // time2 must be timed later than the pass 2 in refresh, otherwise target may be found multiple times
-      wxLongLong time2 = m_ri->m_history[MOD_SPOKES(angle + 3 * SCAN_MARGIN)].time;
+      wxLongLong time2 = m_ri->m_history[MOD_SPOKES(angle + GUARD_ZONE_MARGIN)].time;
 
       // check if target has been refreshed since last time
       // and if the beam has passed the target location with SCAN_MARGIN spokes
       if ((time1 > (arpa_update_time[angle] + SCAN_MARGIN2) && time2 >= time1)) {  // the beam sould have passed our "angle" AND a
                                                                                    // point SCANMARGIN further set new refresh time
         arpa_update_time[angle] = time1;
-        for (int rrr = (int)range_start; rrr < (int)range_end; rrr++) {
+        // Every blob that ended here is a candidate, unless a known target claimed it
+        Polar seeds[GUARD_ZONE_SEEDS];
+        int count = 0;
+        {
+          wxCriticalSectionLocker lock(m_ri->m_exclusive);
+          int b = m_ri->m_blobs->GetFirstDone(angle);
+          while (b != BLOB_NONE && count < GUARD_ZONE_SEEDS) {
+            const Blob* blob = m_ri->m_blobs->GetBlob(b);
+            int r = blob->CentroidR();
+            SpokeBearing centroid = MOD_SPOKES(blob->CentroidAngle());
+            if (r >= (int)range_start && r < (int)range_end && MOD_SPOKES(centroid - start_bearing) < zone_spokes &&
+                (m_type != GZ_POLYGON || InMask(MOD_SPOKES(centroid - hdt), r)) &&
+                HISTORY_BIT(m_ri->m_history[blob->seed_angle].unclaimed, blob->seed_r)) {
+              seeds[count].angle = blob->seed_angle;
+              seeds[count].r = blob->seed_r;
+              count++;
+            }
+            b = blob->next;
+          }
+        }
+        for (int i = 0; i < count; i++) {
           if (m_ri->m_arpa->GetTargetCount() >= MAX_NUMBER_OF_TARGETS - 1) {
             LOG_INFO(wxT("radar_pi: No more scanning for ARPA targets in loop, maximum number of targets reached"));
             return;
           }
-          if (m_ri->m_arpa->MultiPix(angle, rrr)) {
-            bool next_r = false;
-            if (next_r) continue;
-            // pixel found that does not belong to a known target
-            Polar pol;
-            pol.angle = angle;
-            pol.r = rrr;
-            int target_i = m_ri->m_arpa->AcquireNewARPATarget(pol, 0);
-            if (target_i == -1) break;
-          }
+          // One short trace of the blob's contour tells whether it is large enough
+          if (!m_ri->m_arpa->MultiPix(seeds[i].angle, seeds[i].r)) continue;
+          int target_i = m_ri->m_arpa->AcquireNewARPATarget(seeds[i], 0);
+          if (target_i == -1) break;
         }
       }
     }
@@ -213,4 +272,211 @@ void GuardZone::SearchTargets() {
   return;
 }
 
+bool GuardZone::SetPolygon(const wxString& corners) {
+  GuardZoneVertex polygon[GUARD_ZONE_VERTICES];
+  int count = 0;
+  wxStringTokenizer tokenizer(corners, wxT(";"));
+
+  while (tokenizer.HasMoreTokens()) {
+    wxString corner = tokenizer.GetNextToken().Strip(wxString::both);
+    if (corner.IsEmpty()) {
+      continue;
+    }
+    if (count == GUARD_ZONE_VERTICES) {
+      LOG_INFO(wxT("%s polygon has more than %d corners"), m_log_name.c_str(), GUARD_ZONE_VERTICES);
+      return false;
+    }
+    if (!corner.BeforeFirst(',').Strip(wxString::both).ToCDouble(&polygon[count].a) ||
+        !corner.AfterFirst(',').Strip(wxString::both).ToCDouble(&polygon[count].b)) {
+      LOG_INFO(wxT("%s polygon corner '%s' is not 'a,b'"), m_log_name.c_str(), corner.c_str());
+      return false;
+    }
+    count++;
+  }
+
+  memcpy(m_polygon, polygon, count * sizeof(GuardZoneVertex));
+  m_polygon_count = count;
+  m_polygon_version++;
+  return true;
+}
+
+wxString GuardZone::GetPolygon() {
+  wxString corners;
+
+  for (int i = 0; i < m_polygon_count; i++) {
+    if (i > 0) {
+      corners << wxT(";");
+    }
+    corners << wxString::FromCDouble(m_polygon[i].a, 7) << wxT(",") << wxString::FromCDouble(m_polygon[i].b, 7);
+  }
+  return corners;
+}
+
+// Places a corner in meters ahead and to starboard of the radar
+void GuardZone::ToLocal(const GuardZoneVertex& v, double heading, const GeoPosition& radar, double* ahead, double* starboard) {
+  if (!m_polygon_geo) {
+    *ahead = v.a;
+    *starboard = v.b;
+    return;
+  }
+  double north = (v.a - radar.lat) * 60. * 1852.;
+  double east = (v.b - radar.lon) * 60. * 1852. * cos(deg2rad(radar.lat));
+  double h = deg2rad(heading);
+
+  *ahead = north * cos(h) + east * sin(h);
+  *starboard = east * cos(h) - north * sin(h);
+}
+
+int GuardZone::GetPolygonLocal(double* ahead, double* starboard) {
+  GeoPosition radar = {0., 0.};
+  double heading = 0.;
+
+  if (m_polygon_geo) {
+    if (!m_ri->GetRadarPosition(&radar)) {
+      return 0;
+    }
+    heading = m_pi->GetHeadingTrue();
+  }
+  for (int i = 0; i < m_polygon_count; i++) {
+    ToLocal(m_polygon[i], heading, radar, ahead + i, starboard + i);
+  }
+  return m_polygon_count;
+}
+
+// Rasterizes the polygon again when the range, the zone or, for a polygon in latitude and
+// longitude, the heading or position of the boat has changed since the last time.
+// Returns false when there is no mask to use.
+bool GuardZone::UpdateMask() {
+  GeoPosition radar = {0., 0.};
+  double heading = 0.;
+  int spokes = m_ri->m_spokes;
+  double pixels_per_meter = m_ri->m_pixels_per_meter;
+
+  if (m_polygon_count < 3 || pixels_per_meter == 0. || spokes <= 0 ||
+      (m_polygon_geo && !m_ri->GetRadarPosition(&radar))) {
+    m_mask_spokes = 0;
+    return false;
+  }
+  if (m_polygon_geo) {
+    heading = m_pi->GetHeadingTrue();
+  }
+
+  bool changed = m_mask_spokes != spokes || m_mask_version != m_polygon_version ||
+                 m_mask_pixels_per_meter != pixels_per_meter || m_mask_inner_range != m_inner_range ||
+                 m_mask_outer_range != m_outer_range || m_mask_geo != m_polygon_geo || m_mask_exclude != m_polygon_exclude;
+  if (!changed && m_polygon_geo) {
+    double turned = fabs(heading - m_mask_heading);
+    if (turned > 180.) {
+      turned = 360. - turned;
+    }
+    double north = (radar.lat - m_mask_position.lat) * 60. * 1852.;
+    double east = (radar.lon - m_mask_position.lon) * 60. * 1852. * cos(deg2rad(radar.lat));
+    double moved = sqrt(north * north + east * east) * pixels_per_meter;
+
+    changed = turned > 180. / spokes || moved > 1.;  // half a spoke or a whole sample
+  }
+  if (changed) {
+    RasterizePolygon(heading, radar);
+  }
+  return true;
+}
+
+//
+// For every spoke the crossings of its line with the edges of the polygon are found.
+// Walking out from the radar, each crossing goes from inside to outside the polygon or back,
+// and the radar is inside when the number of crossings is odd. The samples between the ranges
+// that are inside (or outside for an exclusion zone) are set in the mask.
+//
+void GuardZone::RasterizePolygon(double heading, const GeoPosition& radar) {
+  int spokes = m_ri->m_spokes;
+  int spoke_len = (int)m_ri->m_spoke_len_max;
+  size_t words = HISTORY_WORDS(spoke_len);
+  double pixels_per_meter = m_ri->m_pixels_per_meter;
+
+  HistoryWord* mask = (HistoryWord*)realloc(m_mask, spokes * words * sizeof(HistoryWord));
+  if (!mask) {
+    wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+  m_mask = mask;
+  memset(m_mask, 0, spokes * words * sizeof(HistoryWord));
+
+  double ahead[GUARD_ZONE_VERTICES];
+  double starboard[GUARD_ZONE_VERTICES];
+  for (int i = 0; i < m_polygon_count; i++) {
+    ToLocal(m_polygon[i], heading, radar, ahead + i, starboard + i);
+    ahead[i] *= pixels_per_meter;
+    starboard[i] *= pixels_per_meter;
+  }
+
+  int range_start = (int)(m_inner_range * pixels_per_meter);
+  int range_last = (int)(m_outer_range * pixels_per_meter);  // The outer range itself is in the zone
+  if (range_last > spoke_len - 1) {
+    range_last = spoke_len - 1;
+  }
+
+  for (int angle = 0; angle < spokes; angle++) {
+    double theta = angle * 2. * PI / spokes;
+    double c = cos(theta);
+    double s = sin(theta);
+    double crossing[GUARD_ZONE_VERTICES];
+    int n = 0;
+
+    for (int i = 0; i < m_polygon_count; i++) {
+      int j = (i + 1) % m_polygon_count;
+      double across_i = starboard[i] * c - ahead[i] * s;
+      double across_j = starboard[j] * c - ahead[j] * s;
+
+      if ((across_i > 0.) != (across_j > 0.)) {
+        double along_i = ahead[i] * c + starboard[i] * s;
+        double along_j = ahead[j] * c + starboard[j] * s;
+        double t = along_i + (along_j - along_i) * across_i / (across_i - across_j);
+        if (t > 0.) {
+          crossing[n++] = t;
+        }
+      }
+    }
+    std::sort(crossing, crossing + n);
+
+    HistoryWord* row = m_mask + angle * words;
+    bool in_zone = ((n & 1) != 0) != (m_polygon_exclude != 0);
+    double from = 0.;
+    for (int k = 0; k <= n; k++) {
+      double to = k < n ? crossing[k] : range_last + 1.;
+      if (to > range_last + 1.) {
+        to = range_last + 1.;
+      }
+      if (in_zone) {
+        int first = (int)ceil(from);
+        int last = (int)ceil(to) - 1;
+        HistorySet(row, first > range_start ? first : range_start, last);
+      }
+      if (to >= range_last + 1.) {
+        break;
+      }
+      in_zone = !in_zone;
+      from = to;
+    }
+  }
+
+  m_mask_words = words;
+  m_mask_spokes = spokes;
+  m_mask_version = m_polygon_version;
+  m_mask_pixels_per_meter = pixels_per_meter;
+  m_mask_inner_range = m_inner_range;
+  m_mask_outer_range = m_outer_range;
+  m_mask_geo = m_polygon_geo;
+  m_mask_exclude = m_polygon_exclude;
+  m_mask_heading = heading;
+  m_mask_position = radar;
+  LOG_GUARD(wxT("%s rasterized polygon of %d corners"), m_log_name.c_str(), m_polygon_count);
+}
+
+bool GuardZone::InMask(SpokeBearing angle, int r) {
+  if (angle < 0 || angle >= m_mask_spokes || r < 0 || r >= (int)(m_mask_words * HISTORY_WORD_BITS)) {
+    return false;
+  }
+  return HISTORY_BIT(m_mask + angle * m_mask_words, r) != 0;
+}
+
 PLUGIN_END_NAMESPACE
@@ -32,10 +32,27 @@
 #ifndef _GUARDZONE_H_
 #define _GUARDZONE_H_
 
+#include "HistoryPlane.h"
 #include "radar_pi.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
+#define GUARD_ZONE_SEEDS (32)  // Candidate ARPA targets taken from the blobs of one spoke
+
+// The samples [begin, end) of one spoke that are in the zone. A spoke outside the zone has end 0.
+struct GuardZoneSpan {
+  uint16_t begin;
+  uint16_t end;
+};
+
+#define GUARD_ZONE_VERTICES (64)  // Corners of a polygon zone
+
+// A corner of a polygon zone, as latitude and longitude or in meters from the radar
+struct GuardZoneVertex {
+  double a;  // latitude, or meters ahead
+  double b;  // longitude, or meters to starboard
+};
+
 class GuardZone {
  public:
   GuardZoneType m_type;
@@ -45,6 +62,8 @@ class GuardZone {
   int m_outer_range;  // end   in meters
   int m_alarm_on;
   int m_arpa_on;
+  int m_polygon_geo;      // GZ_POLYGON: the corners are latitude and longitude, not relative to the boat
+  int m_polygon_exclude;  // GZ_POLYGON: the zone is the ring between the ranges outside the polygon
   time_t m_show_time;
   wxLongLong arpa_update_time[SPOKES_MAX];
 
@@ -57,7 +76,7 @@ class GuardZone {
 
   void SetType(GuardZoneType type) {
     m_type = type;
-    if (m_type > (GuardZoneType)1) m_type = (GuardZoneType)0;
+    if (m_type > GZ_POLYGON) m_type = GZ_ARC;
     ResetBogeys();
   };
   void SetStartBearing(SpokeBearing start_bearing) {
@@ -87,12 +106,21 @@ class GuardZone {
   };
 
   /*
-   * Check if data is in this GuardZone, if so update bogeyCount
+   * Check if data is in this GuardZone, if so update bogeyCount.
+   * 'strong' has a bit set for every sample of data that is at least threshold_blue.
    */
-  void ProcessSpoke(SpokeBearing angle, uint8_t *data, uint8_t *hist, size_t len);
+  void ProcessSpoke(SpokeBearing angle, uint8_t *data, const HistoryWord *strong, size_t len);
+
+  // Find targets inside the zone, in the spokes from 'first' up to 'end'
+  void SearchTargets(int first, int end);
 
-  // Find targets inside the zone
-  void SearchTargets();
+  // The corners of a polygon zone, as "a,b;a,b;..." with a and b as in GuardZoneVertex
+  bool SetPolygon(const wxString &corners);
+  wxString GetPolygon();
+
+  // The corners of a polygon zone in meters ahead and to starboard of the radar, for drawing.
+  // Returns the number of corners, or 0 when they cannot be placed.
+  int GetPolygonLocal(double *ahead, double *starboard);
 
   int GetBogeyCount() {
     if (m_bogey_count > -1) {
@@ -103,7 +131,10 @@ class GuardZone {
 
   GuardZone(radar_pi *pi, RadarInfo *ri, int zone);
 
-  ~GuardZone() { LOG_VERBOSE(wxT("%s destroyed"), m_log_name.c_str()); }
+  ~GuardZone() {
+    free(m_mask);
+    LOG_VERBOSE(wxT("%s destroyed"), m_log_name.c_str());
+  }
 
  private:
   radar_pi *m_pi;
@@ -115,7 +146,41 @@ class GuardZone {
   int m_bogey_count;    // complete cycle
   int m_running_count;  // current swipe
 
+  // The zone as a span per spoke, and what it was computed for. It is computed again when
+  // any of these changes, so setting the members directly is fine.
+  GuardZoneSpan m_span[SPOKES_MAX];
+  GuardZoneType m_span_type;
+  AngleDegrees m_span_start_bearing;
+  AngleDegrees m_span_end_bearing;
+  int m_span_inner_range;
+  int m_span_outer_range;
+  double m_span_pixels_per_meter;
+  int m_span_spokes;
+
+  // A polygon zone as a bit plane per spoke of the samples in the zone, so that counting it costs
+  // the same however many corners it has. It is rasterized again when the range changes, and for
+  // a polygon in latitude and longitude when the boat turns or moves, checked once per rotation.
+  GuardZoneVertex m_polygon[GUARD_ZONE_VERTICES];
+  int m_polygon_count;
+  int m_polygon_version;  // counts the changes of the corners
+  HistoryWord *m_mask;    // m_mask_spokes * m_mask_words
+  size_t m_mask_words;
+  int m_mask_spokes;
+  int m_mask_version;
+  double m_mask_pixels_per_meter;
+  int m_mask_inner_range;
+  int m_mask_outer_range;
+  int m_mask_geo;
+  int m_mask_exclude;
+  double m_mask_heading;
+  GeoPosition m_mask_position;
+
   void UpdateSettings();
+  void ComputeSpans();
+  void ToLocal(const GuardZoneVertex &v, double heading, const GeoPosition &radar, double *ahead, double *starboard);
+  bool UpdateMask();
+  void RasterizePolygon(double heading, const GeoPosition &radar);
+  bool InMask(SpokeBearing angle, int r);
 };
 
 PLUGIN_END_NAMESPACE
@@ -0,0 +1,249 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _HISTORY_PLANE_H_
+#define _HISTORY_PLANE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// The spoke history that ARPA searches only needs to know whether a sample is an echo,
+// so it is kept as bit planes of one bit per sample instead of one byte. Each spoke has
+// two planes: the echoes, and the echoes that no target has claimed yet in this sweep.
+// The planes are filled, tested and cleared a word at a time.
+//
+
+typedef uint32_t HistoryWord;
+
+#define HISTORY_WORD_BITS (32)
+#define HISTORY_WORDS(len) (((len) + HISTORY_WORD_BITS - 1) / HISTORY_WORD_BITS)
+#define HISTORY_BIT(plane, r) (((plane)[(r) / HISTORY_WORD_BITS] >> ((r) % HISTORY_WORD_BITS)) & 1)
+
+static inline int HistoryLowestBit(HistoryWord word) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, word);
+  return (int)index;
+#else
+  return __builtin_ctz(word);
+#endif
+}
+
+static inline int HistoryPopCount(HistoryWord word) {
+#ifdef _MSC_VER
+  // __popcnt needs a CPU with the POPCNT instruction, so count the bits in parallel instead
+  word = word - ((word >> 1) & 0x55555555);
+  word = (word & 0x33333333) + ((word >> 2) & 0x33333333);
+  return (int)((((word + (word >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24);
+#else
+  return __builtin_popcount(word);
+#endif
+}
+
+// Sets a bit for every sample of data that is at least threshold, and clears the rest of the
+// plane up to words.
+static inline void HistoryPack(HistoryWord *plane, size_t words, const uint8_t *data, size_t len, uint8_t threshold) {
+  size_t full = len / HISTORY_WORD_BITS;
+  size_t w = 0;
+
+  for (; w < full; w++, data += HISTORY_WORD_BITS) {
+    HistoryWord word = 0;
+    for (int b = 0; b < HISTORY_WORD_BITS; b++) {
+      word |= (HistoryWord)(data[b] >= threshold) << b;
+    }
+    plane[w] = word;
+  }
+  if (w < words) {
+    HistoryWord word = 0;
+    for (int b = 0; b < (int)(len % HISTORY_WORD_BITS); b++) {
+      word |= (HistoryWord)(data[b] >= threshold) << b;
+    }
+    plane[w++] = word;
+    memset(plane + w, 0, (words - w) * sizeof(HistoryWord));
+  }
+}
+
+// As HistoryPack, but each word of the plane has its own threshold when that is higher,
+// as computed by ClutterMap.
+static inline void HistoryPackAdaptive(HistoryWord *plane, size_t words, const uint8_t *data, size_t len, uint8_t threshold,
+                                       const uint8_t *word_threshold) {
+  size_t full = len / HISTORY_WORD_BITS;
+  size_t w = 0;
+
+  for (; w < full; w++, data += HISTORY_WORD_BITS) {
+    uint8_t t = word_threshold[w] > threshold ? word_threshold[w] : threshold;
+    HistoryWord word = 0;
+    for (int b = 0; b < HISTORY_WORD_BITS; b++) {
+      word |= (HistoryWord)(data[b] >= t) << b;
+    }
+    plane[w] = word;
+  }
+  if (w < words) {
+    uint8_t t = word_threshold[w] > threshold ? word_threshold[w] : threshold;
+    HistoryWord word = 0;
+    for (int b = 0; b < (int)(len % HISTORY_WORD_BITS); b++) {
+      word |= (HistoryWord)(data[b] >= t) << b;
+    }
+    plane[w++] = word;
+    memset(plane + w, 0, (words - w) * sizeof(HistoryWord));
+  }
+}
+
+// Returns the first sample from first up to end that is set, or end when there is none.
+// With invert all ones the same is done for samples that are not set.
+static inline int HistoryScan(const HistoryWord *plane, int first, int end, HistoryWord invert) {
+  if (first >= end) {
+    return end;
+  }
+  int w = first / HISTORY_WORD_BITS;
+  HistoryWord word = (plane[w] ^ invert) & (~(HistoryWord)0 << (first % HISTORY_WORD_BITS));
+  int last_w = (end - 1) / HISTORY_WORD_BITS;
+
+  while (!word) {
+    if (++w > last_w) {
+      return end;
+    }
+    word = plane[w] ^ invert;
+  }
+  int r = w * HISTORY_WORD_BITS + HistoryLowestBit(word);
+  return r < end ? r : end;
+}
+
+static inline int HistoryFind(const HistoryWord *plane, int first, int end) { return HistoryScan(plane, first, end, 0); }
+
+static inline int HistoryFindClear(const HistoryWord *plane, int first, int end) {
+  return HistoryScan(plane, first, end, ~(HistoryWord)0);
+}
+
+// Returns the number of samples from first up to end that are set.
+static inline int HistoryCount(const HistoryWord *plane, int first, int end) {
+  if (first >= end) {
+    return 0;
+  }
+  int first_w = first / HISTORY_WORD_BITS;
+  int last_w = (end - 1) / HISTORY_WORD_BITS;
+  HistoryWord first_mask = ~(HistoryWord)0 << (first % HISTORY_WORD_BITS);
+  HistoryWord last_mask = ~(HistoryWord)0 >> (HISTORY_WORD_BITS - 1 - (end - 1) % HISTORY_WORD_BITS);
+
+  if (first_w == last_w) {
+    return HistoryPopCount(plane[first_w] & first_mask & last_mask);
+  }
+  int count = HistoryPopCount(plane[first_w] & first_mask);
+  for (int w = first_w + 1; w < last_w; w++) {
+    count += HistoryPopCount(plane[w]);
+  }
+  return count + HistoryPopCount(plane[last_w] & last_mask);
+}
+
+// Returns the number of samples that are set in both plane and mask.
+static inline int HistoryCountMasked(const HistoryWord *plane, const HistoryWord *mask, size_t words) {
+  int count = 0;
+
+  for (size_t w = 0; w < words; w++) {
+    count += HistoryPopCount(plane[w] & mask[w]);
+  }
+  return count;
+}
+
+// Sets the samples from first to last, both included.
+static inline void HistorySet(HistoryWord *plane, int first, int last) {
+  if (first > last) {
+    return;
+  }
+  int first_w = first / HISTORY_WORD_BITS;
+  int last_w = last / HISTORY_WORD_BITS;
+  HistoryWord first_mask = ~(HistoryWord)0 << (first % HISTORY_WORD_BITS);
+  HistoryWord last_mask = ~(HistoryWord)0 >> (HISTORY_WORD_BITS - 1 - last % HISTORY_WORD_BITS);
+
+  if (first_w == last_w) {
+    plane[first_w] |= first_mask & last_mask;
+    return;
+  }
+  plane[first_w] |= first_mask;
+  for (int w = first_w + 1; w < last_w; w++) {
+    plane[w] = ~(HistoryWord)0;
+  }
+  plane[last_w] |= last_mask;
+}
+
+// Clears the samples from first to last, both included.
+static inline void HistoryClear(HistoryWord *plane, int first, int last) {
+  if (first > last) {
+    return;
+  }
+  int first_w = first / HISTORY_WORD_BITS;
+  int last_w = last / HISTORY_WORD_BITS;
+  HistoryWord first_mask = ~(HistoryWord)0 << (first % HISTORY_WORD_BITS);
+  HistoryWord last_mask = ~(HistoryWord)0 >> (HISTORY_WORD_BITS - 1 - last % HISTORY_WORD_BITS);
+
+  if (first_w == last_w) {
+    plane[first_w] &= ~(first_mask & last_mask);
+    return;
+  }
+  plane[first_w] &= ~first_mask;
+  for (int w = first_w + 1; w < last_w; w++) {
+    plane[w] = 0;
+  }
+  plane[last_w] &= ~last_mask;
+}
+
+// The neighbours of sample r in a plane, as the contour tracers walk them: bit 0 is r + 1 in
+// the same spoke, bit 1 is r in the next spoke, bit 2 is r - 1 and bit 3 is r in the previous
+// spoke. Samples at 0 or at or beyond len are never set.
+static inline int HistoryNeighbours(const HistoryWord *previous, const HistoryWord *plane, const HistoryWord *next, int r,
+                                    int len) {
+  int around = 0;
+
+  if (r + 1 > 0 && r + 1 < len) {
+    around |= (int)HISTORY_BIT(plane, r + 1);
+  }
+  if (r > 0 && r < len) {
+    around |= (int)HISTORY_BIT(next, r) << 1;
+    around |= (int)HISTORY_BIT(previous, r) << 3;
+  }
+  if (r - 1 > 0 && r - 1 < len) {
+    around |= (int)HISTORY_BIT(plane, r - 1) << 2;
+  }
+  return around;
+}
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _HISTORY_PLANE_H_ */
@@ -29,46 +29,227 @@
  ***************************************************************************
  */
 
+/*
+ * Checks the Kalman filter, and checks the fixed size kernels of KalmanMath.h against the
+ * generic matrix products that they replace, on random states. Then times a filter cycle
+ * (predict, covariance and measurement update) of both.
+ */
+
+#include <chrono>
+#include <iostream>
+
 #include "Kalman.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
-int main() {
-  int ret = 0;
-  KalmanFilter *filter = new KalmanFilter(2048);
-  Polar pol, expected;
-  LocalPosition x_local;
+#define CYCLES (1000000)
+
+static uint32_t seed = 12345;
+
+static double Random(double scale) {
+  seed = seed * 1664525 + 1013904223;
+  return ((double)(seed >> 8) / (1 << 24) - 0.5) * scale;
+}
+
+// The generic versions: plain N x M matrices
+template <int N, int M, int L>
+static void Multiply(const double (&a)[N][M], const double (&b)[M][L], double (&out)[N][L]) {
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < L; c++) {
+      double accum = 0.;
+      for (int i = 0; i < M; i++) {
+        accum += a[r][i] * b[i][c];
+      }
+      out[r][c] = accum;
+    }
+  }
+}
+
+template <int N, int M>
+static void Transpose(const double (&a)[N][M], double (&out)[M][N]) {
+  for (int r = 0; r < N; r++) {
+    for (int c = 0; c < M; c++) {
+      out[c][r] = a[r][c];
+    }
+  }
+}
+
+struct GenericFilter {
+  double A[4][4], AT[4][4], W[4][2], WT[2][4], H[2][4], HT[4][2], P[4][4], Q[2][2], R[2][2], I[4][4];
+  double X[4][1];
+
+  void Init(const KalmanCovariance p, const KalmanState x, double dt, const KalmanObservation h, const KalmanNoise q,
+            const KalmanNoise r) {
+    memset(this, 0, sizeof(*this));
+    for (int i = 0; i < 4; i++) {
+      I[i][i] = A[i][i] = 1.;
+      X[i][0] = x[i];
+      for (int j = 0; j < 4; j++) {
+        P[i][j] = p[i][j];
+      }
+    }
+    A[0][2] = A[1][3] = dt;
+    Transpose(A, AT);
+    W[2][0] = W[3][1] = 1.;
+    Transpose(W, WT);
+    for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < 2; j++) {
+        H[i][j] = h[i][j];
+      }
+      Q[i][i] = q[i];
+      R[i][i] = r[i];
+    }
+    Transpose(H, HT);
+  }
 
-  Matrix<double, 2, 2> m = {0.f, 0.f, 0.f, 0.f};
+  void Predict() {
+    double ax[4][1];
+    Multiply(A, X, ax);
+    memcpy(X, ax, sizeof(X));
+  }
 
-  if (m(0, 0) != 0.f || m(0, 1) != 0.f || m(1, 0) != 0.f || m(1, 1) != 0.f) {
-    cout << "INFO: M(0,0)=" << m(0, 0) << " M(0,1)=" << m(0, 1) << " M(1,0)=" << m(1, 0) << " M(1,1)=" << m(1, 1) << "\n";
-    cout << "ERROR: Matrix is not initialized to zero\n";
-    ret = 1;
+  void Update_P() {
+    double ap[4][4], apat[4][4], wq[4][2], wqwt[4][4];
+    Multiply(A, P, ap);
+    Multiply(ap, AT, apat);
+    Multiply(W, Q, wq);
+    Multiply(wq, WT, wqwt);
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        P[i][j] = apat[i][j] + wqwt[i][j];
+      }
+    }
   }
 
-  m = ZeroMatrix2;
-  if (m(0, 0) != 0.f || m(0, 1) != 0.f || m(1, 0) != 0.f || m(1, 1) != 0.f) {
-    cout << "INFO: M(0,0)=" << m(0, 0) << " M(0,1)=" << m(0, 1) << " M(1,0)=" << m(1, 0) << " M(1,1)=" << m(1, 1) << "\n";
-    cout << "ERROR: Matrix is not initialized to zero\n";
-    ret = 1;
+  void SetMeasurement(const double z[2]) {
+    double hp[2][4], s[2][2], inverse[2][2], pht[4][2], k[4][2], kz[4][1], zz[2][1] = {{z[0]}, {z[1]}};
+    double kh[4][4], p[4][4];
+
+    Multiply(H, P, hp);
+    Multiply(hp, HT, s);
+    for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < 2; j++) {
+        s[i][j] += R[i][j];
+      }
+    }
+    double det = s[0][0] * s[1][1] - s[0][1] * s[1][0];
+    inverse[0][0] = s[1][1] / det;
+    inverse[1][1] = s[0][0] / det;
+    inverse[0][1] = -s[0][1] / det;
+    inverse[1][0] = -s[1][0] / det;
+    Multiply(P, HT, pht);
+    Multiply(pht, inverse, k);
+    Multiply(k, zz, kz);
+    for (int i = 0; i < 4; i++) {
+      X[i][0] += kz[i][0];
+    }
+    Multiply(k, H, kh);
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        kh[i][j] = I[i][j] - kh[i][j];
+      }
+    }
+    Multiply(kh, P, p);
+    memcpy(P, p, sizeof(P));
   }
+};
+
+static double Difference(double a, double b) { return fabs(a - b) / (1. + fabs(a) + fabs(b)); }
+
+static int CompareKernels() {
+  double worst = 0.;
+
+  for (int test = 0; test < 10000; test++) {
+    KalmanCovariance P;
+    KalmanState X;
+    KalmanObservation H;
+    KalmanNoise Q = {0.015, 0.015};
+    KalmanNoise R = {100., 25.};
+    double Z[2] = {Random(20.), Random(20.)};
+    double dt = Random(10.) + 5.;
 
-  m = m.Init(1.f);
+    // A covariance is symmetric positive definite, so make it B BT plus a bit on the diagonal
+    double B[4][4];
+    for (int i = 0; i < 4; i++) {
+      X[i] = Random(1000.);
+      for (int j = 0; j < 4; j++) {
+        B[i][j] = Random(10.);
+      }
+    }
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++) {
+        P[i][j] = i == j ? 1. : 0.;
+        for (int k = 0; k < 4; k++) {
+          P[i][j] += B[i][k] * B[j][k];
+        }
+      }
+    }
+    for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < 2; j++) {
+        H[i][j] = Random(2.);
+      }
+    }
 
-  if (m(0, 0) != 1.f || m(0, 1) != 1.f || m(1, 0) != 1.f || m(1, 1) != 1.f) {
-    cout << "INFO: M(0,0)=" << m(0, 0) << " M(0,1)=" << m(0, 1) << " M(1,0)=" << m(1, 0) << " M(1,1)=" << m(1, 1) << "\n";
-    cout << "ERROR: Matrix is not initialized to ones\n";
-    ret = 1;
+    GenericFilter generic;
+    generic.Init(P, X, dt, H, Q, R);
+    generic.Predict();
+    generic.Update_P();
+    generic.SetMeasurement(Z);
+
+    KalmanPredictState(X, dt);
+    KalmanPredictCovariance(P, dt, Q);
+    KalmanUpdate(P, X, H, R, Z);
+
+    for (int i = 0; i < 4; i++) {
+      worst = fmax(worst, Difference(X[i], generic.X[i][0]));
+      for (int j = 0; j < 4; j++) {
+        worst = fmax(worst, Difference(P[i][j], generic.P[i][j]));
+      }
+    }
+  }
+  cout << "INFO: largest relative difference between the kernels and the generic products " << worst << "\n";
+  if (worst > 1e-9) {
+    cout << "ERROR: the kernels do not compute the same as the generic products\n";
+    return 1;
   }
+  return 0;
+}
+
+static void TimeKernels() {
+  KalmanCovariance P = {{20., 0., 0., 0.}, {0., 20., 0., 0.}, {0., 0., 4., 0.}, {0., 0., 0., 4.}};
+  KalmanState X = {100., 200., 1., 2.};
+  KalmanObservation H = {{-0.5, 1.2}, {0.3, 0.4}};
+  KalmanNoise Q = {0.015, 0.015};
+  KalmanNoise R = {100., 25.};
+  double Z[2] = {0.5, -0.25};
+  GenericFilter generic;
 
-  m = m.Identity();
+  generic.Init(P, X, 2.5, H, Q, R);
 
-  if (m(0, 0) != 1.f || m(0, 1) != 0.f || m(1, 0) != 0.f || m(1, 1) != 1.f) {
-    cout << "INFO: M(0,0)=" << m(0, 0) << " M(0,1)=" << m(0, 1) << " M(1,0)=" << m(1, 0) << " M(1,1)=" << m(1, 1) << "\n";
-    cout << "ERROR: Matrix is not initialized to identity\n";
-    ret = 1;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i = 0; i < CYCLES; i++) {
+    KalmanPredictState(X, 2.5);
+    KalmanPredictCovariance(P, 2.5, Q);
+    KalmanUpdate(P, X, H, R, Z);
   }
+  std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+  for (int i = 0; i < CYCLES; i++) {
+    generic.Predict();
+    generic.Update_P();
+    generic.SetMeasurement(Z);
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  cout << "INFO: filter cycle " << std::chrono::duration<double, std::nano>(middle - start).count() / CYCLES
+       << " ns with the kernels, " << std::chrono::duration<double, std::nano>(end - middle).count() / CYCLES
+       << " ns with generic products (x=" << X[0] + generic.X[0][0] << ")\n";
+}
+
+int main() {
+  int ret = 0;
+  KalmanFilter *filter = new KalmanFilter(2048);
+  Polar pol, expected;
+  LocalPosition x_local;
 
   pol.angle = 0;
   pol.r = 1000;
@@ -101,6 +282,9 @@ int main() {
   ASSERT_VALUE("lon", x_local.pos.lon, 5);
   ASSERT_VALUE("stddev", x_local.sd_speed_m_s, 2.03224);
 
+  ret |= CompareKernels();
+  TimeKernels();
+
   if (ret == 0) {
     cout << "INFO: TEST PASSED\n";
   } else {
@@ -33,7 +33,7 @@
 #ifndef _KALMAN_H_
 #define _KALMAN_H_
 
-#include "Matrix.h"
+#include "KalmanMath.h"
 #include "RadarInfo.h"
 
 PLUGIN_BEGIN_NAMESPACE
@@ -60,55 +60,40 @@ class LocalPosition {
   double sd_speed_m_s;  // standard deviation of the speed, m/s
 };
 
-static Matrix<double, 4, 2> ZeroMatrix42;
-static Matrix<double, 2, 4> ZeroMatrix24;
-static Matrix<double, 4> ZeroMatrix4;
-static Matrix<double, 2> ZeroMatrix2;
-
 class KalmanFilter {
  public:
   KalmanFilter(size_t spokes);
   ~KalmanFilter();
-  void SetMeasurement(Polar* p, LocalPosition* x, Polar* expected, double scale);
+  // Returns false when the measurement could not be used, and x stays as predicted
+  bool SetMeasurement(Polar* p, LocalPosition* x, Polar* expected, double scale);
   void Predict(LocalPosition* x, double delta_time);  // measured position and expected position
   void ResetFilter();
   void Update_P();
 
-  Matrix<double, 4> A;
-  Matrix<double, 4> AT;
-  Matrix<double, 4, 2> W;
-  Matrix<double, 2, 4> WT;
-  Matrix<double, 2, 4> H;
-  Matrix<double, 4, 2> HT;
-  Matrix<double, 4> P;
-  Matrix<double, 2> Q;
-  Matrix<double, 2> R;
-  Matrix<double, 4, 2> K;
-  Matrix<double, 4> I;
+  KalmanCovariance P;  // estimate error covariance
+  KalmanNoise Q;       // process noise covariance, speed in lat and lon
+  KalmanNoise R;       // measurement noise covariance, angle and radius
 
  private:
   size_t m_spokes;
+  double m_delta_time;  // of the last Predict(), for Update_P()
 };
 
 class GPSKalmanFilter {
  public:
   GPSKalmanFilter();
   ~GPSKalmanFilter();
-  void SetMeasurement(ExtendedPosition* gps, ExtendedPosition* updated);
+  // Returns false when the measurement could not be used, and updated stays as predicted
+  bool SetMeasurement(ExtendedPosition* gps, ExtendedPosition* updated);
   void Predict(ExtendedPosition* old, ExtendedPosition* updated);
   void Update_P();
 
-  Matrix<double, 4> A;
-  Matrix<double, 4> AT;
-  Matrix<double, 4, 2> W;
-  Matrix<double, 2, 4> WT;
-  Matrix<double, 2, 4> H;
-  Matrix<double, 4, 2> HT;
-  Matrix<double, 4> P;
-  Matrix<double, 2> Q;
-  Matrix<double, 2> R;
-  Matrix<double, 4, 2> K;
-  Matrix<double, 4> I;
+  KalmanCovariance P;  // estimate error covariance
+  KalmanNoise Q;       // process noise covariance, speed in lat and lon
+  KalmanNoise R;       // measurement noise covariance, lat and lon
+
+ private:
+  double m_delta_time;  // of the last Predict(), for Update_P()
 };
 
 PLUGIN_END_NAMESPACE
@@ -0,0 +1,130 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _KALMAN_MATH_H_
+#define _KALMAN_MATH_H_
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// The matrix operations of the Kalman filters in Kalman.cpp, written out for the one model they use.
+// The state x is position and speed: lat, lon, dlat_dt, dlon_dt. In a time step dt the position moves
+// by dt times the speed, so the state transition A is [I dt*I; 0 I]. The process noise W Q WT only
+// adds to the variance of the speed. A measurement only sees the position, so the 2 x 4 observation
+// matrix H is [h 0] with h a 2 x 2 matrix. Q and R are diagonal.
+//
+// The generic products on 4 x 4 matrices are mostly multiplications by 0 and 1. Here they are just
+// the additions that remain, without temporaries. Kalman-test.cpp checks them against the generic
+// products and times both.
+//
+
+#define KALMAN_STATES (4)
+#define KALMAN_MEASUREMENTS (2)
+
+typedef double KalmanState[KALMAN_STATES];
+typedef double KalmanCovariance[KALMAN_STATES][KALMAN_STATES];
+typedef double KalmanObservation[KALMAN_MEASUREMENTS][KALMAN_MEASUREMENTS];  // h, the part of H that is not 0
+typedef double KalmanNoise[KALMAN_MEASUREMENTS];                              // the diagonal of Q or R
+
+// x = A x
+static inline void KalmanPredictState(KalmanState x, double dt) {
+  x[0] += dt * x[2];
+  x[1] += dt * x[3];
+}
+
+// P = A P AT + W Q WT
+static inline void KalmanPredictCovariance(KalmanCovariance P, double dt, const KalmanNoise q) {
+  // A P adds dt times the speed rows to the position rows
+  for (int c = 0; c < KALMAN_STATES; c++) {
+    P[0][c] += dt * P[2][c];
+    P[1][c] += dt * P[3][c];
+  }
+  // and (A P) AT does the same for the columns
+  for (int r = 0; r < KALMAN_STATES; r++) {
+    P[r][0] += dt * P[r][2];
+    P[r][1] += dt * P[r][3];
+  }
+  P[2][2] += q[0];
+  P[3][3] += q[1];
+}
+
+// With z the measurement minus the expected measurement:
+// K = P HT (H P HT + R)^-1, x = x + K z, P = (I - K H) P
+// Returns false, and changes nothing, when H P HT + R has no inverse.
+static inline bool KalmanUpdate(KalmanCovariance P, KalmanState x, const KalmanObservation h, const KalmanNoise r,
+                                const double z[KALMAN_MEASUREMENTS]) {
+  double pht[KALMAN_STATES][KALMAN_MEASUREMENTS];  // P HT, only the position columns of P count
+
+  for (int i = 0; i < KALMAN_STATES; i++) {
+    pht[i][0] = P[i][0] * h[0][0] + P[i][1] * h[0][1];
+    pht[i][1] = P[i][0] * h[1][0] + P[i][1] * h[1][1];
+  }
+
+  // S = H P HT + R, and its inverse
+  double s00 = h[0][0] * pht[0][0] + h[0][1] * pht[1][0] + r[0];
+  double s01 = h[0][0] * pht[0][1] + h[0][1] * pht[1][1];
+  double s10 = h[1][0] * pht[0][0] + h[1][1] * pht[1][0];
+  double s11 = h[1][0] * pht[0][1] + h[1][1] * pht[1][1] + r[1];
+  double det = s00 * s11 - s01 * s10;
+  if (det == 0.) {
+    return false;
+  }
+  double i00 = s11 / det;
+  double i01 = -s01 / det;
+  double i10 = -s10 / det;
+  double i11 = s00 / det;
+
+  double k[KALMAN_STATES][KALMAN_MEASUREMENTS];
+  for (int i = 0; i < KALMAN_STATES; i++) {
+    k[i][0] = pht[i][0] * i00 + pht[i][1] * i10;
+    k[i][1] = pht[i][0] * i01 + pht[i][1] * i11;
+    x[i] += k[i][0] * z[0] + k[i][1] * z[1];
+  }
+
+  // H P, only the position rows of P count. Take these before P changes.
+  double hp[KALMAN_MEASUREMENTS][KALMAN_STATES];
+  for (int c = 0; c < KALMAN_STATES; c++) {
+    hp[0][c] = h[0][0] * P[0][c] + h[0][1] * P[1][c];
+    hp[1][c] = h[1][0] * P[0][c] + h[1][1] * P[1][c];
+  }
+  for (int i = 0; i < KALMAN_STATES; i++) {
+    for (int c = 0; c < KALMAN_STATES; c++) {
+      P[i][c] -= k[i][0] * hp[0][c] + k[i][1] * hp[1][c];
+    }
+  }
+  return true;
+}
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _KALMAN_MATH_H_ */
@@ -81,6 +81,18 @@ OptionsDialog::OptionsDialog(wxWindow *parent, PersistentSettings &settings, Rad
                             this);
   m_GuardZoneStyle->SetSelection(m_settings.guard_zone_render_style);
 
+  wxString ScanFilterStrings[] = {
+      _("Off"),
+      _("Echo in both scans"),
+      _("Echo in two of three scans"),
+      _("Average of scans"),
+  };
+  m_ScanFilter = new wxRadioBox(this, wxID_ANY, _("Scan to scan filter"), wxDefaultPosition, wxDefaultSize,
+                                ARRAY_SIZE(ScanFilterStrings), ScanFilterStrings, 1, wxRA_SPECIFY_COLS);
+
+  m_ScanFilter->Connect(wxEVT_COMMAND_RADIOBOX_SELECTED, wxCommandEventHandler(OptionsDialog::OnScanFilterClick), NULL, this);
+  m_ScanFilter->SetSelection(m_settings.scan_filter);
+
   // Guard Zone Alarm
 
   wxStaticBox *guardZoneBox = new wxStaticBox(this, wxID_ANY, _("Guard Zone Sound"));
@@ -216,6 +228,7 @@ OptionsDialog::OptionsDialog(wxWindow *parent, PersistentSettings &settings, Rad
   DisplayOptionsBox->Add(menuOptionsSizer, 0, wxALL | wxEXPAND, border_size);
   DisplayOptionsBox->Add(m_GuardZoneStyle, 0, wxALL | wxEXPAND, border_size);
   DisplayOptionsBox->Add(guardZoneSizer, 0, wxALL, border_size);
+  DisplayOptionsBox->Add(m_ScanFilter, 0, wxALL | wxEXPAND, border_size);
   DisplayOptionsBox->Add(trailSizer, 0, wxALL | wxEXPAND, border_size);
   DisplayOptionsBox->Add(colourSizer, 0, wxALL | wxEXPAND, border_size);
   DisplayOptionsBox->Add(PPIColourSizer, 0, wxALL | wxEXPAND, border_size);
@@ -271,6 +284,12 @@ OptionsDialog::OptionsDialog(wxWindow *parent, PersistentSettings &settings, Rad
                                 NULL, this);
   m_GuardZoneOnOverlay->SetValue(m_settings.guard_zone_on_overlay);
 
+  m_AdaptiveThreshold = new wxCheckBox(this, wxID_ANY, _("Adaptive threshold for ARPA and Guard Zones"));
+  itemStaticBoxSizerDisplayOptions->Add(m_AdaptiveThreshold, 0, wxALL, border_size);
+  m_AdaptiveThreshold->Connect(wxEVT_COMMAND_CHECKBOX_CLICKED, wxCommandEventHandler(OptionsDialog::OnAdaptiveThresholdClick),
+                               NULL, this);
+  m_AdaptiveThreshold->SetValue(m_settings.adaptive_threshold);
+
   m_TrailsOnOverlay = new wxCheckBox(this, wxID_ANY, _("Show Target trails on overlay"));
   itemStaticBoxSizerDisplayOptions->Add(m_TrailsOnOverlay, 0, wxALL, border_size);
   m_TrailsOnOverlay->Connect(wxEVT_COMMAND_CHECKBOX_CLICKED, wxCommandEventHandler(OptionsDialog::OnTrailsOnOverlayClick), NULL,
@@ -309,6 +328,8 @@ void OptionsDialog::OnGuardZoneStyleClick(wxCommandEvent &event) {
   m_settings.guard_zone_render_style = m_GuardZoneStyle->GetSelection();
 }
 
+void OptionsDialog::OnScanFilterClick(wxCommandEvent &event) { m_settings.scan_filter = m_ScanFilter->GetSelection(); }
+
 void OptionsDialog::OnGuardZoneOnOverlayClick(wxCommandEvent &event) {
   m_settings.guard_zone_on_overlay = m_GuardZoneOnOverlay->GetValue();
 }
@@ -317,6 +338,10 @@ void OptionsDialog::OnShowExtremeRangeClick(wxCommandEvent &event) {
   m_settings.show_extreme_range = m_ShowExtremeRange->GetValue();
 }
 
+void OptionsDialog::OnAdaptiveThresholdClick(wxCommandEvent &event) {
+  m_settings.adaptive_threshold = m_AdaptiveThreshold->GetValue();
+}
+
 void OptionsDialog::OnOverlayOnStandbyClick(wxCommandEvent &event) { m_settings.overlay_on_standby = m_OverlayStandby->GetValue(); }
 
 void OptionsDialog::OnTrailsOnOverlayClick(wxCommandEvent &event) { m_settings.trails_on_overlay = m_TrailsOnOverlay->GetValue(); }
@@ -48,9 +48,11 @@ class OptionsDialog : public wxDialog {
   void OnDisplayOptionClick(wxCommandEvent& event);
   void OnDisplayModeClick(wxCommandEvent& event);
   void OnGuardZoneStyleClick(wxCommandEvent& event);
+  void OnScanFilterClick(wxCommandEvent& event);
   void OnGuardZoneOnOverlayClick(wxCommandEvent& event);
   void OnOverlayOnStandbyClick(wxCommandEvent& event);
   void OnGuardZoneTimeoutClick(wxCommandEvent& event);
+  void OnAdaptiveThresholdClick(wxCommandEvent& event);
   void OnShowExtremeRangeClick(wxCommandEvent& event);
   void OnTrailsOnOverlayClick(wxCommandEvent& event);
   void OnTrailStartColourClick(wxCommandEvent& event);
@@ -80,7 +82,9 @@ class OptionsDialog : public wxDialog {
   wxRadioBox* m_OverlayDisplayOptions;
   wxRadioBox* m_DisplayMode;
   wxRadioBox* m_GuardZoneStyle;
+  wxRadioBox* m_ScanFilter;
   wxTextCtrl* m_GuardZoneTimeout;
+  wxCheckBox* m_AdaptiveThreshold;
   wxColourPickerCtrl* m_TrailStartColour;
   wxColourPickerCtrl* m_TrailEndColour;
   wxColourPickerCtrl* m_WeakColour;
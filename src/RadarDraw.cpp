@@ -42,6 +42,10 @@ RadarDraw* RadarDraw::make_Draw(RadarInfo* ri, int draw_method) {
       return new RadarDrawVertex(ri);
     case 1:
       return new RadarDrawShader(ri);
+    case 2:
+      return new RadarDrawVertex(ri, true);
+    case 3:
+      return new RadarDrawShader(ri, true);
     default:
       wxLogError(wxT("radar_pi: unsupported draw method %d"), draw_method);
   }
@@ -51,7 +55,7 @@ RadarDraw* RadarDraw::make_Draw(RadarInfo* ri, int draw_method) {
 RadarDraw::~RadarDraw() {}
 
 void RadarDraw::GetDrawingMethods(wxArrayString& methods) {
-  wxString m[] = {_("Vertex Array"), _("Shader")};
+  wxString m[] = {_("Vertex Array"), _("Shader"), _("Vertex Buffer"), _("Palette Shader")};
 
   methods = wxArrayString(ARRAY_SIZE(m), m);
 }
@@ -48,6 +48,10 @@ class RadarDraw {
   virtual ~RadarDraw() = 0;
 
   static void GetDrawingMethods(wxArrayString& methods);
+
+  // The shader draws the whole image around the current radar position, the
+  // vertex methods move every spoke to the position where it was received.
+  static bool IsShaderMethod(int draw_method) { return draw_method == 1 || draw_method == 3; }
 };
 
 PLUGIN_END_NAMESPACE
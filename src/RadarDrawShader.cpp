@@ -70,11 +70,23 @@ static const char *FragmentShaderColorText =
     "   gl_FragColor = texture2D(tex2d, vec2(d, a)); \n"
     "} \n";
 
+// Same, but the texture holds spoke bytes that are looked up in a 256 entry palette
+static const char *FragmentShaderPaletteText =
+    "uniform sampler2D tex2d; \n"
+    "uniform sampler2D palette; \n"
+    "void main() \n"
+    "{ \n"
+    "   float d = length(gl_TexCoord[0].xy);\n"
+    "   if (d >= 1.0) \n"
+    "      discard; \n"
+    "   float a = atan(gl_TexCoord[0].y, gl_TexCoord[0].x) / 6.28318; \n"
+    "   float strength = texture2D(tex2d, vec2(d, a)).x; \n"
+    "   gl_FragColor = texture2D(palette, vec2((strength * 255.0 + 0.5) / 256.0, 0.5)); \n"
+    "} \n";
+
 bool RadarDrawShader::Init(size_t spokes, size_t spoke_len_max) {
   wxCriticalSectionLocker lock(m_exclusive);
 
-  m_format = GL_RGBA;
-  m_channels = SHADER_COLOR_CHANNELS;
   m_spokes = spokes;
   m_spoke_len_max = spoke_len_max;
 
@@ -85,26 +97,42 @@ bool RadarDrawShader::Init(size_t spokes, size_t spoke_len_max) {
 
   Reset();
 
-  if (!CompileShaderText(&m_vertex, GL_VERTEX_SHADER, VertexShaderText) ||
-      !CompileShaderText(&m_fragment, GL_FRAGMENT_SHADER, FragmentShaderColorText)) {
+  m_data = (unsigned char *)calloc(m_channels, m_spoke_len_max * m_spokes);
+  m_spoke_generation = (uint64_t *)calloc(sizeof(uint64_t), m_spokes);
+  if (!m_data || !m_spoke_generation) {
+    wxLogError(wxT("radar_pi: Out of memory"));
+    return false;
+  }
+  m_generation = 0;
+
+  // Set up the context that is current now, so a failure can make the caller fall back
+  // to another drawing method.
+  return GetContext() != 0;
+}
+
+/*
+ * Compile the program and create the texture in the OpenGL context that is current.
+ */
+bool RadarDrawShader::InitContext(ShaderContext *sc) {
+  if (!CompileShaderText(&sc->vertex, GL_VERTEX_SHADER, VertexShaderText) ||
+      !CompileShaderText(&sc->fragment, GL_FRAGMENT_SHADER,
+                         m_channels == SHADER_COLOR_CHANNELS ? FragmentShaderColorText : FragmentShaderPaletteText)) {
     wxLogError(wxT("radar_pi: the OpenGL system of this computer failed to compile shader programs"));
     return false;
   }
 
-  m_program = LinkShaders(m_vertex, m_fragment);
-  if (m_program == 0) {
+  sc->program = LinkShaders(sc->vertex, sc->fragment);
+  if (sc->program == 0) {
     wxLogError(wxT("radar_pi: GPU oriented OpenGL failed to link shader program"));
     return false;
   }
 
-  glGenTextures(1, &m_texture);
-  glBindTexture(GL_TEXTURE_2D, m_texture);
+  glGenTextures(1, &sc->texture);
+  glBindTexture(GL_TEXTURE_2D, sc->texture);
 
-  if (m_data) {
-    free(m_data);
-  }
-  m_data = (unsigned char *)calloc(SHADER_COLOR_CHANNELS, m_spoke_len_max * m_spokes);
-  // Tell the GPU the size of the texture:
+  // Tell the GPU the size of the texture, and give it all data received so far:
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);  // Rows of single byte texels need not be a multiple of 4
   glTexImage2D(/* target          = */ GL_TEXTURE_2D,
                /* level           = */ 0,
                /* internal_format = */ m_format,
@@ -114,37 +142,103 @@ bool RadarDrawShader::Init(size_t spokes, size_t spoke_len_max) {
                /* format          = */ m_format,
                /* type            = */ GL_UNSIGNED_BYTE,
                /* data            = */ m_data);
-  glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glPopClientAttrib();
 
-  m_start_line = -1;
-  m_lines = 0;
+  if (m_channels == SHADER_COLOR_CHANNELS) {
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  } else {
+    // Interpolating between two spoke bytes would give the colour of a third one
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glGenTextures(1, &sc->palette);
+    glBindTexture(GL_TEXTURE_2D, sc->palette);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SHADER_PALETTE_SIZE, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_palette);
+    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    sc->palette_generation = m_palette_generation;
+
+    UseProgram(sc->program);
+    Uniform1i(GetUniformLocation(sc->program, "tex2d"), 0);
+    Uniform1i(GetUniformLocation(sc->program, "palette"), 1);
+    UseProgram(0);
+  }
 
+  sc->generation = m_generation;
   return true;
 }
 
-void RadarDrawShader::Reset() {
-  if (m_vertex) {
-    DeleteShader(m_vertex);
-    m_vertex = 0;
+/*
+ * Find the state for the OpenGL context that is current, creating it when this is
+ * the first time this context draws this object.
+ */
+RadarDrawShader::ShaderContext *RadarDrawShader::GetContext() {
+  void *context = GetCurrentGLContext();
+  ShaderContext *free_slot = 0;
+
+  for (size_t i = 0; i < ARRAY_SIZE(m_contexts); i++) {
+    if (m_contexts[i].program && m_contexts[i].context == context) {
+      return &m_contexts[i];
+    }
+    if (!m_contexts[i].program && !free_slot) {
+      free_slot = &m_contexts[i];
+    }
+  }
+  if (!free_slot) {
+    LOG_VERBOSE(wxT("radar_pi: %s shader drawn from more than %d OpenGL contexts"), m_ri->m_name.c_str(), SHADER_CONTEXTS);
+    return 0;
+  }
+
+  CLEAR_STRUCT(*free_slot);
+  if (!InitContext(free_slot)) {
+    ResetContext(free_slot);
+    return 0;
+  }
+  free_slot->context = context;
+  return free_slot;
+}
+
+// Only call with the context of sc current: OpenGL object names are per context.
+void RadarDrawShader::ResetContext(ShaderContext *sc) {
+  if (sc->vertex) {
+    DeleteShader(sc->vertex);
+  }
+  if (sc->fragment) {
+    DeleteShader(sc->fragment);
+  }
+  if (sc->program) {
+    DeleteProgram(sc->program);
   }
-  if (m_fragment) {
-    DeleteShader(m_fragment);
-    m_fragment = 0;
+  if (sc->texture) {
+    glDeleteTextures(1, &sc->texture);
   }
-  if (m_program) {
-    DeleteProgram(m_program);
-    m_program = 0;
+  if (sc->palette) {
+    glDeleteTextures(1, &sc->palette);
   }
-  if (m_texture) {
-    glDeleteTextures(1, &m_texture);
-    m_texture = 0;
+  CLEAR_STRUCT(*sc);
+}
+
+void RadarDrawShader::Reset() {
+  void *context = GetCurrentGLContext();
+
+  for (size_t i = 0; i < ARRAY_SIZE(m_contexts); i++) {
+    if (m_contexts[i].program && m_contexts[i].context == context) {
+      ResetContext(&m_contexts[i]);
+    }
   }
+  // The objects of other contexts can not be deleted from here, they go when their context goes.
+  CLEAR_STRUCT(m_contexts);
 
   if (m_data) {
     free(m_data);
     m_data = 0;
   }
+  if (m_spoke_generation) {
+    free(m_spoke_generation);
+    m_spoke_generation = 0;
+  }
 }
 
 RadarDrawShader::~RadarDrawShader() {
@@ -153,62 +247,91 @@ RadarDrawShader::~RadarDrawShader() {
   Reset();
 }
 
+/*
+ * Send the rows that were written since this context last uploaded, as few
+ * glTexSubImage2D calls as there are contiguous runs of such rows.
+ */
+void RadarDrawShader::UploadRows(ShaderContext *sc) {
+  size_t row = 0;
+
+  if (sc->generation == m_generation) {
+    return;
+  }
+  glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  while (row < m_spokes) {
+    if (m_spoke_generation[row] <= sc->generation) {
+      row++;
+      continue;
+    }
+    size_t start = row;
+    while (row < m_spokes && m_spoke_generation[row] > sc->generation) {
+      row++;
+    }
+    glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
+                    /* level =    */ 0,
+                    /* x-offset = */ 0,
+                    /* y-offset = */ start,
+                    /* width =    */ m_spoke_len_max,
+                    /* height =   */ row - start,
+                    /* format =   */ m_format,
+                    /* type =     */ GL_UNSIGNED_BYTE,
+                    /* pixels =   */ m_data + start * m_spoke_len_max * m_channels);
+  }
+  glPopClientAttrib();
+  sc->generation = m_generation;
+}
+
+/*
+ * Rebuild the palette from the colour map of the radar, which may have changed since
+ * the last frame, and the transparency of the last spoke.
+ */
+void RadarDrawShader::UpdatePalette() {
+  GLubyte palette[SHADER_PALETTE_SIZE][SHADER_COLOR_CHANNELS];
+
+  for (int i = 0; i < SHADER_PALETTE_SIZE; i++) {
+    BlobColour colour = m_ri->m_colour_map[i];
+    palette[i][0] = m_ri->m_colour_map_rgb[colour].Red();
+    palette[i][1] = m_ri->m_colour_map_rgb[colour].Green();
+    palette[i][2] = m_ri->m_colour_map_rgb[colour].Blue();
+    palette[i][3] = colour != BLOB_NONE ? m_alpha : 0;
+  }
+  if (memcmp(palette, m_palette, sizeof(m_palette)) != 0) {
+    memcpy(m_palette, palette, sizeof(m_palette));
+    m_palette_generation++;
+  }
+}
+
 void RadarDrawShader::DrawRadarOverlayImage(double radar_scale, double panel_rotate) {
   wxCriticalSectionLocker lock(m_exclusive);
 
-  if (!m_program || !m_texture || !m_data) {
+  if (!m_data) {
+    return;
+  }
+  ShaderContext *sc = GetContext();
+  if (!sc) {
     return;
   }
 
   glPushAttrib(GL_TEXTURE_BIT);
 
-  UseProgram(m_program);
-
-  glBindTexture(GL_TEXTURE_2D, m_texture);
-
-  if (m_start_line > -1) {
-    // Since the last time we have received data from [m_start_line, m_end_line>
-    // so we only need to update the texture for those data lines.
-    if (m_start_line + m_lines > (int)m_spokes) {
-      int end_line = (m_start_line + m_lines) % m_spokes;
-      // if the new data partly wraps past the end of the texture
-      // tell it the two parts separately
-      // First remap [0, m_end_line>
-      glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
-                      /* level =    */ 0,
-                      /* x-offset = */ 0,
-                      /* y-offset = */ 0,
-                      /* width =    */ m_spoke_len_max,
-                      /* height =   */ end_line,
-                      /* format =   */ m_format,
-                      /* type =     */ GL_UNSIGNED_BYTE,
-                      /* pixels =   */ m_data);
-      // And then remap [m_start_line, m_spokes>
-      glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
-                      /* level =    */ 0,
-                      /* x-offset = */ 0,
-                      /* y-offset = */ m_start_line,
-                      /* width =    */ m_spoke_len_max,
-                      /* height =   */ m_spokes - m_start_line,
-                      /* format =   */ m_format,
-                      /* type =     */ GL_UNSIGNED_BYTE,
-                      /* pixels =   */ m_data + m_start_line * m_spoke_len_max * m_channels);
-    } else {
-      // Map [m_start_line, m_end_line>
-      glTexSubImage2D(/* target =   */ GL_TEXTURE_2D,
-                      /* level =    */ 0,
-                      /* x-offset = */ 0,
-                      /* y-offset = */ m_start_line,
-                      /* width =    */ m_spoke_len_max,
-                      /* height =   */ m_lines,
-                      /* format =   */ m_format,
-                      /* type =     */ GL_UNSIGNED_BYTE,
-                      /* pixels =   */ m_data + m_start_line * m_spoke_len_max * m_channels);
+  UseProgram(sc->program);
+
+  if (m_channels != SHADER_COLOR_CHANNELS) {
+    UpdatePalette();
+    ActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, sc->palette);
+    if (sc->palette_generation != m_palette_generation) {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, SHADER_PALETTE_SIZE, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_palette);
+      sc->palette_generation = m_palette_generation;
     }
-    m_start_line = -1;
-    m_lines = 0;
+    ActiveTexture(GL_TEXTURE0);
   }
 
+  glBindTexture(GL_TEXTURE_2D, sc->texture);
+
+  UploadRows(sc);
+
   // We tell the GPU to draw a square from (-512,-512) to (+512,+512).
   // The shader morphs this into a circle.
   float fullscale = m_spoke_len_max;
@@ -233,12 +356,10 @@ void RadarDrawShader::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
   GLubyte alpha = 255 * (MAX_OVERLAY_TRANSPARENCY - transparency) / MAX_OVERLAY_TRANSPARENCY;
   wxCriticalSectionLocker lock(m_exclusive);
 
-  if (m_start_line == -1) {
-    m_start_line = angle;  // Note that this only runs once after each draw,
-  }
-  if (m_lines < (int)m_spokes) {
-    m_lines++;
+  if (!m_data) {
+    return;
   }
+  m_spoke_generation[angle] = ++m_generation;
 
   if (m_channels == SHADER_COLOR_CHANNELS) {
     unsigned char *d = m_data + (angle * m_spoke_len_max) * m_channels;
@@ -258,15 +379,10 @@ void RadarDrawShader::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
       *d++ = 0;
     }
   } else {
-    unsigned char *d = m_data + (angle * m_spoke_len_max);
-    for (size_t r = 0; r < len; r++) {
-      GLubyte strength = data[r];
-      BlobColour colour = m_ri->m_colour_map[strength];
-      *d++ = (m_ri->m_colour_map_rgb[colour].Red() * alpha) >> 8;
-    }
-    for (size_t r = len; r < m_spoke_len_max; r++) {
-      *d++ = 0;
-    }
+    // The palette does the colour lookup
+    m_alpha = alpha;
+    memcpy(m_data + angle * m_spoke_len_max, data, len);
+    memset(m_data + angle * m_spoke_len_max + len, 0, m_spoke_len_max - len);
   }
 }
 
@@ -36,20 +36,36 @@
 
 PLUGIN_BEGIN_NAMESPACE
 
-#define SHADER_COLOR_CHANNELS (4)  // RGB + Alpha
+#define SHADER_COLOR_CHANNELS (4)           // RGB + Alpha
+#define SHADER_CONTEXTS (MAX_CHART_CANVAS)  // OpenGL contexts that can draw the same object
+#define SHADER_PALETTE_SIZE (256)           // One palette entry per spoke byte value
+
+//
+// The RGBA spoke data is kept once per draw object in m_data. Every OpenGL context that
+// draws the object, for instance the overlay on two chart canvases that do not share their
+// context, gets its own texture and program. Each spoke row carries the generation at which
+// it was last written, and each context remembers the generation it has uploaded up to,
+// so every context uploads exactly the rows it has not seen yet.
+//
+// With palette set ("Palette Shader" drawing method) the texture holds the spoke bytes as
+// they are, one byte per texel. The fragment shader looks up the colour of each byte in a
+// 256 x 1 RGBA palette texture made from m_colour_map, m_colour_map_rgb and the
+// transparency. A change of colours, thresholds or transparency then only re-sends the
+// palette, and the image needs a quarter of the memory and upload bandwidth.
+//
 
 class RadarDrawShader : public RadarDraw {
  public:
-  RadarDrawShader(RadarInfo* ri) {
+  RadarDrawShader(RadarInfo* ri, bool palette = false) {
     m_ri = ri;
-    m_start_line = -1;  // No spokes received since last draw
-    m_lines = 0;
-    m_texture = 0;
-    m_fragment = 0;
-    m_vertex = 0;
-    m_program = 0;
-    m_format = GL_RGBA;
-    m_channels = SHADER_COLOR_CHANNELS;
+    m_generation = 0;
+    m_spoke_generation = 0;
+    CLEAR_STRUCT(m_contexts);
+    m_format = palette ? GL_LUMINANCE : GL_RGBA;
+    m_channels = palette ? 1 : SHADER_COLOR_CHANNELS;
+    CLEAR_STRUCT(m_palette);
+    m_palette_generation = 0;
+    m_alpha = 255;
     m_data = 0;
     m_spokes = 0;
     m_spoke_len_max = 0;
@@ -63,6 +79,17 @@ class RadarDrawShader : public RadarDraw {
   void ProcessRadarSpoke(int transparency, SpokeBearing angle, uint8_t* data, size_t len, GeoPosition spoke_pos);
 
  private:
+  struct ShaderContext {
+    void* context;        // Key as returned by GetCurrentGLContext(), or 0 when the slot is free
+    uint64_t generation;  // All rows up to this generation are in the texture
+    GLuint texture;
+    GLuint fragment;
+    GLuint vertex;
+    GLuint program;
+    GLuint palette;               // Palette texture, only when m_channels == 1
+    uint64_t palette_generation;  // m_palette_generation of the palette in that texture
+  };
+
   RadarInfo* m_ri;
 
   wxCriticalSection m_exclusive;  // protects the following data structures
@@ -70,17 +97,23 @@ class RadarDrawShader : public RadarDraw {
   size_t m_spokes;
   size_t m_spoke_len_max;
 
-  int m_start_line;  // First line received since last draw, or -1
-  int m_lines;       // # of lines received since last draw
+  uint64_t m_generation;         // Incremented for every spoke received
+  uint64_t* m_spoke_generation;  // [m_spokes] Generation at which each row was last written
 
   int m_format;
   int m_channels;
 
-  GLuint m_texture;
-  GLuint m_fragment;
-  GLuint m_vertex;
-  GLuint m_program;
+  GLubyte m_palette[SHADER_PALETTE_SIZE][SHADER_COLOR_CHANNELS];
+  uint64_t m_palette_generation;  // Incremented every time m_palette changes
+  GLubyte m_alpha;                // Alpha of the last spoke received
+
+  ShaderContext m_contexts[SHADER_CONTEXTS];
 
+  ShaderContext* GetContext();
+  bool InitContext(ShaderContext* sc);
+  void UploadRows(ShaderContext* sc);
+  void UpdatePalette();
+  void ResetContext(ShaderContext* sc);
   void Reset();
 };
 
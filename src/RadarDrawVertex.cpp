@@ -32,6 +32,11 @@
 #include "RadarDrawVertex.h"
 #include "RadarCanvas.h"
 #include "RadarInfo.h"
+#include "shaderutil.h"
+
+#if SPOKE_LEN_MAX * VERTEX_SUBPIXELS > 32767
+#error "Spokes too long for 16 bit vertex coordinates, lower VERTEX_SUBPIXELS"
+#endif
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -46,8 +51,25 @@ bool RadarDrawVertex::Init(size_t spokes, size_t spoke_len_max) {
 
   if (!m_vertices) {
     m_vertices = (VertexLine*)calloc(sizeof(VertexLine), m_spokes);
+    m_blobs_per_spoke = VERTEX_BLOBS_PER_SPOKE;
+    m_points = (VertexPoint*)malloc(m_spokes * m_blobs_per_spoke * VERTEX_PER_BLOB * sizeof(VertexPoint));
+    m_indices = (GLushort*)malloc(m_spokes * m_blobs_per_spoke * INDEX_PER_BLOB * sizeof(GLushort));
   }
-  if (!m_vertices) {
+  if (m_use_vbo) {
+    if (!GenBuffers || !BindBuffer || !BufferData || !BufferSubData || !DeleteBuffers || !MultiDrawElements) {
+      ShadersSupported();  // Loads the entry points; the shader ones are not needed here
+    }
+    if (!GenBuffers || !BindBuffer || !BufferData || !BufferSubData || !DeleteBuffers || !MultiDrawElements) {
+      wxLogError(wxT("radar_pi: the OpenGL system of this computer does not support vertex buffers"));
+      return false;
+    }
+    if (!m_draw_count) {
+      m_draw_count = (GLsizei*)malloc(m_spokes * sizeof(GLsizei));
+      m_draw_offset = (const GLvoid**)malloc(m_spokes * sizeof(const GLvoid*));
+    }
+  }
+  if (!m_vertices || !m_points || !m_indices || (m_use_vbo && (!m_draw_count || !m_draw_offset))) {
+    Reset();
     if (!m_oom) {
       wxLogError(wxT("radar_pi: Out of memory"));
       m_oom = true;
@@ -60,61 +82,131 @@ bool RadarDrawVertex::Init(size_t spokes, size_t spoke_len_max) {
 
 void RadarDrawVertex::Reset() {
   if (m_vertices) {
-    for (size_t i = 0; i < m_spokes; i++) {
-      if (m_vertices[i].points) {
-        free(m_vertices[i].points);
-      }
-    }
     free(m_vertices);
     m_vertices = 0;
   }
-}
-
-#define ADD_VERTEX_POINT(angle, radius, r, g, b, a)                         \
-  {                                                                         \
-    line->points[count].xy = m_ri->m_polar_lookup->GetPoint(angle, radius); \
-    line->points[count].red = r;                                            \
-    line->points[count].green = g;                                          \
-    line->points[count].blue = b;                                           \
-    line->points[count].alpha = a;                                          \
-    count++;                                                                \
+  if (m_points) {
+    free(m_points);
+    m_points = 0;
   }
-
-void RadarDrawVertex::SetBlob(VertexLine* line, int angle_begin, int angle_end, int r1, int r2, GLubyte red, GLubyte green,
-                              GLubyte blue, GLubyte alpha) {
-  if (r2 == 0) {
-    return;
+  if (m_indices) {
+    free(m_indices);
+    m_indices = 0;
   }
-  int arc1 = angle_begin % m_spokes;
-  int arc2 = angle_end % m_spokes;
-  size_t count = line->count;
+  m_blobs_per_spoke = 0;
 
-  if (line->count + VERTEX_PER_QUAD > line->allocated) {
-    const size_t extra = 8 * VERTEX_PER_QUAD;
-    line->points = (VertexPoint*)realloc(line->points, (line->allocated + extra) * sizeof(VertexPoint));
-    line->allocated += extra;
+  void* context = GetCurrentGLContext();
+  for (size_t i = 0; i < ARRAY_SIZE(m_contexts); i++) {
+    if (m_contexts[i].vbo[0] && m_contexts[i].context == context) {
+      DeleteBuffers(2, m_contexts[i].vbo);
+    }
+  }
+  // The buffers of other contexts can not be deleted from here, they go when their context goes.
+  CLEAR_STRUCT(m_contexts);
+  m_generation = 0;
+  if (m_upload) {
+    free(m_upload);
+    m_upload = 0;
+  }
+  m_upload_blobs_per_spoke = 0;
+  if (m_draw_count) {
+    free(m_draw_count);
+    m_draw_count = 0;
+  }
+  if (m_draw_offset) {
+    free(m_draw_offset);
+    m_draw_offset = 0;
   }
+}
+
+/*
+ * Double the room per spoke in both arenas, and move the spokes that have already
+ * been built to their new place.
+ */
+bool RadarDrawVertex::GrowArena() {
+  size_t blobs = m_blobs_per_spoke * 2;
+  VertexPoint* points = (VertexPoint*)malloc(m_spokes * blobs * VERTEX_PER_BLOB * sizeof(VertexPoint));
+  GLushort* indices = (GLushort*)malloc(m_spokes * blobs * INDEX_PER_BLOB * sizeof(GLushort));
 
-  if (!line->points) {
+  if (!points || !indices) {
+    free(points);
+    free(indices);
     if (!m_oom) {
       wxLogError(wxT("radar_pi: Out of memory"));
       m_oom = true;
     }
+    return false;
+  }
+  for (size_t i = 0; i < m_spokes; i++) {
+    memcpy(points + i * blobs * VERTEX_PER_BLOB, m_points + i * m_blobs_per_spoke * VERTEX_PER_BLOB,
+           m_vertices[i].count * sizeof(VertexPoint));
+    memcpy(indices + i * blobs * INDEX_PER_BLOB, m_indices + i * m_blobs_per_spoke * INDEX_PER_BLOB,
+           m_vertices[i].index_count * sizeof(GLushort));
+  }
+  free(m_points);
+  free(m_indices);
+  m_points = points;
+  m_indices = indices;
+  m_blobs_per_spoke = blobs;
+  LOG_VERBOSE(wxT("radar_pi: %s vertex arena grown to %u blobs per spoke"), m_ri->m_name.c_str(), (unsigned int)blobs);
+  return true;
+}
+
+#define ADD_VERTEX_POINT(angle, radius, r, g, b, a)                    \
+  {                                                                    \
+    Point xy = m_ri->m_polar_lookup->GetPoint(angle, radius);          \
+    points[count].x = (GLshort)floorf(xy.x * VERTEX_SUBPIXELS + 0.5f); \
+    points[count].y = (GLshort)floorf(xy.y * VERTEX_SUBPIXELS + 0.5f); \
+    points[count].red = r;                                             \
+    points[count].green = g;                                           \
+    points[count].blue = b;                                            \
+    points[count].alpha = a;                                           \
+    count++;                                                           \
+  }
+
+void RadarDrawVertex::SetBlob(VertexLine* line, SpokeBearing angle, int r1, int r2, GLubyte red, GLubyte green, GLubyte blue,
+                              GLubyte alpha) {
+  if (r2 == 0) {
     return;
   }
+  int arc1 = angle % m_spokes;
+  int arc2 = (angle + 1) % m_spokes;
 
-  // First triangle
-  ADD_VERTEX_POINT(arc1, r1, red, green, blue, alpha);
-  ADD_VERTEX_POINT(arc1, r2, red, green, blue, alpha);
-  ADD_VERTEX_POINT(arc2, r1, red, green, blue, alpha);
+  if (line->count + VERTEX_PER_BLOB > m_blobs_per_spoke * VERTEX_PER_BLOB ||
+      line->index_count + INDEX_PER_BLOB > m_blobs_per_spoke * INDEX_PER_BLOB) {
+    if (!GrowArena()) {
+      return;
+    }
+  }
 
-  // Second triangle
+  VertexPoint* points = m_points + angle * m_blobs_per_spoke * VERTEX_PER_BLOB;
+  GLushort* indices = m_indices + angle * m_blobs_per_spoke * INDEX_PER_BLOB + line->index_count;
+  size_t count = line->count;
 
-  ADD_VERTEX_POINT(arc2, r1, red, green, blue, alpha);
+  if (count == 0 || line->radius != r1) {
+    // Does not touch the previous blob, so it needs its own inner vertices
+    ADD_VERTEX_POINT(arc1, r1, red, green, blue, alpha);
+    ADD_VERTEX_POINT(arc2, r1, red, green, blue, alpha);
+  }
   ADD_VERTEX_POINT(arc1, r2, red, green, blue, alpha);
   ADD_VERTEX_POINT(arc2, r2, red, green, blue, alpha);
 
+  GLushort inner1 = (GLushort)(count - 4);
+  GLushort inner2 = (GLushort)(count - 3);
+  GLushort outer1 = (GLushort)(count - 2);
+  GLushort outer2 = (GLushort)(count - 1);
+
+  // Same two triangles as before, ordered so that the last vertex of each is at r2
+  indices[0] = inner1;
+  indices[1] = inner2;
+  indices[2] = outer1;
+  indices[3] = inner2;
+  indices[4] = outer1;
+  indices[5] = outer2;
+
   line->count = count;
+  line->index_count += INDEX_PER_BLOB;
+  line->radius = r2;
 }
 
 void RadarDrawVertex::ProcessRadarSpoke(int transparency, SpokeBearing angle, uint8_t* data, size_t len, GeoPosition spoke_pos) {
@@ -132,22 +224,9 @@ void RadarDrawVertex::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
   }
   VertexLine* line = &m_vertices[angle];
 
-  if (!line->points) {
-    static size_t INITIAL_ALLOCATION = 600;  // Empirically found to be enough for a complicated picture
-    line->allocated = INITIAL_ALLOCATION;
-    m_count += INITIAL_ALLOCATION;
-    line->points = (VertexPoint*)malloc(line->allocated * sizeof(VertexPoint));
-    if (!line->points) {
-      if (!m_oom) {
-        wxLogError(wxT("radar_pi: Out of memory"));
-        m_oom = true;
-      }
-      line->allocated = 0;
-      line->count = 0;
-      return;
-    }
-  }
   line->count = 0;
+  line->index_count = 0;
+  line->generation = ++m_generation;
   line->timeout = now + m_ri->m_pi->m_settings.max_age;
   line->spoke_pos = spoke_pos;
   for (size_t radius = 0; radius < len; radius++) {
@@ -166,7 +245,7 @@ void RadarDrawVertex::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
       red = m_ri->m_colour_map_rgb[previous_colour].Red();
       green = m_ri->m_colour_map_rgb[previous_colour].Green();
       blue = m_ri->m_colour_map_rgb[previous_colour].Blue();
-      SetBlob(line, angle, angle + 1, r_begin, r_end, red, green, blue, alpha);
+      SetBlob(line, angle, r_begin, r_end, red, green, blue, alpha);
       previous_colour = actual_colour;
       if (actual_colour != BLOB_NONE) {  // change of color, start new blob
         r_begin = radius;
@@ -178,7 +257,166 @@ void RadarDrawVertex::ProcessRadarSpoke(int transparency, SpokeBearing angle, ui
     red = m_ri->m_colour_map_rgb[previous_colour].Red();
     green = m_ri->m_colour_map_rgb[previous_colour].Green();
     blue = m_ri->m_colour_map_rgb[previous_colour].Blue();
-    SetBlob(line, angle, angle + 1, r_begin, r_end, red, green, blue, alpha);
+    SetBlob(line, angle, r_begin, r_end, red, green, blue, alpha);
+  }
+}
+
+size_t RadarDrawVertex::GetBytesPerRevolution() {
+  wxCriticalSectionLocker lock(m_exclusive);
+  size_t bytes = 0;
+
+  if (m_vertices) {
+    for (size_t i = 0; i < m_spokes; i++) {
+      bytes += m_vertices[i].count * sizeof(VertexPoint) + m_vertices[i].index_count * sizeof(GLushort);
+    }
+  }
+  return bytes;
+}
+
+void RadarDrawVertex::GetFrameStatistics(size_t* draw_calls, size_t* upload_bytes) {
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  *draw_calls = m_draw_calls;
+  *upload_bytes = m_upload_bytes;
+}
+
+/*
+ * Find the buffers of the OpenGL context that is current, or create them when this is the
+ * first time the object is drawn in it.
+ */
+RadarDrawVertex::VertexContext* RadarDrawVertex::GetContext() {
+  void* context = GetCurrentGLContext();
+  VertexContext* free_slot = 0;
+
+  for (size_t i = 0; i < ARRAY_SIZE(m_contexts); i++) {
+    if (m_contexts[i].vbo[0] && m_contexts[i].context == context) {
+      return &m_contexts[i];
+    }
+    if (!m_contexts[i].vbo[0] && !free_slot) {
+      free_slot = &m_contexts[i];
+    }
+  }
+  if (!free_slot) {
+    LOG_VERBOSE(wxT("radar_pi: %s vertex buffers drawn from more than %d OpenGL contexts"), m_ri->m_name.c_str(), VERTEX_CONTEXTS);
+    return 0;
+  }
+
+  CLEAR_STRUCT(*free_slot);
+  GenBuffers(2, free_slot->vbo);
+  if (!free_slot->vbo[0]) {
+    return 0;
+  }
+  free_slot->context = context;
+  return free_slot;
+}
+
+/*
+ * Copy the spokes that changed since this context last drew to its buffer objects. When the
+ * arena has grown since the buffers were sized, they are sized again and every spoke is sent.
+ */
+bool RadarDrawVertex::UploadSpokes(VertexContext* vc) {
+  size_t vertex_stride = m_blobs_per_spoke * VERTEX_PER_BLOB;
+  size_t index_stride = m_blobs_per_spoke * INDEX_PER_BLOB;
+  bool all = false;
+
+  if (m_upload_blobs_per_spoke != m_blobs_per_spoke) {
+    if (m_upload) {
+      free(m_upload);
+    }
+    m_upload = (GLuint*)malloc(index_stride * sizeof(GLuint));
+    if (!m_upload) {
+      if (!m_oom) {
+        wxLogError(wxT("radar_pi: Out of memory"));
+        m_oom = true;
+      }
+      m_upload_blobs_per_spoke = 0;
+      return false;
+    }
+    m_upload_blobs_per_spoke = m_blobs_per_spoke;
+  }
+
+  BindBuffer(GL_ARRAY_BUFFER, vc->vbo[0]);
+  BindBuffer(GL_ELEMENT_ARRAY_BUFFER, vc->vbo[1]);
+
+  if (vc->blobs_per_spoke != m_blobs_per_spoke) {
+    BufferData(GL_ARRAY_BUFFER, m_spokes * vertex_stride * sizeof(VertexPoint), 0, GL_DYNAMIC_DRAW);
+    BufferData(GL_ELEMENT_ARRAY_BUFFER, m_spokes * index_stride * sizeof(GLuint), 0, GL_DYNAMIC_DRAW);
+    vc->blobs_per_spoke = m_blobs_per_spoke;
+    all = true;
+    LOG_VERBOSE(wxT("radar_pi: %s vertex buffer sized for %u blobs per spoke"), m_ri->m_name.c_str(),
+                (unsigned int)m_blobs_per_spoke);
+  }
+
+  for (size_t i = 0; i < m_spokes; i++) {
+    VertexLine* line = &m_vertices[i];
+    if (!all && line->generation <= vc->generation) {
+      continue;
+    }
+    GLuint first = (GLuint)(i * vertex_stride);
+    GLushort* indices = m_indices + i * index_stride;
+    for (size_t n = 0; n < line->index_count; n++) {
+      m_upload[n] = first + indices[n];
+    }
+    BufferSubData(GL_ARRAY_BUFFER, i * vertex_stride * sizeof(VertexPoint), line->count * sizeof(VertexPoint),
+                  m_points + i * vertex_stride);
+    BufferSubData(GL_ELEMENT_ARRAY_BUFFER, i * index_stride * sizeof(GLuint), line->index_count * sizeof(GLuint), m_upload);
+    m_upload_bytes += line->count * sizeof(VertexPoint) + line->index_count * sizeof(GLuint);
+  }
+  vc->generation = m_generation;
+  return true;
+}
+
+bool RadarDrawVertex::BeginDraw() {
+  m_draw_calls = 0;
+  m_upload_bytes = 0;
+  m_draw_spokes = 0;
+  if (!m_vertices) {
+    return false;
+  }
+  if (m_use_vbo) {
+    VertexContext* vc = GetContext();
+    if (!vc || !UploadSpokes(vc)) {
+      return false;
+    }
+    glVertexPointer(2, GL_SHORT, sizeof(VertexPoint), (const GLvoid*)offsetof(VertexPoint, x));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexPoint), (const GLvoid*)offsetof(VertexPoint, red));
+  }
+  return true;
+}
+
+void RadarDrawVertex::DrawSpoke(size_t angle) {
+  if (m_use_vbo) {
+    // Collect the spoke, FlushSpokes draws all collected spokes at once
+    m_draw_count[m_draw_spokes] = m_vertices[angle].index_count;
+    m_draw_offset[m_draw_spokes] = (const GLvoid*)(angle * m_blobs_per_spoke * INDEX_PER_BLOB * sizeof(GLuint));
+    m_draw_spokes++;
+    return;
+  }
+
+  VertexPoint* points = m_points + angle * m_blobs_per_spoke * VERTEX_PER_BLOB;
+
+  glVertexPointer(2, GL_SHORT, sizeof(VertexPoint), &points[0].x);
+  glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexPoint), &points[0].red);
+  glDrawElements(GL_TRIANGLES, m_vertices[angle].index_count, GL_UNSIGNED_SHORT,
+                 m_indices + angle * m_blobs_per_spoke * INDEX_PER_BLOB);
+  m_draw_calls++;
+  m_upload_bytes += m_vertices[angle].count * sizeof(VertexPoint) + m_vertices[angle].index_count * sizeof(GLushort);
+}
+
+// Must be called before the model view matrix changes
+void RadarDrawVertex::FlushSpokes() {
+  if (m_draw_spokes > 0) {
+    MultiDrawElements(GL_TRIANGLES, m_draw_count, GL_UNSIGNED_INT, m_draw_offset, m_draw_spokes);
+    m_draw_calls++;
+    m_draw_spokes = 0;
+  }
+}
+
+void RadarDrawVertex::EndDraw() {
+  if (m_use_vbo) {
+    FlushSpokes();
+    BindBuffer(GL_ARRAY_BUFFER, 0);
+    BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   }
 }
 
@@ -191,6 +429,8 @@ void RadarDrawVertex::DrawRadarOverlayImage(double radar_scale, double panel_rot
   GetCanvasPixLL(m_ri->m_pi->m_vp, &boat_center, posi.lat, posi.lon);
   //  move display to the location where the spoke was recorded
 
+  glPushAttrib(GL_LIGHTING_BIT);  // Save the shade model
+  glShadeModel(GL_FLAT);
   glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_COLOR_ARRAY);
   time_t now = time(0);
@@ -198,33 +438,36 @@ void RadarDrawVertex::DrawRadarOverlayImage(double radar_scale, double panel_rot
   {
     wxCriticalSectionLocker lock(m_exclusive);
 
-    glPushMatrix();
-    glTranslated(boat_center.x, boat_center.y, 0);
-    glRotated(panel_rotate, 0.0, 0.0, 1.0);
-    glScaled(radar_scale, radar_scale, 1.);
-    for (size_t i = 0; i < m_spokes; i++) {
-      VertexLine* line = &m_vertices[i];
-      if (!line->count || TIMED_OUT(now, line->timeout)) {
-        continue;
-      }
-      if ((line->spoke_pos.lat != prev_pos.lat || line->spoke_pos.lon != prev_pos.lon)) {
-        prev_pos = line->spoke_pos;
-        GetCanvasPixLL(m_ri->m_pi->m_vp, &boat_center, line->spoke_pos.lat, line->spoke_pos.lon);
-        // move display to the location where the spoke was recorded
-        glPopMatrix();
-        glPushMatrix();
-        glTranslated(boat_center.x, boat_center.y, 0);
-        glRotated(panel_rotate, 0.0, 0.0, 1.0);
-        glScaled(radar_scale, radar_scale, 1.);
+    if (BeginDraw()) {
+      glPushMatrix();
+      glTranslated(boat_center.x, boat_center.y, 0);
+      glRotated(panel_rotate, 0.0, 0.0, 1.0);
+      glScaled(radar_scale / VERTEX_SUBPIXELS, radar_scale / VERTEX_SUBPIXELS, 1.);
+      for (size_t i = 0; i < m_spokes; i++) {
+        VertexLine* line = &m_vertices[i];
+        if (!line->index_count || TIMED_OUT(now, line->timeout)) {
+          continue;
+        }
+        if ((line->spoke_pos.lat != prev_pos.lat || line->spoke_pos.lon != prev_pos.lon)) {
+          FlushSpokes();
+          prev_pos = line->spoke_pos;
+          GetCanvasPixLL(m_ri->m_pi->m_vp, &boat_center, line->spoke_pos.lat, line->spoke_pos.lon);
+          // move display to the location where the spoke was recorded
+          glPopMatrix();
+          glPushMatrix();
+          glTranslated(boat_center.x, boat_center.y, 0);
+          glRotated(panel_rotate, 0.0, 0.0, 1.0);
+          glScaled(radar_scale / VERTEX_SUBPIXELS, radar_scale / VERTEX_SUBPIXELS, 1.);
+        }
+        DrawSpoke(i);
       }
-      glVertexPointer(2, GL_FLOAT, sizeof(VertexPoint), &line->points[0].xy);
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexPoint), &line->points[0].red);
-      glDrawArrays(GL_TRIANGLES, 0, line->count);
+      EndDraw();
+      glPopMatrix();
     }
-    glPopMatrix();
   }
   glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
   glDisableClientState(GL_COLOR_ARRAY);
+  glPopAttrib();
 }
 
 void RadarDrawVertex::DrawRadarPanelImage(double panel_scale, double panel_rotate) {
@@ -233,47 +476,52 @@ void RadarDrawVertex::DrawRadarPanelImage(double panel_scale, double panel_rotat
   double prev_offset_lat = 0.;
   double prev_offset_lon = 0.;
   GeoPosition radar_pos, line_pos;
+  glPushAttrib(GL_LIGHTING_BIT);  // Save the shade model
+  glShadeModel(GL_FLAT);
   glEnableClientState(GL_VERTEX_ARRAY);
   glEnableClientState(GL_COLOR_ARRAY);
   {
     wxCriticalSectionLocker lock(m_exclusive);
 
     time_t now = time(0);
-    glPushMatrix();
-    glRotated(panel_rotate, 0.0, 0.0, 1.0);
-    glScaled(panel_scale, panel_scale, 1.);
-    for (size_t i = 0; i < m_spokes; i++) {
-      VertexLine* line = &m_vertices[i];
-      if (!line->count || TIMED_OUT(now, line->timeout)) {
-        continue;
-      }
-      line_pos = line->spoke_pos;
-
-      // In the scaling used, a translation of 1. corresponds to the distance from center to the edge of the image
-      // that is a distance of m_range.GetValue() / m_ri->m_panel_zoom
-      // that means, a distance of 1 meter corresponds to a ranslation of m_ri->m_panel_zoom / m_range.GetValue() units
-      if (m_ri->GetRadarPosition(&radar_pos)) {
-        offset_lat = (line_pos.lat - radar_pos.lat) * 60. * 1852. * m_ri->m_panel_zoom / m_ri->m_range.GetValue();
-        offset_lon = (line_pos.lon - radar_pos.lon) * 60. * 1852. * cos(deg2rad(line_pos.lat)) * m_ri->m_panel_zoom /
-                     m_ri->m_range.GetValue();
-        if (offset_lat != prev_offset_lat || offset_lon != prev_offset_lon) {
-          prev_offset_lat = offset_lat;
-          prev_offset_lon = offset_lon;
-          glPopMatrix();
-          glPushMatrix();
-          glRotated(panel_rotate, 0.0, 0.0, 1.0);
-          glTranslated(offset_lat, offset_lon, 0);
-          glScaled(panel_scale, panel_scale, 1.);
+    if (BeginDraw()) {
+      glPushMatrix();
+      glRotated(panel_rotate, 0.0, 0.0, 1.0);
+      glScaled(panel_scale / VERTEX_SUBPIXELS, panel_scale / VERTEX_SUBPIXELS, 1.);
+      for (size_t i = 0; i < m_spokes; i++) {
+        VertexLine* line = &m_vertices[i];
+        if (!line->index_count || TIMED_OUT(now, line->timeout)) {
+          continue;
+        }
+        line_pos = line->spoke_pos;
+
+        // In the scaling used, a translation of 1. corresponds to the distance from center to the edge of the image
+        // that is a distance of m_range.GetValue() / m_ri->m_panel_zoom
+        // that means, a distance of 1 meter corresponds to a ranslation of m_ri->m_panel_zoom / m_range.GetValue() units
+        if (m_ri->GetRadarPosition(&radar_pos)) {
+          offset_lat = (line_pos.lat - radar_pos.lat) * 60. * 1852. * m_ri->m_panel_zoom / m_ri->m_range.GetValue();
+          offset_lon = (line_pos.lon - radar_pos.lon) * 60. * 1852. * cos(deg2rad(line_pos.lat)) * m_ri->m_panel_zoom /
+                       m_ri->m_range.GetValue();
+          if (offset_lat != prev_offset_lat || offset_lon != prev_offset_lon) {
+            FlushSpokes();
+            prev_offset_lat = offset_lat;
+            prev_offset_lon = offset_lon;
+            glPopMatrix();
+            glPushMatrix();
+            glRotated(panel_rotate, 0.0, 0.0, 1.0);
+            glTranslated(offset_lat, offset_lon, 0);
+            glScaled(panel_scale / VERTEX_SUBPIXELS, panel_scale / VERTEX_SUBPIXELS, 1.);
+          }
         }
+        DrawSpoke(i);
       }
-      glVertexPointer(2, GL_FLOAT, sizeof(VertexPoint), &line->points[0].xy);
-      glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(VertexPoint), &line->points[0].red);
-      glDrawArrays(GL_TRIANGLES, 0, line->count);
+      EndDraw();
+      glPopMatrix();
     }
-    glPopMatrix();
   }
   glDisableClientState(GL_VERTEX_ARRAY);  // disable vertex arrays
   glDisableClientState(GL_COLOR_ARRAY);
+  glPopAttrib();
 }
 
 PLUGIN_END_NAMESPACE
@@ -38,15 +38,50 @@
 PLUGIN_BEGIN_NAMESPACE
 
 #define BUFFER_SIZE (2000000)
+#define VERTEX_BLOBS_PER_SPOKE (100)        // Initial arena size per spoke, empirically enough for a complicated picture
+#define VERTEX_SUBPIXELS (16)               // Vertex coordinates are in 1/16th of a spoke pixel
+#define VERTEX_CONTEXTS (MAX_CHART_CANVAS)  // OpenGL contexts that can draw the same object
+
+//
+// Each spoke is drawn as one indexed triangle list. A blob (a run of equal colour) is a quad
+// between two radii. The two vertices at a radius are shared by the blob that ends there and
+// the blob that starts there, so a run of touching blobs needs two vertices per blob instead
+// of six. Coordinates are stored as 16 bit fixed point, so a vertex takes 8 bytes instead of
+// 12. Drawing is done with flat shading, where the last vertex of a triangle gives the
+// colour, and the vertices at the outer radius of a blob hold its colour.
+//
+// The vertices and indices of all spokes live in two arenas with a fixed stride per spoke,
+// so no memory is allocated per spoke. When a spoke needs more room the stride is doubled.
+//
+// With use_vbo ("Vertex Buffer" drawing method) the arenas are mirrored in two OpenGL buffer
+// objects with the same layout. Each frame only the spokes that changed since the previous
+// frame are uploaded, and all spokes that share a position are drawn with one
+// glMultiDrawElements call, instead of sending every spoke from client memory every frame.
+// Every OpenGL context that draws the object, such as the overlay on two chart canvases that
+// do not share their context, has its own buffers. Each spoke carries the generation at which
+// it was last built, and each context remembers the generation it has uploaded up to.
+//
 
 class RadarDrawVertex : public RadarDraw {
  public:
-  RadarDrawVertex(RadarInfo* ri) {
+  RadarDrawVertex(RadarInfo* ri, bool use_vbo = false) {
     wxCriticalSectionLocker lock(m_exclusive);
 
     m_ri = ri;
+    m_use_vbo = use_vbo;
+    CLEAR_STRUCT(m_contexts);
+    m_generation = 0;
+    m_upload = 0;
+    m_upload_blobs_per_spoke = 0;
+    m_draw_count = 0;
+    m_draw_offset = 0;
+    m_draw_spokes = 0;
+    m_draw_calls = 0;
+    m_upload_bytes = 0;
     m_vertices = 0;
-    m_count = 0;
+    m_points = 0;
+    m_indices = 0;
+    m_blobs_per_spoke = 0;
     m_oom = false;
     m_spokes = 0;
     m_spoke_len_max = 0;
@@ -57,6 +92,12 @@ class RadarDrawVertex : public RadarDraw {
   void DrawRadarPanelImage(double panel_scale, double panel_rotate);
   void ProcessRadarSpoke(int transparency, SpokeBearing angle, uint8_t* data, size_t len, GeoPosition spoke_pos);
 
+  // Bytes of vertex and index data that one revolution sends to the GPU
+  size_t GetBytesPerRevolution();
+
+  // Draw calls made and bytes sent to the GPU by the last DrawRadar...Image call
+  void GetFrameStatistics(size_t* draw_calls, size_t* upload_bytes);
+
   ~RadarDrawVertex() {
     wxCriticalSectionLocker lock(m_exclusive);
 
@@ -68,12 +109,13 @@ class RadarDrawVertex : public RadarDraw {
   size_t m_spokes;
   size_t m_spoke_len_max;
 
-  static const int VERTEX_PER_TRIANGLE = 3;
-  static const int VERTEX_PER_QUAD = 2 * VERTEX_PER_TRIANGLE;
-  static const int MAX_BLOBS_PER_LINE = SPOKE_LEN_MAX;
+  static const int VERTEX_PER_RADIUS = 2;
+  static const int VERTEX_PER_BLOB = 2 * VERTEX_PER_RADIUS;  // when it does not touch the previous blob
+  static const int INDEX_PER_BLOB = 6;                       // two triangles
 
   struct VertexPoint {
-    Point xy;
+    GLshort x;
+    GLshort y;
     GLubyte red;
     GLubyte green;
     GLubyte blue;
@@ -81,21 +123,48 @@ class RadarDrawVertex : public RadarDraw {
   };
 
   struct VertexLine {
-    VertexPoint* points;
     time_t timeout;
-    size_t count;
-    size_t allocated;
+    size_t count;         // vertices used
+    size_t index_count;   // indices used
+    int radius;           // radius of the last two vertices
+    uint64_t generation;  // m_generation when it was last built
     GeoPosition spoke_pos;
   };
 
-  void SetBlob(VertexLine* line, int angle_begin, int angle_end, int r1, int r2, GLubyte red, GLubyte green, GLubyte blue,
-               GLubyte alpha);
+  struct VertexContext {
+    void* context;           // Key as returned by GetCurrentGLContext()
+    uint64_t generation;     // All spokes up to this generation are in the buffers
+    GLuint vbo[2];           // vertices, indices; 0 when the slot is free
+    size_t blobs_per_spoke;  // stride of the arenas when the buffers were sized
+  };
+
+  void SetBlob(VertexLine* line, SpokeBearing angle, int r1, int r2, GLubyte red, GLubyte green, GLubyte blue, GLubyte alpha);
+  bool GrowArena();
+  bool BeginDraw();
+  void DrawSpoke(size_t angle);
+  void FlushSpokes();
+  void EndDraw();
+  VertexContext* GetContext();
+  bool UploadSpokes(VertexContext* vc);
 
   void Reset();
   wxCriticalSection m_exclusive;  // protects the following
   VertexLine* m_vertices;
-  unsigned int m_count;
+  VertexPoint* m_points;     // m_spokes * VERTEX_PER_BLOB * m_blobs_per_spoke
+  GLushort* m_indices;       // m_spokes * INDEX_PER_BLOB * m_blobs_per_spoke
+  size_t m_blobs_per_spoke;  // stride of the arenas
   bool m_oom;
+
+  bool m_use_vbo;
+  VertexContext m_contexts[VERTEX_CONTEXTS];
+  uint64_t m_generation;            // Incremented for every spoke built
+  GLuint* m_upload;                 // indices of one spoke, made relative to the whole buffer
+  size_t m_upload_blobs_per_spoke;  // stride of the arenas when m_upload was sized
+  GLsizei* m_draw_count;            // per spoke index count and offset for glMultiDrawElements
+  const GLvoid** m_draw_offset;
+  GLsizei m_draw_spokes;
+  size_t m_draw_calls;
+  size_t m_upload_bytes;
 };
 
 PLUGIN_END_NAMESPACE
@@ -30,6 +30,8 @@
  */
 
 #include "RadarInfo.h"
+#include "BlobLabeller.h"
+#include "ClutterMap.h"
 #include "ControlsDialog.h"
 #include "GuardZone.h"
 #include "MessageBox.h"
@@ -38,12 +40,30 @@
 #include "RadarFactory.h"
 #include "RadarMarpa.h"
 #include "RadarPanel.h"
+#include "RadarProcess.h"
 #include "RadarReceive.h"
+#include "RadarSnapshot.h"
+#include "ScanFilter.h"
 #include "TrailBuffer.h"
 #include "drawutil.h"
+#include "replay/ReplayReceive.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
+#ifdef RADAR_SPOKE_TIMING
+// Per stage timing of ProcessRadarSpoke, only compiled into radar_bench
+#define SPOKE_TIMING_START() std::chrono::steady_clock::time_point stage_mark = std::chrono::steady_clock::now()
+#define SPOKE_TIMING_STAGE(stage)                                                                                          \
+  {                                                                                                                        \
+    std::chrono::steady_clock::time_point stage_now = std::chrono::steady_clock::now();                                    \
+    m_spoke_timing.nanos[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(stage_now - stage_mark).count(); \
+    stage_mark = stage_now;                                                                                                \
+  }
+#else
+#define SPOKE_TIMING_START()
+#define SPOKE_TIMING_STAGE(stage)
+#endif
+
 bool g_first_render = true;
 
 /**
@@ -61,8 +81,6 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   m_timed_idle.Update(1, RCS_OFF);
   m_course_index = 0;
   m_old_range = 0;
-  m_dir_lat = 0;
-  m_dir_lon = 0;
   m_pixels_per_meter = 0.;
   m_previous_auto_range_meters = 0;
   m_previous_orientation = ORIENTATION_HEAD_UP;
@@ -70,6 +88,13 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   m_radar_timeout = 0;
   m_data_timeout = 0;
   m_history = 0;
+  m_history_planes = 0;
+  m_history_words = 0;
+  m_blobs = 0;
+  m_clutter = 0;
+  m_clutter_on = false;
+  m_scan_filter = 0;
+  m_snapshot = 0;
   m_polar_lookup = 0;
   m_spokes = 0;
   m_spoke_len_max = 0;
@@ -79,8 +104,10 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   m_showManualValueInAuto = false;
   m_timed_idle_hardware = false;
   m_status_text_hide = false;
-  CLEAR_STRUCT(m_statistics);
   CLEAR_STRUCT(m_course_log);
+#ifdef RADAR_SPOKE_TIMING
+  CLEAR_STRUCT(m_spoke_timing);
+#endif
 
   m_mouse_pos.lat = NAN;
   m_mouse_pos.lon = NAN;
@@ -94,6 +121,7 @@ RadarInfo::RadarInfo(radar_pi *pi, int radar) {
   }
   m_control = 0;
   m_receive = 0;
+  m_process = 0;
   m_draw_panel.draw = 0;
   m_draw_overlay.draw = 0;
   m_draw_time_ms = 1000;  // Assume really bad draw time until we actually measure it to prevent fast redraw at start
@@ -156,6 +184,15 @@ void RadarInfo::Shutdown() {
     m_receive = 0;
   }
 
+  // Stop processing after the receive thread is gone, so nobody queues spokes anymore
+  if (m_process) {
+    m_process->Shutdown();
+    m_process->Wait();
+    LOG_VERBOSE(wxT("radar_pi: %s process thread stopped"), m_name.c_str());
+    delete m_process;
+    m_process = 0;
+  }
+
   if (m_control_dialog) {
     delete m_control_dialog;
     m_control_dialog = 0;
@@ -193,6 +230,9 @@ RadarInfo::~RadarInfo() {
     delete m_arpa;
     m_arpa = 0;
   }
+  if (m_snapshot) {
+    SaveSnapshot();
+  }
   if (m_trails) {
     delete m_trails;
     m_trails = 0;
@@ -205,13 +245,27 @@ RadarInfo::~RadarInfo() {
   }
 
   if (m_history) {
-    for (size_t i = 0; i < m_spokes; i++) {
-      if (m_history[i].line) {
-        free(m_history[i].line);
-      }
-    }
     free(m_history);
   }
+  if (m_history_planes && !m_snapshot) {
+    free(m_history_planes);
+  }
+  if (m_blobs) {
+    delete m_blobs;
+    m_blobs = 0;
+  }
+  if (m_clutter) {
+    delete m_clutter;
+    m_clutter = 0;
+  }
+  if (m_scan_filter) {
+    delete m_scan_filter;
+    m_scan_filter = 0;
+  }
+  if (m_snapshot) {
+    delete m_snapshot;
+    m_snapshot = 0;
+  }
 }
 
 /**
@@ -224,16 +278,8 @@ RadarInfo::~RadarInfo() {
 bool RadarInfo::Init() {
   m_verbose = M_SETTINGS.verbose;
   m_name = RadarTypeName[m_radar_type];
-  m_spokes = RadarSpokes[m_radar_type];
-  m_spoke_len_max = RadarSpokeLenMax[m_radar_type];
 
-  m_history = (line_history *)calloc(sizeof(line_history), m_spokes);
-  for (size_t i = 0; i < m_spokes; i++) {
-    m_history[i].line = (uint8_t *)calloc(sizeof(uint8_t), m_spoke_len_max);
-  }
-  m_polar_lookup = new PolarToCartesianLookup(m_spokes, m_spoke_len_max);
-
-  ComputeColourMap();
+  InitSpokeProcessing();
 
   if (!m_control) {
     m_control = RadarFactory::MakeRadarControl(m_radar_type);
@@ -258,17 +304,26 @@ bool RadarInfo::Init() {
       return false;
     }
   }
-  if (!m_arpa) {
-    m_arpa = new RadarArpa(m_pi, this);
-  }
-  m_trails = new TrailBuffer(this, m_spokes, m_spoke_len_max);
-  ComputeTargetTrails();
 
   UpdateControlState(true);
 
+  if (!m_process) {
+    m_process = new RadarProcess(m_pi, this);
+    if (m_process->Run() != wxTHREAD_NO_ERROR) {
+      LOG_INFO(wxT("radar_pi: %s unable to start process thread, processing spokes in receive thread"), m_name.c_str());
+      delete m_process;
+      m_process = 0;
+    }
+  }
+
   if (!m_receive) {
     LOG_RECEIVE(wxT("radar_pi: %s starting receive thread"), m_name.c_str());
     m_receive = RadarFactory::MakeRadarReceive(m_radar_type, m_pi, this);
+    if (!M_SETTINGS.replay_file[m_radar].IsEmpty()) {
+      LOG_INFO(wxT("radar_pi: %s replaying %s at speed %g"), m_name.c_str(), M_SETTINGS.replay_file[m_radar].c_str(),
+               M_SETTINGS.replay_speed);
+      m_receive = new ReplayReceive(m_pi, this, m_receive, M_SETTINGS.replay_file[m_radar], M_SETTINGS.replay_speed);
+    }
     if (!m_receive || (m_receive->Run() != wxTHREAD_NO_ERROR)) {
       LOG_INFO(wxT("radar_pi: %s unable to start receive thread."), m_name.c_str());
       if (m_receive) {
@@ -281,6 +336,92 @@ bool RadarInfo::Init() {
   return true;
 }
 
+/**
+ * Allocate everything that ProcessRadarSpoke needs for the current radar type.
+ *
+ * This does not touch any windows or OpenGL state, so radar_bench uses it as well.
+ */
+void RadarInfo::InitSpokeProcessing() {
+  m_spokes = RadarSpokes[m_radar_type];
+  m_spoke_len_max = RadarSpokeLenMax[m_radar_type];
+
+  if (m_snapshot && !m_snapshot->Matches(m_radar_type, m_spokes, m_spoke_len_max)) {
+    delete m_snapshot;
+    m_snapshot = 0;
+  }
+  if (!m_snapshot && !M_SETTINGS.snapshot_file[m_radar].IsEmpty()) {
+    m_snapshot = new RadarSnapshot;
+    if (!m_snapshot->Open(M_SETTINGS.snapshot_file[m_radar], m_radar_type, m_spokes, m_spoke_len_max)) {
+      delete m_snapshot;
+      m_snapshot = 0;
+    }
+  }
+
+  m_history_words = HISTORY_WORDS(m_spoke_len_max);
+  m_history = (line_history *)calloc(sizeof(line_history), m_spokes);
+  if (m_snapshot) {
+    m_history_planes = m_snapshot->GetHistoryPlanes();
+  } else {
+    m_history_planes = (HistoryWord *)calloc(sizeof(HistoryWord), m_spokes * 2 * m_history_words);
+  }
+  if (m_blobs) {
+    delete m_blobs;
+  }
+  m_blobs = new BlobLabeller(m_spokes, m_spoke_len_max);
+  if (m_clutter) {
+    delete m_clutter;
+  }
+  m_clutter = new ClutterMap(m_spokes, m_spoke_len_max);
+  if (m_scan_filter) {
+    delete m_scan_filter;
+  }
+  m_scan_filter = new ScanFilter(m_spokes, m_spoke_len_max);
+  if (!m_history || !m_history_planes || !m_blobs->IsAllocated() || !m_clutter->IsAllocated() ||
+      !m_scan_filter->IsAllocated()) {
+    wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+    wxAbort();
+  }
+  for (size_t i = 0; i < m_spokes; i++) {
+    m_history[i].echo = m_history_planes + i * 2 * m_history_words;
+    m_history[i].unclaimed = m_history[i].echo + m_history_words;
+  }
+  if (m_snapshot && m_snapshot->IsRestored()) {
+    SnapshotSpoke *spokes = m_snapshot->GetSpokes();
+    for (size_t i = 0; i < m_spokes; i++) {
+      m_history[i].time = wxLongLong(spokes[i].time);
+      m_history[i].pos.lat = spokes[i].lat;
+      m_history[i].pos.lon = spokes[i].lon;
+    }
+    m_pixels_per_meter = m_snapshot->GetHeader()->pixels_per_meter;
+    LOG_INFO(wxT("radar_pi: %s continues from snapshot %s"), m_name.c_str(), M_SETTINGS.snapshot_file[m_radar].c_str());
+  }
+  m_polar_lookup = new PolarToCartesianLookup(m_spokes, m_spoke_len_max);
+
+  ComputeColourMap();
+
+  if (!m_arpa) {
+    m_arpa = new RadarArpa(m_pi, this);
+  }
+  m_trails = new TrailBuffer(this, m_spokes, m_spoke_len_max);
+  ComputeTargetTrails();
+}
+
+// Writes what is not kept in the snapshot all along. The history planes and
+// the relative trails are already there.
+void RadarInfo::SaveSnapshot() {
+  SnapshotSpoke *spokes = m_snapshot->GetSpokes();
+
+  for (size_t i = 0; i < m_spokes; i++) {
+    spokes[i].time = m_history[i].time.GetValue();
+    spokes[i].lat = m_history[i].pos.lat;
+    spokes[i].lon = m_history[i].pos.lon;
+  }
+  if (m_trails) {
+    m_trails->SaveSnapshot(m_snapshot);
+  }
+  m_snapshot->Close();
+}
+
 void RadarInfo::ShowControlDialog(bool show, bool reparent) {
   if (show) {
     wxPoint panel_pos = wxDefaultPosition;
@@ -392,8 +533,11 @@ void RadarInfo::ResetSpokes() {
   LOG_VERBOSE(wxT("radar_pi: reset spokes"));
 
   CLEAR_STRUCT(zap);
+  memset(m_history_planes, 0, m_spokes * 2 * m_history_words * sizeof(HistoryWord));
+  m_blobs->Clear();
+  m_clutter->Clear();
+  m_scan_filter->Clear();
   for (size_t i = 0; i < m_spokes; i++) {
-    memset(m_history[i].line, 0, m_spoke_len_max);
     m_history[i].time = 0;
     m_history[i].pos.lat = 0.;
     m_history[i].pos.lon = 0.;
@@ -427,9 +571,36 @@ void RadarInfo::ResetSpokes() {
  * @param range                 Range (in meters) of this data
  * @param time_rec              Time at this moment
  */
+/*
+ * QueueRadarSpoke
+ *
+ * Called by the receive threads for every decoded spoke. Hands the spoke to the
+ * RadarProcess thread without taking any lock, so socket reads never wait for the
+ * render thread. Only when there is no process thread is the spoke processed here,
+ * and ARPA swept up to its bearing.
+ */
+void RadarInfo::QueueRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters,
+                                wxLongLong time_rec) {
+  if (m_process) {
+    m_process->QueueSpoke(angle, bearing, data, len, range_meters, time_rec);
+    return;
+  }
+
+  {
+    wxCriticalSectionLocker lock(m_exclusive);
+    ProcessRadarSpoke(angle, bearing, data, len, range_meters, time_rec);
+  }
+
+  // As RadarProcess::Entry, outside m_exclusive as the ARPA lock must be taken first
+  if (m_arpa) {
+    m_arpa->SweepTo(bearing);
+  }
+}
+
 void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters,
                                   wxLongLong time_rec) {
   int orientation;
+  SPOKE_TIMING_START();
 
   // calculate course as the moving average of m_hdt over one revolution
   SampleCourse(angle);  // used for course_up mode
@@ -479,22 +650,52 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint
   int stabilized_mode = orientation != ORIENTATION_HEAD_UP;
   uint8_t weakest_normal_blob = m_pi->m_settings.threshold_red;
 
-  uint8_t *hist_data = m_history[bearing].line;
-  m_history[bearing].time = time_rec;
-  memset(hist_data, 0, m_spoke_len_max);
-  GetRadarPosition(&m_history[bearing].pos);
-  for (size_t radius = 0; radius < len; radius++) {
-    if (data[radius] >= weakest_normal_blob) {
-      // and add 1 if above threshold and set the left 2 bits, used for ARPA
-      hist_data[radius] = 192;
+  // Everything from here on, ARPA and the guard zones included, sees the filtered spoke
+  m_scan_filter->ProcessSpoke(bearing, data, len, M_SETTINGS.scan_filter);
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_SCAN_FILTER);
+
+  // The clutter map starts afresh when it is switched on, as it missed the spokes since
+  bool adaptive = M_SETTINGS.adaptive_threshold;
+  if (adaptive) {
+    if (!m_clutter_on) {
+      m_clutter->Clear();
     }
+    m_clutter->ProcessSpoke(bearing, data, len);
+  }
+  m_clutter_on = adaptive;
+
+  line_history *hist = &m_history[bearing];
+  hist->time = time_rec;
+  GetRadarPosition(&hist->pos);
+  // Both bit planes used for ARPA start out with all echoes
+  if (adaptive) {
+    HistoryPackAdaptive(hist->echo, m_history_words, data, len, weakest_normal_blob, m_clutter->GetThresholds());
+  } else {
+    HistoryPack(hist->echo, m_history_words, data, len, weakest_normal_blob);
   }
+  memcpy(hist->unclaimed, hist->echo, m_history_words * sizeof(HistoryWord));
+  // A contour of more than m_min_contour_length steps surrounds at least this many samples
+  m_blobs->ProcessSpoke(bearing, hist->echo, len, time_rec, m_min_contour_length / 2 + 2);
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_HISTORY);
 
+  // All guard zones count the same strong samples, so find these once
+  HistoryWord strong[HISTORY_WORDS(SPOKE_LEN_MAX)];
+  bool strong_packed = false;
   for (size_t z = 0; z < GUARD_ZONES; z++) {
     if (m_guard_zone[z]->m_alarm_on) {
-      m_guard_zone[z]->ProcessSpoke(angle, data, m_history[bearing].line, len);
+      if (!strong_packed) {
+        if (adaptive) {
+          HistoryPackAdaptive(strong, HISTORY_WORDS(len), data, len, (uint8_t)m_pi->m_settings.threshold_blue,
+                              m_clutter->GetThresholds());
+        } else {
+          HistoryPack(strong, HISTORY_WORDS(len), data, len, (uint8_t)m_pi->m_settings.threshold_blue);
+        }
+        strong_packed = true;
+      }
+      m_guard_zone[z]->ProcessSpoke(angle, data, strong, len);
     }
   }
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_GUARD_ZONES);
 
   size_t trail_len = len;
   if (m_pi->m_settings.show_extreme_range) {
@@ -506,14 +707,17 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint
   if (m_draw_overlay.draw && !draw_trails_on_overlay) {
     m_draw_overlay.draw->ProcessRadarSpoke(M_SETTINGS.overlay_transparency.GetValue(), bearing, data, len, m_history[bearing].pos);
   }
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_DRAW);
 
   m_trails->UpdateTrailPosition();
 
   // True trails
   m_trails->UpdateTrueTrails(bearing, data, trail_len);
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_TRUE_TRAILS);
 
   // Relative trails
   m_trails->UpdateRelativeTrails(angle, data, trail_len);
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_RELATIVE_TRAILS);
 
   if (m_draw_overlay.draw && draw_trails_on_overlay) {
     m_draw_overlay.draw->ProcessRadarSpoke(M_SETTINGS.overlay_transparency.GetValue(), bearing, data, len, m_history[bearing].pos);
@@ -522,6 +726,10 @@ void RadarInfo::ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint
   if (m_draw_panel.draw) {
     m_draw_panel.draw->ProcessRadarSpoke(4, stabilized_mode ? bearing : angle, data, len, m_history[bearing].pos);
   }
+  SPOKE_TIMING_STAGE(SPOKE_STAGE_DRAW);
+#ifdef RADAR_SPOKE_TIMING
+  m_spoke_timing.spokes++;
+#endif
 }
 
 void RadarInfo::SampleCourse(int angle) {
@@ -624,25 +832,42 @@ void RadarInfo::RenderGuardZone() {
 
   for (size_t z = 0; z < GUARD_ZONES; z++) {
     if (m_guard_zone[z]->m_alarm_on || m_guard_zone[z]->m_arpa_on || m_guard_zone[z]->m_show_time + 5 > time(0)) {
-      if (m_guard_zone[z]->m_type == GZ_CIRCLE) {
-        start_bearing = 0;
-        end_bearing = 359;
+      if (m_guard_zone[z]->m_type == GZ_POLYGON) {
+        // A polygon may be concave, so it is drawn as an outline within the ring of its ranges
+        double ahead[GUARD_ZONE_VERTICES];
+        double starboard[GUARD_ZONE_VERTICES];
+        int corners = m_guard_zone[z]->GetPolygonLocal(ahead, starboard);
+
+        glColor4ub(red, green, blue, 255);
+        glLineWidth(2.0);
+        glBegin(GL_LINE_LOOP);
+        for (int i = 0; i < corners; i++) {
+          glVertex2f(ahead[i], starboard[i]);
+        }
+        glEnd();
+        glColor4ub(red, green, blue, alpha);
+        DrawOutlineArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, 0, 360, false);
       } else {
-        start_bearing = m_guard_zone[z]->m_start_bearing;
-        end_bearing = m_guard_zone[z]->m_end_bearing;
-      }
-      switch (m_pi->m_settings.guard_zone_render_style) {
-        case 1:
-          glColor4ub((GLubyte)255, (GLubyte)0, (GLubyte)0, (GLubyte)255);
-          DrawOutlineArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, start_bearing, end_bearing, true);
-          break;
-        case 2:
-          glColor4ub(red, green, blue, alpha);
-          DrawOutlineArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, start_bearing, end_bearing, false);
-        // fall thru
-        default:
-          glColor4ub(red, green, blue, alpha);
-          DrawFilledArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, start_bearing, end_bearing);
+        if (m_guard_zone[z]->m_type == GZ_CIRCLE) {
+          start_bearing = 0;
+          end_bearing = 359;
+        } else {
+          start_bearing = m_guard_zone[z]->m_start_bearing;
+          end_bearing = m_guard_zone[z]->m_end_bearing;
+        }
+        switch (m_pi->m_settings.guard_zone_render_style) {
+          case 1:
+            glColor4ub((GLubyte)255, (GLubyte)0, (GLubyte)0, (GLubyte)255);
+            DrawOutlineArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, start_bearing, end_bearing, true);
+            break;
+          case 2:
+            glColor4ub(red, green, blue, alpha);
+            DrawOutlineArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, start_bearing, end_bearing, false);
+          // fall thru
+          default:
+            glColor4ub(red, green, blue, alpha);
+            DrawFilledArc(m_guard_zone[z]->m_outer_range, m_guard_zone[z]->m_inner_range, start_bearing, end_bearing);
+        }
       }
     }
 
@@ -822,7 +1047,16 @@ void RadarInfo::UpdateControlState(bool all) {
   }
 }
 
+/*
+ * ResetRadarImage
+ *
+ * Called by the receive threads when no spokes come in. The spokes are processed on the
+ * RadarProcess thread, so the history, trails and filters that this clears are only
+ * touched with m_exclusive held, as RadarProcess::Entry does around ProcessRadarSpoke.
+ */
 void RadarInfo::ResetRadarImage() {
+  wxCriticalSectionLocker lock(m_exclusive);
+
   ResetSpokes();
   ClearTrails();
   if (m_arpa) {
@@ -841,21 +1075,24 @@ void RadarInfo::RefreshDisplay() {
   }
 }
 
-void RadarInfo::RenderRadarImage2(DrawInfo *di, double radar_scale, double panel_rotate) {
+/**
+ * Make sure that the draw object for the overlay or the panel exists and uses
+ * the configured drawing method.
+ *
+ * Called on GUI thread, and by radar_bench. The latter has no OpenGL context,
+ * so it can only use the vertex method.
+ */
+bool RadarInfo::PrepareDraw(bool overlay) {
   wxCriticalSectionLocker lock(m_exclusive);
+  DrawInfo *di = overlay ? &m_draw_overlay : &m_draw_panel;
   int drawing_method = m_pi->m_settings.drawing_method;
-  int state = m_state.GetValue();
-
-  if (state != RADAR_TRANSMIT) {
-    return;
-  }
 
   // Determine if a new draw method is required
   if (!di->draw || (drawing_method != di->drawing_method)) {
     RadarDraw *newDraw = RadarDraw::make_Draw(this, drawing_method);
     if (!newDraw) {
       wxLogError(wxT("radar_pi: out of memory"));
-      return;
+      return false;
     } else if (newDraw->Init(m_spokes, m_spoke_len_max)) {
       wxArrayString methods;
       RadarDraw::GetDrawingMethods(methods);
@@ -873,9 +1110,20 @@ void RadarInfo::RenderRadarImage2(DrawInfo *di, double radar_scale, double panel
       m_pi->m_settings.drawing_method = 0;
       delete newDraw;
     }
-    if (!di->draw) {
-      return;
-    }
+  }
+  return di->draw != 0;
+}
+
+void RadarInfo::RenderRadarImage2(DrawInfo *di, double radar_scale, double panel_rotate) {
+  wxCriticalSectionLocker lock(m_exclusive);
+  int state = m_state.GetValue();
+
+  if (state != RADAR_TRANSMIT) {
+    return;
+  }
+
+  if (!PrepareDraw(di == &m_draw_overlay)) {
+    return;
   }
 
   if (di == &m_draw_overlay) {
@@ -976,14 +1224,14 @@ void RadarInfo::RenderRadarImage1(wxPoint center, double scale, double overlay_r
 
   if (m_pixels_per_meter != 0.) {
     double radar_scale = scale / m_pixels_per_meter;
-    if (m_pi->m_settings.drawing_method) {  // for shader
+    if (RadarDraw::IsShaderMethod(m_pi->m_settings.drawing_method)) {
       glPushMatrix();
       glTranslated(center.x, center.y, 0);
       glRotated(panel_rotate, 0.0, 0.0, 1.0);
       glScaled(radar_scale, radar_scale, 1.);
     }
     RenderRadarImage2(overlay ? &m_draw_overlay : &m_draw_panel, radar_scale, panel_rotate);
-    if (m_pi->m_settings.drawing_method) {
+    if (RadarDraw::IsShaderMethod(m_pi->m_settings.drawing_method)) {
       glPopMatrix();
     }
   }
@@ -37,6 +37,8 @@
 #include "ControlsDialog.h"
 #include "RadarControlItem.h"
 #include "RadarReceive.h"
+#include "HistoryPlane.h"
+#include "TrailAge.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -44,7 +46,11 @@ class RadarDraw;
 class RadarCanvas;
 class RadarPanel;
 class GuardZoneBogey;
+class BlobLabeller;
+class ClutterMap;
+class ScanFilter;
 class RadarInfo;
+class RadarSnapshot;
 class TrailBuffer;
 
 struct DrawInfo {
@@ -53,12 +59,30 @@ struct DrawInfo {
   bool color_option;
 };
 
-#define SECONDS_TO_REVOLUTIONS(x) ((x)*2 / 5)
-#define TRAIL_MAX_REVOLUTIONS SECONDS_TO_REVOLUTIONS(600) + 1
 enum { TRAIL_15SEC, TRAIL_30SEC, TRAIL_1MIN, TRAIL_3MIN, TRAIL_5MIN, TRAIL_10MIN, TRAIL_CONTINUOUS, TRAIL_ARRAY_SIZE };
 
 #define COURSE_SAMPLES (16)
 
+#ifdef RADAR_SPOKE_TIMING
+#include <chrono>
+
+// Stages of ProcessRadarSpoke that radar_bench reports on
+enum SpokeStage {
+  SPOKE_STAGE_SCAN_FILTER,
+  SPOKE_STAGE_HISTORY,
+  SPOKE_STAGE_GUARD_ZONES,
+  SPOKE_STAGE_TRUE_TRAILS,
+  SPOKE_STAGE_RELATIVE_TRAILS,
+  SPOKE_STAGE_DRAW,
+  SPOKE_STAGES
+};
+
+struct spoke_timing {
+  uint64_t nanos[SPOKE_STAGES];  // Total time spent in each stage
+  uint64_t spokes;               // Number of spokes processed
+};
+#endif
+
 class RadarInfo {
   friend class TrailBuffer;
 
@@ -136,6 +160,7 @@ class RadarInfo {
 
   RadarControl *m_control;
   RadarReceive *m_receive;
+  RadarProcess *m_process;
   ControlsDialog *m_control_dialog;
   RadarPanel *m_radar_panel;
   RadarCanvas *m_radar_canvas;
@@ -158,18 +183,27 @@ class RadarInfo {
   double m_ebl[ORIENTATION_NUMBER][BEARING_LINES];
   double m_vrm[BEARING_LINES];
   receive_statistics m_statistics;
+#ifdef RADAR_SPOKE_TIMING
+  spoke_timing m_spoke_timing;
+#endif
 
   struct line_history {
-    uint8_t *line;
+    HistoryWord *echo;       // Bit plane of the samples above threshold_red
+    HistoryWord *unclaimed;  // Bit plane of the echoes that no ARPA target claimed in this sweep
     wxLongLong time;
     GeoPosition pos;
   };
 
   line_history *m_history;
+  HistoryWord *m_history_planes;  // m_spokes * 2 * m_history_words, both planes of a spoke together
+  size_t m_history_words;         // Words in one plane
+  BlobLabeller *m_blobs;          // The connected echoes of the last sweep, for ARPA
+  ClutterMap *m_clutter;          // Adaptive thresholds for m_history and the guard zones
+  bool m_clutter_on;              // m_clutter was updated with the last spoke
+  ScanFilter *m_scan_filter;      // The scans of the last revolutions at each bearing
+  RadarSnapshot *m_snapshot;  // Keeps m_history and the trails across restarts, or 0
 
   int m_old_range;
-  int m_dir_lat;
-  int m_dir_lon;
   TrailBuffer *m_trails;
 
   // Timed Transmit
@@ -182,12 +216,15 @@ class RadarInfo {
   ~RadarInfo();
 
   bool Init();
+  void InitSpokeProcessing();
+  bool PrepareDraw(bool overlay);
   void SetName(wxString name);
   wxString GetInfoStatus();
 
   void AdjustRange(int adjustment);
   void SetAutoRangeMeters(int meters);
   bool SetControlValue(ControlType controlType, RadarControlItem &item, RadarControlButton *button);
+  void QueueRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters, wxLongLong time);
   void ProcessRadarSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters, wxLongLong time);
   void RefreshDisplay();
   void RenderGuardZone();
@@ -277,6 +314,7 @@ class RadarInfo {
 
  private:
   void ResetSpokes();
+  void SaveSnapshot();
   void RenderRadarImage2(DrawInfo *di, double radar_scale, double panel_rotate);
   wxString FormatDistance(double distance);
   wxString FormatAngle(double angle);
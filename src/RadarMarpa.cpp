@@ -30,8 +30,10 @@
  */
 
 #include "RadarMarpa.h"
+#include "BlobLabeller.h"
 #include "GuardZone.h"
 #include "RadarCanvas.h"
+#include "RadarDraw.h"
 #include "RadarInfo.h"
 #include "drawutil.h"
 #include "radar_pi.h"
@@ -39,12 +41,16 @@
 PLUGIN_BEGIN_NAMESPACE
 
 static int target_id_count = 0;
+static wxCriticalSection target_id_lock;  // The RadarProcess threads of all radars share the id sequence
 
 RadarArpa::RadarArpa(radar_pi* pi, RadarInfo* ri) {
   m_ri = ri;
   m_pi = pi;
   m_number_of_targets = 0;
-  CLEAR_STRUCT(m_targets);
+  m_targets_allocated = 0;
+  m_targets = 0;
+  m_sweep_bearing = -1;
+  m_clear_contours = false;
 }
 
 ArpaTarget::~ArpaTarget() {
@@ -55,14 +61,44 @@ ArpaTarget::~ArpaTarget() {
 }
 
 RadarArpa::~RadarArpa() {
-  int n = m_number_of_targets;
+  int n = m_targets_allocated;
   m_number_of_targets = 0;
+  m_targets_allocated = 0;
   for (int i = 0; i < n; i++) {
     if (m_targets[i]) {
       delete m_targets[i];
       m_targets[i] = 0;
     }
   }
+  free(m_targets);
+  m_targets = 0;
+}
+
+// Returns the index of a target that can be (re)used, growing the pool when all targets
+// are in use. A lost target is reused, destruction and construction is expensive.
+// The last target is kept for the dummy target that deletes a target.
+int RadarArpa::NewTarget(int status) {
+  if (m_number_of_targets >= MAX_NUMBER_OF_TARGETS - 1 &&
+      !(m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == FOR_DELETION)) {
+    LOG_INFO(wxT("radar_pi: RadarArpa:: Error, max targets exceeded %i"), m_number_of_targets);
+    return -1;
+  }
+  if (m_number_of_targets == m_targets_allocated) {
+    int allocated = m_targets_allocated + TARGET_POOL_BLOCK;
+    ArpaTarget** targets = (ArpaTarget**)realloc(m_targets, allocated * sizeof(ArpaTarget*));
+
+    if (!targets) {
+      wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+      wxAbort();
+    }
+    memset(targets + m_targets_allocated, 0, TARGET_POOL_BLOCK * sizeof(ArpaTarget*));
+    m_targets = targets;
+    m_targets_allocated = allocated;
+  }
+  if (!m_targets[m_number_of_targets]) {
+    m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
+  }
+  return m_number_of_targets++;
 }
 
 ExtendedPosition ArpaTarget::Polar2Pos(Polar pol, ExtendedPosition own_ship) {
@@ -95,20 +131,29 @@ bool RadarArpa::Pix(int ang, int rad) {
   if (rad <= 0 || rad >= (int)m_ri->m_spoke_len_max) {
     return false;
   }
-  return ((m_ri->m_history[MOD_SPOKES(ang)].line[rad] & 128) != 0);
+  return HISTORY_BIT(m_ri->m_history[MOD_SPOKES(ang)].unclaimed, rad) != 0;
+}
+
+int RadarArpa::Neighbours(int ang, int rad) {
+  return HistoryNeighbours(m_ri->m_history[MOD_SPOKES(ang - 1)].unclaimed, m_ri->m_history[MOD_SPOKES(ang)].unclaimed,
+                           m_ri->m_history[MOD_SPOKES(ang + 1)].unclaimed, rad, (int)m_ri->m_spoke_len_max);
+}
+
+// The plane that this target looks at: the echoes that no other target claimed in this sweep,
+// or all echoes when checking whether another target took its place.
+HistoryWord* ArpaTarget::Plane(int ang) {
+  return m_check_for_duplicate ? m_ri->m_history[MOD_SPOKES(ang)].echo : m_ri->m_history[MOD_SPOKES(ang)].unclaimed;
 }
 
 bool ArpaTarget::Pix(int ang, int rad) {
   if (rad <= 0 || rad >= (int)m_ri->m_spoke_len_max) {
     return false;
   }
-  if (m_check_for_duplicate) {
-    // check bit 1
-    return ((m_ri->m_history[MOD_SPOKES(ang)].line[rad] & 64) != 0);
-  } else {
-    // check bit 0
-    return ((m_ri->m_history[MOD_SPOKES(ang)].line[rad] & 128) != 0);
-  }
+  return HISTORY_BIT(Plane(ang), rad) != 0;
+}
+
+int ArpaTarget::Neighbours(int ang, int rad) {
+  return HistoryNeighbours(Plane(ang - 1), Plane(ang), Plane(ang + 1), rad, (int)m_ri->m_spoke_len_max);
 }
 
 bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a contour of at least length pixels
@@ -138,8 +183,6 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
   transl[3].angle = -1;
   transl[3].r = 0;
   int count = 0;
-  int aa;
-  int rr;
   bool succes = false;
   int index = 0;
   max_r = current;
@@ -153,11 +196,10 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
     return false;  //  r too small
   }
   // first find the orientation of border point p
+  int around = Neighbours(current.angle, current.r);
   for (int i = 0; i < 4; i++) {
     index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    succes = !Pix(aa, rr);
+    succes = !(around & (1 << index));
     if (succes) break;
   }
   if (!succes) {
@@ -170,11 +212,10 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
     // start with the "left most" translation relative to the
     // previous one
     index += 3;  // we will turn left all the time if possible
+    around = Neighbours(current.angle, current.r);
     for (int i = 0; i < 4; i++) {
       if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
+      succes = (around & (1 << index)) != 0;
       if (succes) {  // next point found
         break;
       }
@@ -183,8 +224,8 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
     if (!succes) {
       return false;  // no next point found (this happens when the blob consists of one single pixel)
     }                // next point found
-    current.angle = aa;
-    current.r = rr;
+    current.angle += transl[index].angle;
+    current.r += transl[index].r;
     if (count >= length) {
       return true;
     }
@@ -208,9 +249,8 @@ bool ArpaTarget::MultiPix(int ang, int rad) {  // checks if the blob has a conto
     max_angle.angle += m_ri->m_spokes;
   }
   for (int a = min_angle.angle; a <= max_angle.angle; a++) {
-    for (int r = min_r.r; r <= max_r.r; r++) {
-      m_ri->m_history[MOD_SPOKES(a)].line[r] &= 63;
-    }
+    HistoryClear(m_ri->m_history[MOD_SPOKES(a)].echo, min_r.r, max_r.r);
+    HistoryClear(m_ri->m_history[MOD_SPOKES(a)].unclaimed, min_r.r, max_r.r);
   }
   return false;
 }
@@ -243,8 +283,6 @@ bool RadarArpa::MultiPix(int ang, int rad) {
   transl[3].angle = -1;
   transl[3].r = 0;
   int count = 0;
-  int aa;
-  int rr;
   bool succes = false;
   int index = 0;
   max_r = current;
@@ -258,11 +296,10 @@ bool RadarArpa::MultiPix(int ang, int rad) {
     return false;  //  r too small
   }
   // first find the orientation of border point p
+  int around = Neighbours(current.angle, current.r);
   for (int i = 0; i < 4; i++) {
     index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    succes = !Pix(aa, rr);
+    succes = !(around & (1 << index));
     if (succes) break;
   }
   if (!succes) {
@@ -274,11 +311,10 @@ bool RadarArpa::MultiPix(int ang, int rad) {
          count == 0) {  // try all translations to find the next point  // start with the "left most" translation relative to the
     // previous one
     index += 3;  // we will turn left all the time if possible
+    around = Neighbours(current.angle, current.r);
     for (int i = 0; i < 4; i++) {
       if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
+      succes = (around & (1 << index)) != 0;
       if (succes) {  // next point found
         break;
       }
@@ -287,8 +323,8 @@ bool RadarArpa::MultiPix(int ang, int rad) {
     if (!succes) {
       return false;  // no next point found
     }                // next point found
-    current.angle = aa;
-    current.r = rr;
+    current.angle += transl[index].angle;
+    current.r += transl[index].r;
     if (count >= length) {
       return true;
     }
@@ -312,9 +348,8 @@ bool RadarArpa::MultiPix(int ang, int rad) {
     max_angle.angle += m_ri->m_spokes;
   }
   for (int a = min_angle.angle; a <= max_angle.angle; a++) {
-    for (int r = min_r.r; r <= max_r.r; r++) {
-      m_ri->m_history[MOD_SPOKES(a)].line[r] &= 63;
-    }
+    HistoryClear(m_ri->m_history[MOD_SPOKES(a)].echo, min_r.r, max_r.r);
+    HistoryClear(m_ri->m_history[MOD_SPOKES(a)].unclaimed, min_r.r, max_r.r);
   }
   return false;
 }
@@ -330,16 +365,9 @@ void RadarArpa::AcquireOrDeleteMarpaTarget(ExtendedPosition target_pos, int stat
   // returns in X metric coordinates of click
   // constructs Kalman filter
   // make new target
-  int i_target;
-  if (m_number_of_targets < MAX_NUMBER_OF_TARGETS - 1 ||
-      (m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == FOR_DELETION)) {
-    if (m_targets[m_number_of_targets] == 0) {
-      m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
-    }
-    i_target = m_number_of_targets;
-    m_number_of_targets++;
-  } else {
-    LOG_INFO(wxT("radar_pi: RadarArpa:: Error, max targets exceeded "));
+  wxCriticalSectionLocker lock(m_exclusive);
+  int i_target = NewTarget(status);
+  if (i_target < 0) {
     return;
   }
 
@@ -414,8 +442,6 @@ int ArpaTarget::GetContour(Polar* pol) {
   int count = 0;
   Polar start = *pol;
   Polar current = *pol;
-  int aa;
-  int rr;
 
   bool succes = false;
   int index = 0;
@@ -434,12 +460,10 @@ int ArpaTarget::GetContour(Polar* pol) {
     return 3;  // return code 3, starting point outside blob
   }
   // first find the orientation of border point p
+  int around = Neighbours(current.angle, current.r);
   for (int i = 0; i < 4; i++) {
     index = i;
-    aa = current.angle + transl[index].angle;
-    rr = current.r + transl[index].r;
-    //  if (rr > RETURNS_PER_LINE - 1) return 13;  // r too large
-    succes = !Pix(aa, rr);
+    succes = !(around & (1 << index));
     if (succes) break;
   }
   if (!succes) {
@@ -452,14 +476,11 @@ int ArpaTarget::GetContour(Polar* pol) {
     // try all translations to find the next point
     // start with the "left most" translation relative to the previous one
     index += 3;  // we will turn left all the time if possible
+    around = Neighbours(current.angle, current.r);
     for (int i = 0; i < 4; i++) {
       if (index > 3) index -= 4;
-      aa = current.angle + transl[index].angle;
-      rr = current.r + transl[index].r;
-      succes = Pix(aa, rr);
+      succes = (around & (1 << index)) != 0;
       if (succes) {
-        // next point found
-
         break;
       }
       index += 1;
@@ -469,8 +490,8 @@ int ArpaTarget::GetContour(Polar* pol) {
       return 7;  // return code 7, no next point found
     }
     // next point found
-    current.angle = aa;
-    current.r = rr;
+    current.angle += transl[index].angle;
+    current.r += transl[index].r;
     if (count < MAX_CONTOUR_LENGTH - 2) {
       m_contour[count] = current;
     }
@@ -553,9 +574,14 @@ void RadarArpa::DrawContour(ArpaTarget* target) {
 }
 
 void RadarArpa::DrawArpaTargetsOverlay(double scale, double arpa_rotate) {
+  wxCriticalSectionLocker lock(m_exclusive);
   wxPoint boat_center;
   GeoPosition radar_pos;
-  if (!m_pi->m_settings.drawing_method && m_ri->GetRadarPosition(&radar_pos)) {
+
+  if (m_clear_contours) {
+    return;
+  }
+  if (!RadarDraw::IsShaderMethod(m_pi->m_settings.drawing_method) && m_ri->GetRadarPosition(&radar_pos)) {
     for (int i = 0; i < m_number_of_targets; i++) {
       if (!m_targets[i]) {
         continue;
@@ -599,12 +625,17 @@ void RadarArpa::DrawArpaTargetsOverlay(double scale, double arpa_rotate) {
 }
 
 void RadarArpa::DrawArpaTargetsPanel(double scale, double arpa_rotate) {
+  wxCriticalSectionLocker lock(m_exclusive);
   wxPoint boat_center;
   GeoPosition radar_pos, target_pos;
   double offset_lat = 0.;
   double offset_lon = 0.;
 
-  if (!m_pi->m_settings.drawing_method && m_ri->GetRadarPosition(&radar_pos)) {
+  if (m_clear_contours) {
+    return;
+  }
+
+  if (!RadarDraw::IsShaderMethod(m_pi->m_settings.drawing_method) && m_ri->GetRadarPosition(&radar_pos)) {
     m_ri->GetRadarPosition(&radar_pos);
     for (int i = 0; i < m_number_of_targets; i++) {
       if (!m_targets[i]) {
@@ -654,10 +685,10 @@ void RadarArpa::CleanUpLostTargets() {
         // we keep the lost target for later use, destruction and construction is expensive
         ArpaTarget* lost = m_targets[ii];
         int len = sizeof(ArpaTarget*);
-        // move rest of larget list up to keep them in sequence
-        memmove(&m_targets[ii], &m_targets[ii] + 1, (m_number_of_targets - ii) * len);
+        // move rest of larget list up to keep them in sequence, the pool may end right after the last target
+        memmove(&m_targets[ii], &m_targets[ii] + 1, (m_number_of_targets - ii - 1) * len);
         m_number_of_targets--;
-        // set the lost target at the last position
+        // set the lost target at the last position, which the move freed
         m_targets[m_number_of_targets] = lost;
       } else {
         ii++;
@@ -666,7 +697,8 @@ void RadarArpa::CleanUpLostTargets() {
   }
 }
 
-void RadarArpa::RefreshArpaTargets() {
+// Sets the targets that the user deleted, and the targets nearest to them, to lost.
+void RadarArpa::DeleteMarkedTargets() {
   CleanUpLostTargets();
   int target_to_delete = -1;
   // find a target with status FOR_DELETION if it is there
@@ -700,38 +732,98 @@ void RadarArpa::RefreshArpaTargets() {
     // now first clean up the lost targets again
     CleanUpLostTargets();
   }
+}
 
-  ArpaTarget t;
-  KalmanFilter k(m_ri->m_spokes);
-  // main target refresh loop
+/*
+ * SweepTo
+ *
+ * Called by the RadarProcess thread after every spoke, without RadarInfo::m_exclusive.
+ * The sweep is divided in ARPA_SECTORS sectors. The targets of a sector are refreshed as
+ * soon as the beam is SCAN_MARGIN spokes past the sector, the targets that were not found
+ * get a second, wider, search PASS2_MARGIN spokes later, and the guard zones are searched for
+ * new targets in that sector GUARD_ZONE_MARGIN spokes past it. So the work is spread evenly
+ * over the rotation, and a target is refreshed once per rotation at about the same time
+ * after the beam saw it, however often the screen is drawn.
+ */
+void RadarArpa::SweepTo(SpokeBearing bearing) {
+  int spokes = m_ri->m_spokes;
 
-  // pass 1 of target refresh
-  int dist = TARGET_SEARCH_RADIUS1;
-  for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) {
-      LOG_INFO(wxT("radar_pi:  error target non existent i=%i"), i);
-      continue;
+  if (m_sweep_bearing < 0 || m_sweep_bearing >= spokes) {
+    m_sweep_bearing = bearing;
+    return;
+  }
+  int passed = MOD_SPOKES((int)bearing - m_sweep_bearing);
+  if (passed > spokes / 2) {  // the beam went back, or we missed half a sweep, start again from here
+    m_sweep_bearing = bearing;
+    return;
+  }
+  for (int b = m_sweep_bearing + 1; b <= m_sweep_bearing + passed; b++) {
+    int sector = SectorPassed(b, SCAN_MARGIN);
+    if (sector >= 0) {
+      RefreshSector(sector, PASS1);
     }
-    m_targets[i]->m_pass_nr = PASS1;
-    if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) continue;
-    m_targets[i]->RefreshTarget(dist);
-    if (m_targets[i]->m_pass1_result == NOT_FOUND_IN_PASS1) {
+    sector = SectorPassed(b, SCAN_MARGIN + PASS2_MARGIN);
+    if (sector >= 0) {
+      RefreshSector(sector, PASS2);
     }
+    sector = SectorPassed(b, GUARD_ZONE_MARGIN);
+    if (sector >= 0) {
+      int first = (sector * spokes + ARPA_SECTORS - 1) / ARPA_SECTORS;
+      int end = ((sector + 1) * spokes + ARPA_SECTORS - 1) / ARPA_SECTORS;
+
+      wxCriticalSectionLocker lock(m_exclusive);
+      for (int i = 0; i < GUARD_ZONES; i++) m_ri->m_guard_zone[i]->SearchTargets(first, end);
+    }
+  }
+  m_sweep_bearing = bearing;
+}
+
+// Returns the sector that the beam has just passed by 'margin' spokes when it is at 'bearing', or -1.
+// Spoke a is in sector a * ARPA_SECTORS / spokes, so sector s starts at the first spoke a for which
+// that is s.
+int RadarArpa::SectorPassed(int bearing, int margin) {
+  int spokes = m_ri->m_spokes;
+  int a = MOD_SPOKES(bearing - margin);
+  int sector = a * ARPA_SECTORS / spokes;
+
+  if (a != (sector * spokes + ARPA_SECTORS - 1) / ARPA_SECTORS) {
+    return -1;
+  }
+  return (sector + ARPA_SECTORS - 1) % ARPA_SECTORS;
+}
+
+// Refreshes the targets that are in 'sector', and the ones that have not been placed in a sector yet
+void RadarArpa::RefreshSector(int sector, PassN pass) {
+  wxCriticalSectionLocker lock(m_exclusive);
+
+  if (pass == PASS1) {
+    if (m_clear_contours) {
+      m_clear_contours = false;
+      for (int i = 0; i < m_number_of_targets; i++) {
+        m_targets[i]->m_contour_length = 0;
+      }
+    }
+    DeleteMarkedTargets();
   }
 
-  // pass 2 of target refresh
-  dist = TARGET_SEARCH_RADIUS2;
   for (int i = 0; i < m_number_of_targets; i++) {
-    if (!m_targets[i]) {
+    ArpaTarget* target = m_targets[i];
+
+    if (!target) {
       LOG_INFO(wxT("radar_pi: error target non existent i=%i"), i);
       continue;
     }
-    if (m_targets[i]->m_pass1_result == UNKNOWN) continue;
-    m_targets[i]->m_pass_nr = PASS2;
-    m_targets[i]->RefreshTarget(dist);
+    if (target->m_sector != sector && target->m_sector != ARPA_ANY_SECTOR) continue;
+    if (pass == PASS1) {
+      target->m_pass_nr = PASS1;
+      if (target->m_pass1_result == NOT_FOUND_IN_PASS1) continue;
+      target->RefreshTarget(TARGET_SEARCH_RADIUS1);
+    } else {
+      if (target->m_pass1_result == UNKNOWN) continue;
+      target->m_pass_nr = PASS2;
+      target->RefreshTarget(TARGET_SEARCH_RADIUS2);
+    }
   }
-
-  for (int i = 0; i < GUARD_ZONES; i++) m_ri->m_guard_zone[i]->SearchTargets();
 }
 
 void ArpaTarget::RefreshTarget(int dist) {
@@ -747,9 +839,10 @@ void ArpaTarget::RefreshTarget(int dist) {
     return;
   }
   pol = Pos2Polar(m_position, own_pos);
+  m_sector = MOD_SPOKES(pol.angle) * ARPA_SECTORS / m_ri->m_spokes;
   wxLongLong time1 = m_ri->m_history[MOD_SPOKES(pol.angle)].time;
   int margin = SCAN_MARGIN;
-  if (m_pass_nr == PASS2) margin += 100;
+  if (m_pass_nr == PASS2) margin += PASS2_MARGIN;
   wxLongLong time2 = m_ri->m_history[MOD_SPOKES(pol.angle + margin)].time;
   // check if target has been refreshed since last time (at least SCAN_MARGIN2 later)
   // and if the beam has passed the target location with SCAN_MARGIN spokes
@@ -826,7 +919,6 @@ void ArpaTarget::RefreshTarget(int dist) {
       prev_X = prev2_X;
       return;
     }
-    m_lost_count = 0;
     if (m_status == ACQUIRE0) {
       // as this is the first measurement, move target to measured position
       ExtendedPosition p_own;
@@ -840,15 +932,23 @@ void ArpaTarget::RefreshTarget(int dist) {
     m_status++;
     // target gets an id when status  == STATUS_TO_OCPN
     if (m_status == STATUS_TO_OCPN) {
+      wxCriticalSectionLocker lock(target_id_lock);
       target_id_count++;
       if (target_id_count >= 10000) target_id_count = 1;
       m_target_id = target_id_count;
     }
     // Kalman filter to  calculate the apostriori local position and speed based on found position (pol)
+    bool measured = true;
     if (m_status > 1) {
       m_kalman->Update_P();
-      m_kalman->SetMeasurement(&pol, &x_local, &m_expected,
-                               m_ri->m_pixels_per_meter);  // pol is measured position in polar coordinates
+      measured = m_kalman->SetMeasurement(&pol, &x_local, &m_expected,
+                                          m_ri->m_pixels_per_meter);  // pol is measured position in polar coordinates
+    }
+    if (measured) {
+      m_lost_count = 0;
+    } else {
+      // the position stays as predicted, so the target does not count as refreshed
+      LOG_ARPA(wxT("radar_pi: target %i measurement not used, innovation covariance is singular"), m_target_id);
     }
 
     // x_local expected position in local coordinates
@@ -962,41 +1062,60 @@ void ArpaTarget::RefreshTarget(int dist) {
   return;
 }
 
-#define PIX(aa, rr)                                   \
-  if (rr >= (int)m_ri->m_spoke_len_max - 1) continue; \
-  if (MultiPix(aa, rr)) {                             \
-    pol->angle = aa;                                  \
-    pol->r = rr;                                      \
-    return true;                                      \
-  }
-
-bool ArpaTarget::FindNearestContour(Polar* pol, int dist) {
-  // make a search pattern along a square
-  // returns the position of the nearest blob found in pol
-  // dist is search radius (1 more or less) in radial pixels
+// Finds the nearest blob of the last sweep that is within dist radial pixels of pol, and about as
+// far across the spokes, and that is large enough to be a target. Moves pol to the seed of the
+// blob, which lies on its contour.
+bool ArpaTarget::FindNearestBlob(Polar* pol, int dist) {
   int a = pol->angle;
   int r = pol->r;
   if (dist < 2) dist = 2;
-  for (int j = 1; j <= dist; j++) {
-    int dist_r = j;
-    int dist_a = (int)(326. / (double)r * j);  // 326/r: conversion factor to make squares
-                                               // if r == 326 circle would be 28 * PI * 326 = 2048
-    if (dist_a == 0) dist_a = 1;
-    for (int i = 0; i <= dist_a; i++) {  // "upper" side
-      PIX(a - i, r + dist_r);            // search starting from the middle
-      PIX(a + i, r + dist_r);
-    }
-    for (int i = 0; i < dist_r; i++) {  // "right hand" side
-      PIX(a + dist_a, r + i);
-      PIX(a + dist_a, r - i);
-    }
-    for (int i = 0; i <= dist_a; i++) {  // "lower" side
-      PIX(a + i, r - dist_r);
-      PIX(a - i, r - dist_r);
+  int dist_a = (int)(326. / (double)r * dist);  // 326/r: conversion factor to make squares
+                                                // if r == 326 circle would be 28 * PI * 326 = 2048
+  if (dist_a == 0) dist_a = 1;
+
+  Polar candidate[BLOB_CANDIDATES];
+  int distance[BLOB_CANDIDATES];
+  int count = 0;
+  {
+    wxCriticalSectionLocker lock(m_ri->m_exclusive);
+    // A blob is listed at the spoke after its last one. One that ends beyond a + dist_a may
+    // still reach back to a, if it is not larger than a target can be.
+    int last = wxMin(a + dist_a + MAX_TARGET_DIAMETER, a - dist_a + (int)m_ri->m_spokes);
+    for (int f = a - dist_a + 1; f <= last; f++) {
+      int b = m_ri->m_blobs->GetFirstDone(MOD_SPOKES(f));
+      while (b != BLOB_NONE) {
+        const Blob* blob = m_ri->m_blobs->GetBlob(b);
+        b = blob->next;
+        int span = blob->max_angle - blob->min_angle;
+        int da = MOD_SPOKES(a - blob->min_angle);
+        da = da <= span ? 0 : wxMin(da - span, (int)m_ri->m_spokes - da);
+        int dr = r < blob->min_r ? blob->min_r - r : r > blob->max_r ? r - blob->max_r : 0;
+        if (dr > dist || da > dist_a || blob->seed_r >= (int)m_ri->m_spoke_len_max - 1 || !Pix(blob->seed_angle, blob->seed_r)) {
+          continue;  // too far, or claimed by another target
+        }
+        // Keep the nearest ones, nearest first
+        int d = wxMax(dr, (da * dist + dist_a - 1) / dist_a);
+        int i = count < BLOB_CANDIDATES ? count++ : BLOB_CANDIDATES;
+        while (i > 0 && distance[i - 1] > d) {
+          if (i < BLOB_CANDIDATES) {
+            candidate[i] = candidate[i - 1];
+            distance[i] = distance[i - 1];
+          }
+          i--;
+        }
+        if (i < BLOB_CANDIDATES) {
+          candidate[i].angle = blob->seed_angle;
+          candidate[i].r = blob->seed_r;
+          distance[i] = d;
+        }
+      }
     }
-    for (int i = 0; i < dist_r; i++) {  // "left hand" side
-      PIX(a - dist_a, r + i);
-      PIX(a - dist_a, r - i);
+  }
+  for (int i = 0; i < count; i++) {
+    if (MultiPix(candidate[i].angle, candidate[i].r)) {
+      pol->angle = candidate[i].angle;
+      pol->r = candidate[i].r;
+      return true;
     }
   }
   return false;
@@ -1023,6 +1142,7 @@ ArpaTarget::ArpaTarget(radar_pi* pi, RadarInfo* ri) {
   m_position.dlon_dt = 0.;
   m_pass1_result = UNKNOWN;
   m_pass_nr = PASS1;
+  m_sector = ARPA_ANY_SECTOR;
 }
 
 ArpaTarget::ArpaTarget() {
@@ -1040,6 +1160,7 @@ ArpaTarget::ArpaTarget() {
   m_position.dlon_dt = 0.;
   m_pass1_result = UNKNOWN;
   m_pass_nr = PASS1;
+  m_sector = ARPA_ANY_SECTOR;
 }
 
 bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
@@ -1060,7 +1181,7 @@ bool ArpaTarget::GetTarget(Polar* pol, int dist1) {
   if (Pix(a, r)) {
     contour_found = FindContourFromInside(pol);
   } else {
-    contour_found = FindNearestContour(pol, dist);
+    contour_found = FindNearestBlob(pol, dist);
   }
   if (!contour_found) {
     return false;
@@ -1160,9 +1281,12 @@ void ArpaTarget::SetStatusLost() {
   m_position.dlat_dt = 0.;
   m_position.dlon_dt = 0.;
   m_pass_nr = PASS1;
+  m_sector = ARPA_ANY_SECTOR;
 }
 
 void RadarArpa::DeleteAllTargets() {
+  wxCriticalSectionLocker lock(m_exclusive);
+
   for (int i = 0; i < m_number_of_targets; i++) {
     if (!m_targets[i]) continue;
     m_targets[i]->SetStatusLost();
@@ -1175,21 +1299,15 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
   // target status status, normally 0, if dummy target to delete a target -2
   // returns in X metric coordinates of click
   // constructs Kalman filter
+  wxCriticalSectionLocker lock(m_exclusive);
   ExtendedPosition own_pos;
   ExtendedPosition target_pos;
   if (!m_ri->GetRadarPosition(&own_pos.pos)) {
     return -1;
   }
   // make new target or re-use an existing one with status == lost
-  int i;
-  if (m_number_of_targets < MAX_NUMBER_OF_TARGETS - 1 || (m_number_of_targets == MAX_NUMBER_OF_TARGETS - 1 && status == -2)) {
-    if (!m_targets[m_number_of_targets]) {
-      m_targets[m_number_of_targets] = new ArpaTarget(m_pi, m_ri);
-    }
-    i = m_number_of_targets;
-    m_number_of_targets++;
-  } else {
-    LOG_INFO(wxT("radar_pi: RadarArpa:: Error, max targets exceeded %i"), m_number_of_targets);
+  int i = NewTarget(status);
+  if (i < 0) {
     return -1;
   }
   ArpaTarget* target = m_targets[i];
@@ -1218,19 +1336,21 @@ int RadarArpa::AcquireNewARPATarget(Polar pol, int status) {
 void ArpaTarget::ResetPixels() {
   // resets the pixels of the current blob (plus DISTANCE_BETWEEN_TARGETS) so that blob will not be found again in the same sweep
   // We not only reset the blob but all pixels in a radial "square" covering the blob
-  for (int r = wxMax(m_min_r.r - DISTANCE_BETWEEN_TARGETS, 0);
-       r <= wxMin(m_max_r.r + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spoke_len_max - 1); r++) {
-    for (int a = wxMax(m_min_angle.angle - DISTANCE_BETWEEN_TARGETS, 0);
-         a <= wxMin(m_max_angle.angle + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spokes - 1); a++) {
-      m_ri->m_history[a].line[r] = m_ri->m_history[a].line[r] & 127;
-    }
+  int min_r = wxMax(m_min_r.r - DISTANCE_BETWEEN_TARGETS, 0);
+  int max_r = wxMin(m_max_r.r + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spoke_len_max - 1);
+  for (int a = wxMax(m_min_angle.angle - DISTANCE_BETWEEN_TARGETS, 0);
+       a <= wxMin(m_max_angle.angle + DISTANCE_BETWEEN_TARGETS, (int)m_ri->m_spokes - 1); a++) {
+    HistoryClear(m_ri->m_history[a].unclaimed, min_r, max_r);
   }
 }
 
-void RadarArpa::ClearContours() {
-  for (int i = 0; i < m_number_of_targets; i++) {
-    m_targets[i]->m_contour_length = 0;
-  }
-}
+/*
+ * ClearContours
+ *
+ * Called from ProcessRadarSpoke and ResetRadarImage, which both hold RadarInfo::m_exclusive,
+ * so it may not take m_exclusive (see the lock order in RadarMarpa.h). The contours are
+ * cleared when the sweep passes the next sector, and not drawn until then.
+ */
+void RadarArpa::ClearContours() { m_clear_contours = true; }
 
 PLUGIN_END_NAMESPACE
@@ -45,14 +45,19 @@ PLUGIN_BEGIN_NAMESPACE
 //    Forward definitions
 class KalmanFilter;
 
-#define MAX_NUMBER_OF_TARGETS (100)
-#define TARGET_SEARCH_RADIUS1 (2)   // radius of target search area for pass 1 (on top of the size of the blob)
-#define TARGET_SEARCH_RADIUS2 (15)  // radius of target search area for pass 1
-#define SCAN_MARGIN (150)           // number of lines that a next scan of the target may have moved
-#define SCAN_MARGIN2 (1000)         // if target is refreshed after this time you will be shure it is the next sweep
-#define MAX_CONTOUR_LENGTH (601)    // defines maximal size of target contour in pixels
-#define MAX_TARGET_DIAMETER (200)   // target will be set lost if diameter in pixels is larger than this value
-#define MAX_LOST_COUNT (3)          // number of sweeps that target can be missed before it is set to lost
+#define MAX_NUMBER_OF_TARGETS (2000)  // the target pool grows as needed up to this many targets
+#define TARGET_POOL_BLOCK (64)        // number of targets the pool grows by
+#define TARGET_SEARCH_RADIUS1 (2)     // radius of target search area for pass 1 (on top of the size of the blob)
+#define TARGET_SEARCH_RADIUS2 (15)    // radius of target search area for pass 1
+#define SCAN_MARGIN (150)             // number of lines that a next scan of the target may have moved
+#define SCAN_MARGIN2 (1000)           // if target is refreshed after this time you will be shure it is the next sweep
+#define PASS2_MARGIN (100)            // extra number of lines that the beam must be past a target for pass 2
+#define GUARD_ZONE_MARGIN (450)       // 3 * SCAN_MARGIN, number of lines the beam must be past a guard zone spoke to search it
+#define ARPA_SECTORS (16)             // the targets are refreshed one sector of the sweep at a time
+#define ARPA_ANY_SECTOR (-1)          // sector of a target that has not been placed yet
+#define MAX_CONTOUR_LENGTH (601)      // defines maximal size of target contour in pixels
+#define MAX_TARGET_DIAMETER (200)     // target will be set lost if diameter in pixels is larger than this value
+#define MAX_LOST_COUNT (3)            // number of sweeps that target can be missed before it is set to lost
 
 #define FOR_DELETION (-2)  // status of a duplicate target used to delete a target
 #define LOST (-1)
@@ -69,6 +74,7 @@ class KalmanFilter;
 #define STATUS_TO_OCPN (5)            // First status to be send to OCPN
 #define START_UP_SPEED (0.5)          // maximum allowed speed (m/sec) for new target, real format with .
 #define DISTANCE_BETWEEN_TARGETS (4)  // minimum separation between targets
+#define BLOB_CANDIDATES (8)           // nearest blobs that a target search tries
 
 typedef int target_status;
 enum OCPN_target_status {
@@ -90,7 +96,7 @@ class ArpaTarget {
 
   int GetContour(Polar* p);
   void set(radar_pi* pi, RadarInfo* ri);
-  bool FindNearestContour(Polar* pol, int dist);
+  bool FindNearestBlob(Polar* pol, int dist);
   bool FindContourFromInside(Polar* p);
   bool GetTarget(Polar* pol, int dist);
   void RefreshTarget(int dist);
@@ -101,6 +107,9 @@ class ArpaTarget {
   bool MultiPix(int ang, int rad);
 
  private:
+  HistoryWord* Plane(int ang);
+  int Neighbours(int ang, int rad);
+
   RadarInfo* m_ri;
   radar_pi* m_pi;
   KalmanFilter* m_kalman;
@@ -117,6 +126,7 @@ class ArpaTarget {
   bool m_check_for_duplicate;
   TargetProcessStatus m_pass1_result;
   PassN m_pass_nr;
+  int m_sector;  // sector of the sweep that the target was last seen in, or ARPA_ANY_SECTOR
   Polar m_contour[MAX_CONTOUR_LENGTH + 1];  // contour of target, only valid immediately after finding it
   int m_contour_length;
   Polar m_max_angle, m_min_angle, m_max_r, m_min_r;  // charasterictics of contour
@@ -133,7 +143,7 @@ class RadarArpa {
   ~RadarArpa();
   void DrawArpaTargetsOverlay(double scale, double arpa_rotate);
   void DrawArpaTargetsPanel(double scale, double arpa_rotate);
-  void RefreshArpaTargets();
+  void SweepTo(SpokeBearing bearing);
   int AcquireNewARPATarget(Polar pol, int status);
   void AcquireNewMARPATarget(ExtendedPosition p);
   void DeleteTarget(ExtendedPosition p);
@@ -147,16 +157,29 @@ class RadarArpa {
   int GetTargetCount() { return m_number_of_targets; }
 
  private:
+  // Protects the targets. SweepTo runs in the RadarProcess thread, drawing in
+  // the render thread and MARPA acquire/delete in the UI thread.
+  // Lock order: take this before RadarInfo::m_exclusive (GetRadarPosition), never after.
+  wxCriticalSection m_exclusive;
+  volatile bool m_clear_contours;  // Set by ClearContours, which is called with RadarInfo::m_exclusive held
+
+  int m_sweep_bearing;  // last bearing passed to SweepTo, or -1; only used by the RadarProcess thread
   int m_number_of_targets;
-  ArpaTarget* m_targets[MAX_NUMBER_OF_TARGETS];
+  int m_targets_allocated;  // size of m_targets; the entries from m_number_of_targets on are lost targets for reuse, or 0
+  ArpaTarget** m_targets;
 
   radar_pi* m_pi;
   RadarInfo* m_ri;
 
+  int NewTarget(int status);
+  int SectorPassed(int bearing, int margin);
+  void RefreshSector(int sector, PassN pass);
+  void DeleteMarkedTargets();
   void AcquireOrDeleteMarpaTarget(ExtendedPosition p, int status);
   void CalculateCentroid(ArpaTarget* t);
   void DrawContour(ArpaTarget* t);
   bool Pix(int ang, int rad);
+  int Neighbours(int ang, int rad);
 };
 
 PLUGIN_END_NAMESPACE
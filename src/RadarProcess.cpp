@@ -0,0 +1,108 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "RadarProcess.h"
+#include "RadarInfo.h"
+#include "RadarMarpa.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define MILLIS_PER_WAIT (100)  // How often the thread checks for shutdown when no spokes arrive
+
+/*
+ * QueueSpoke
+ *
+ * Called by the receive thread. Copies the spoke into the ring and wakes up the
+ * processing thread if it was idle. When the ring is full the spoke is dropped.
+ */
+void RadarProcess::QueueSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters,
+                              wxLongLong time_rec) {
+  SpokeRecord *spoke = m_ring.Reserve();
+
+  if (!spoke) {
+    m_ri->m_statistics.dropped_spokes.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  if (len > SPOKE_LEN_MAX) {
+    len = SPOKE_LEN_MAX;
+  }
+  spoke->angle = angle;
+  spoke->bearing = bearing;
+  spoke->len = len;
+  spoke->range_meters = range_meters;
+  spoke->time_rec = time_rec;
+  memcpy(spoke->data, data, len);
+
+  if (m_ring.Commit()) {
+    m_spokes_queued.Post();
+  }
+}
+
+/*
+ * Entry
+ *
+ * Called by wxThread when the new thread is running.
+ * It should remain running until Shutdown is called.
+ */
+void *RadarProcess::Entry(void) {
+  LOG_VERBOSE(wxT("radar_pi: %s process thread starting"), m_ri->m_name.c_str());
+
+  while (!m_shutdown) {
+    SpokeRecord *spoke;
+
+    while (!m_shutdown && (spoke = m_ring.Peek()) != 0) {
+      SpokeBearing bearing = spoke->bearing;
+      {
+        wxCriticalSectionLocker lock(m_ri->m_exclusive);
+        m_ri->ProcessRadarSpoke(spoke->angle, spoke->bearing, spoke->data, spoke->len, spoke->range_meters, spoke->time_rec);
+      }
+      m_ring.Release();
+
+      // Outside RadarInfo::m_exclusive, as the ARPA lock must be taken first
+      if (m_ri->m_arpa) {
+        m_ri->m_arpa->SweepTo(bearing);
+      }
+    }
+
+    m_spokes_queued.WaitTimeout(MILLIS_PER_WAIT);
+  }
+
+  LOG_VERBOSE(wxT("radar_pi: %s process thread stopping"), m_ri->m_name.c_str());
+  m_is_shutdown = true;
+  return 0;
+}
+
+void RadarProcess::Shutdown(void) {
+  m_shutdown = true;
+  m_spokes_queued.Post();
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _RADARPROCESS_H_
+#define _RADARPROCESS_H_
+
+#include "SpokeRing.h"
+#include "radar_pi.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// One spoke as decoded by the receive thread, waiting to be processed.
+//
+struct SpokeRecord {
+  SpokeBearing angle;
+  SpokeBearing bearing;
+  size_t len;
+  int range_meters;
+  wxLongLong time_rec;
+  uint8_t data[SPOKE_LEN_MAX];
+};
+
+#define SPOKE_RING_SIZE (1024)  // Half a rotation of a Navico radar, must be a power of two
+
+//
+// The thread that runs RadarInfo::ProcessRadarSpoke for one radar.
+//
+// The receive thread only decodes the network data and queues the spokes with
+// QueueSpoke(), which never blocks. This thread takes the spokes out of the ring and
+// does the heavy lifting (history, guard zones, trails, draw backend) while holding
+// RadarInfo::m_exclusive. So when the render thread holds that lock for a long time
+// it is this thread that waits, not the socket reads.
+//
+// When the ring is full the spoke is dropped, and counted in receive_statistics.
+//
+// The same thread also refreshes the ARPA targets and searches the guard zones for new
+// ones, a sector at a time as the sweep passes (RadarArpa::SweepTo). It is the thread that
+// writes m_history, so the ARPA code always sees whole spokes, and the render thread only
+// draws the result.
+//
+
+class RadarProcess : public wxThread {
+ public:
+  RadarProcess(radar_pi *pi, RadarInfo *ri) : wxThread(wxTHREAD_JOINABLE), m_spokes_queued(0, 1) {
+    Create(64 * 1024);
+    m_pi = pi;
+    m_ri = ri;
+    m_shutdown = false;
+    m_is_shutdown = false;
+  }
+
+  ~RadarProcess() {}
+
+  void *Entry(void);
+  void Shutdown(void);
+
+  void QueueSpoke(SpokeBearing angle, SpokeBearing bearing, uint8_t *data, size_t len, int range_meters, wxLongLong time_rec);
+
+  volatile bool m_is_shutdown;
+
+ private:
+  radar_pi *m_pi;
+  RadarInfo *m_ri;
+  volatile bool m_shutdown;
+
+  wxSemaphore m_spokes_queued;  // Posted when a spoke is queued in an empty ring
+  SpokeRing<SpokeRecord, SPOKE_RING_SIZE> m_ring;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _RADARPROCESS_H_ */
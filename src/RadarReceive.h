@@ -73,6 +73,19 @@ class RadarReceive : public wxThread {
    */
   virtual void Shutdown(void) = 0;
 
+  /*
+   * ProcessReplayPacket
+   *
+   * Called by ReplayReceive with a UDP datagram read from a capture file, as if it had
+   * just been received from the network. The thread of this object is never started in that case.
+   *
+   * Returns false when the datagram is not for this radar, or when the radar type does not
+   * support replay.
+   */
+  virtual bool ProcessReplayPacket(const NetworkAddress &src, const NetworkAddress &dst, const uint8_t *data, size_t len) {
+    return false;
+  }
+
  protected:
   radar_pi *m_pi;
   RadarInfo *m_ri;
@@ -0,0 +1,189 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "RadarSnapshot.h"
+
+#ifndef __WXMSW__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+static size_t Align(size_t n) { return (n + SNAPSHOT_ALIGN - 1) & ~(size_t)(SNAPSHOT_ALIGN - 1); }
+
+RadarSnapshot::RadarSnapshot() {
+#ifdef __WXMSW__
+  m_file = INVALID_HANDLE_VALUE;
+  m_mapping = 0;
+#else
+  m_fd = -1;
+#endif
+  m_base = 0;
+  m_size = 0;
+  m_restored = false;
+  m_restore_trails = false;
+}
+
+RadarSnapshot::~RadarSnapshot() { Unmap(); }
+
+bool RadarSnapshot::Open(const wxString &filename, int radar_type, size_t spokes, size_t spoke_len) {
+  bool existing = false;
+
+  m_spokes_offset = Align(sizeof(SnapshotHeader));
+  m_planes_offset = m_spokes_offset + Align(spokes * sizeof(SnapshotSpoke));
+  m_relative_offset = m_planes_offset + Align(spokes * 2 * HISTORY_WORDS(spoke_len) * sizeof(HistoryWord));
+  m_directory_offset = m_relative_offset + Align(spokes * spoke_len * sizeof(TrailRevolutionStamp));
+  m_tiles_offset = m_directory_offset + Align(SNAPSHOT_TILES * sizeof(SnapshotTile));
+  m_size = m_tiles_offset + SNAPSHOT_TILES * TRAIL_TILE_PIXELS * sizeof(TrailRevolutionStamp);
+
+#ifdef __WXMSW__
+  LARGE_INTEGER file_size;
+  LARGE_INTEGER start;
+
+  m_file = CreateFileW(filename.wc_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (m_file == INVALID_HANDLE_VALUE) {
+    wxLogError(wxT("radar_pi: cannot open snapshot %s"), filename.c_str());
+    return false;
+  }
+  start.QuadPart = 0;
+  if (GetFileSizeEx(m_file, &file_size) && (size_t)file_size.QuadPart == m_size) {
+    existing = true;
+  } else if (!SetFilePointerEx(m_file, start, NULL, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+    // Truncate first, as below, so that the mapping grows the file with zeros and not the old layout
+    wxLogError(wxT("radar_pi: cannot size snapshot %s"), filename.c_str());
+    Unmap();
+    return false;
+  }
+  m_mapping = CreateFileMappingW(m_file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)m_size >> 32), (DWORD)m_size, NULL);
+  if (m_mapping) {
+    m_base = (uint8_t *)MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_size);
+  }
+#else
+  struct stat st;
+
+  m_fd = open(filename.mb_str(), O_RDWR | O_CREAT, 0644);
+  if (m_fd < 0) {
+    wxLogError(wxT("radar_pi: cannot open snapshot %s"), filename.c_str());
+    return false;
+  }
+  if (fstat(m_fd, &st) == 0 && (size_t)st.st_size == m_size) {
+    existing = true;
+  } else if (ftruncate(m_fd, 0) != 0 || ftruncate(m_fd, m_size) != 0) {
+    wxLogError(wxT("radar_pi: cannot size snapshot %s"), filename.c_str());
+    Unmap();
+    return false;
+  }
+  m_base = (uint8_t *)mmap(0, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+  if (m_base == MAP_FAILED) {
+    m_base = 0;
+  }
+#endif
+  if (!m_base) {
+    wxLogError(wxT("radar_pi: cannot map snapshot %s"), filename.c_str());
+    Unmap();
+    return false;
+  }
+
+  SnapshotHeader *header = GetHeader();
+  m_restored = existing && memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0 &&
+               header->version == SNAPSHOT_VERSION && header->clean == 1 && Matches(radar_type, spokes, spoke_len);
+  m_restore_trails = m_restored && header->trail_levels == TRAIL_LEVELS;
+
+  if (!m_restored) {
+    if (existing) {
+      memset(m_base, 0, m_tiles_offset);  // the tiles are only read as far as the directory says
+    }
+    memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+    header->version = SNAPSHOT_VERSION;
+    header->radar_type = radar_type;
+    header->spokes = (uint32_t)spokes;
+    header->spoke_len = (uint32_t)spoke_len;
+  }
+  header->clean = 0;
+
+  LOG_INFO(wxT("radar_pi: snapshot %s %s"), filename.c_str(), m_restored ? wxT("restored") : wxT("started"));
+  return true;
+}
+
+bool RadarSnapshot::Matches(int radar_type, size_t spokes, size_t spoke_len) {
+  SnapshotHeader *header = GetHeader();
+
+  return header->radar_type == radar_type && header->spokes == spokes && header->spoke_len == spoke_len;
+}
+
+bool RadarSnapshot::TakeTrails() {
+  bool restore = m_restore_trails;
+
+  m_restore_trails = false;
+  return restore;
+}
+
+void RadarSnapshot::Close() {
+  if (!m_base) {
+    return;
+  }
+  GetHeader()->clean = 1;
+#ifdef __WXMSW__
+  FlushViewOfFile(m_base, m_size);
+#else
+  msync(m_base, m_size, MS_SYNC);
+#endif
+}
+
+void RadarSnapshot::Unmap() {
+#ifdef __WXMSW__
+  if (m_base) {
+    UnmapViewOfFile(m_base);
+  }
+  if (m_mapping) {
+    CloseHandle(m_mapping);
+    m_mapping = 0;
+  }
+  if (m_file != INVALID_HANDLE_VALUE) {
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (m_base) {
+    munmap(m_base, m_size);
+  }
+  if (m_fd >= 0) {
+    close(m_fd);
+    m_fd = -1;
+  }
+#endif
+  m_base = 0;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,144 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _RADAR_SNAPSHOT_H_
+#define _RADAR_SNAPSHOT_H_
+
+#include "TrailBuffer.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// A memory mapped file that holds the spoke history and the trails of one radar,
+// so that a restart of OpenCPN or of the plugin continues where it stopped.
+//
+// The history planes and the relative trails live in the mapping itself, so the
+// radar writes them there while it runs and the next start maps them back in O(1).
+// The remainder is small, or bounded, and is written when the radar is shut down:
+// the time and position of every spoke, the state of the trail levels, and up to
+// SNAPSHOT_TILES tiles of true trails, those of the level that is shown first.
+//
+// A snapshot is only used when it was written by the same radar type, and when
+// the plugin shut down cleanly. Otherwise it is cleared and started again.
+//
+
+#define SNAPSHOT_MAGIC "RADARPI\x01"
+#define SNAPSHOT_VERSION (2)
+#define SNAPSHOT_TILES (1024)  // True trail tiles in a snapshot, 4 MB
+#define SNAPSHOT_ALIGN (4096)  // Sections start on a page
+
+struct SnapshotLevel {
+  int32_t offset_lat;
+  int32_t offset_lon;
+  double dif_lat;
+  double dif_lon;
+};
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t clean;  // 1 when written at shutdown, 0 while the radar runs
+  int32_t radar_type;
+  uint32_t spokes;
+  uint32_t spoke_len;
+  uint32_t trail_size;  // of the tiles, 0 when there are none
+  uint32_t trail_levels;
+  uint32_t tiles;  // in use
+  double pixels_per_meter;
+  double lat;  // own position that the true trails belong to
+  double lon;
+  uint32_t true_revolution;
+  uint32_t relative_revolution;
+  SnapshotLevel level[TRAIL_LEVELS];
+};
+
+struct SnapshotSpoke {
+  int64_t time;
+  double lat;
+  double lon;
+};
+
+struct SnapshotTile {
+  uint16_t level;
+  uint16_t tile_x;
+  uint16_t tile_y;
+  uint16_t unused;
+};
+
+class RadarSnapshot {
+ public:
+  RadarSnapshot();
+  ~RadarSnapshot();
+
+  // Maps the file, creating or clearing it when it does not hold a snapshot of this radar.
+  // Returns false when the file can not be used at all.
+  bool Open(const wxString &filename, int radar_type, size_t spokes, size_t spoke_len);
+  // Marks the snapshot complete and flushes it to disk.
+  void Close();
+
+  bool Matches(int radar_type, size_t spokes, size_t spoke_len);
+  // True when the history holds the data of the previous run
+  bool IsRestored() { return m_restored; }
+  // True once, for the first TrailBuffer, when the trails of the previous run can be restored
+  bool TakeTrails();
+
+  SnapshotHeader *GetHeader() { return (SnapshotHeader *)m_base; }
+  SnapshotSpoke *GetSpokes() { return (SnapshotSpoke *)(m_base + m_spokes_offset); }
+  HistoryWord *GetHistoryPlanes() { return (HistoryWord *)(m_base + m_planes_offset); }
+  TrailRevolutionStamp *GetRelativeTrails() { return (TrailRevolutionStamp *)(m_base + m_relative_offset); }
+  SnapshotTile *GetTileDirectory() { return (SnapshotTile *)(m_base + m_directory_offset); }
+  TrailRevolutionStamp *GetTile(size_t n) {
+    return (TrailRevolutionStamp *)(m_base + m_tiles_offset) + n * TRAIL_TILE_PIXELS;
+  }
+
+ private:
+  void Unmap();
+
+#ifdef __WXMSW__
+  HANDLE m_file;
+  HANDLE m_mapping;
+#else
+  int m_fd;
+#endif
+  uint8_t *m_base;
+  size_t m_size;
+  size_t m_spokes_offset;
+  size_t m_planes_offset;
+  size_t m_relative_offset;
+  size_t m_directory_offset;
+  size_t m_tiles_offset;
+  bool m_restored;
+  bool m_restore_trails;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _RADAR_SNAPSHOT_H_ */
@@ -0,0 +1,199 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Checks that the scan to scan filter kernels give exactly the same bytes as the scalar
+ * versions, for odd lengths and unaligned buffers, and that ScanFilter combines the scans
+ * of a bearing as documented. Times the kernels at 2048 spokes of 1024 samples.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ScanFilter.h"
+
+using namespace std;
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define TEST_LEN (1024 + 64)
+
+static uint32_t seed = 12345;
+
+static void Random(uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    seed = seed * 1664525 + 1013904223;
+    data[i] = (uint8_t)(seed >> 24);
+  }
+}
+
+// Runs mode 1, 2 or 3 with the kernel and with the scalar version, and compares all three buffers
+static int CompareKernel(const char *name, int mode) {
+  uint8_t data[3][TEST_LEN + 1];
+  uint8_t expected[3][TEST_LEN + 1];
+
+  for (size_t len = 0; len <= TEST_LEN; len += (len < 80) ? 1 : 61) {
+    for (size_t offset = 0; offset < 2; offset++) {
+      for (int b = 0; b < 3; b++) {
+        Random(data[b], sizeof(data[b]));
+        memcpy(expected[b], data[b], sizeof(data[b]));
+      }
+      switch (mode) {
+        case SCAN_FILTER_BOTH:
+          ScanFilterBothScalar(expected[0] + offset, expected[1] + offset, len);
+          ScanFilterBoth(data[0] + offset, data[1] + offset, len);
+          break;
+        case SCAN_FILTER_MAJORITY:
+          ScanFilterMajorityScalar(expected[0] + offset, expected[1] + offset, expected[2] + offset, len);
+          ScanFilterMajority(data[0] + offset, data[1] + offset, data[2] + offset, len);
+          break;
+        case SCAN_FILTER_AVERAGE:
+          ScanFilterAverageScalar(expected[0] + offset, expected[1] + offset, len);
+          ScanFilterAverage(data[0] + offset, data[1] + offset, len);
+          break;
+      }
+      if (memcmp(expected, data, sizeof(data)) != 0) {
+        cout << "ERROR: " << name << " kernel len=" << len << " offset=" << offset << " differs from the scalar version\n";
+        return 1;
+      }
+    }
+  }
+  cout << "INFO: " << name << " kernel matches the scalar version\n";
+  return 0;
+}
+
+static int CheckFilter() {
+  ScanFilter filter(4, 16);
+  uint8_t data[16];
+  int ret = 0;
+
+  if (!filter.IsAllocated()) {
+    cout << "ERROR: ScanFilter out of memory\n";
+    return 1;
+  }
+
+  // An echo must be in both scans, the first scan passes as it is
+  memset(data, 200, sizeof(data));
+  filter.ProcessSpoke(1, data, sizeof(data), SCAN_FILTER_BOTH);
+  ret |= data[0] != 200;
+  memset(data, 50, sizeof(data));
+  filter.ProcessSpoke(1, data, sizeof(data), SCAN_FILTER_BOTH);
+  ret |= data[0] != 50;
+  memset(data, 100, sizeof(data));
+  filter.ProcessSpoke(1, data, sizeof(data), SCAN_FILTER_BOTH);
+  ret |= data[0] != 50;
+
+  // Two of three; the change of mode starts afresh
+  const uint8_t scans[5] = {10, 200, 30, 220, 40};
+  const uint8_t majority[5] = {10, 200, 30, 200, 40};
+  for (int s = 0; s < 5; s++) {
+    memset(data, scans[s], sizeof(data));
+    filter.ProcessSpoke(2, data, sizeof(data), SCAN_FILTER_MAJORITY);
+    ret |= data[15] != majority[s];
+  }
+
+  // The average moves a quarter of the way, rounded down
+  memset(data, 0, sizeof(data));
+  filter.ProcessSpoke(3, data, sizeof(data), SCAN_FILTER_AVERAGE);
+  memset(data, 255, sizeof(data));
+  filter.ProcessSpoke(3, data, sizeof(data), SCAN_FILTER_AVERAGE);
+  ret |= data[7] != 63;
+
+  // Off leaves the data alone
+  memset(data, 77, sizeof(data));
+  filter.ProcessSpoke(3, data, sizeof(data), SCAN_FILTER_OFF);
+  ret |= data[7] != 77;
+
+  if (ret) {
+    cout << "ERROR: ScanFilter does not combine the scans as documented\n";
+  }
+  return ret;
+}
+
+static void Time(int mode) {
+  const size_t spokes = 2048;
+  const size_t len = 1024;
+  const int revolutions = 50;
+  ScanFilter filter(spokes, len);
+  uint8_t data[len];
+
+  Random(data, len);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < revolutions; r++) {
+    for (size_t s = 0; s < spokes; s++) {
+      data[s % len] ^= (uint8_t)r;
+      filter.ProcessSpoke((int)s, data, len, mode);
+    }
+  }
+  std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+  // What a plain copy of every spoke costs, for comparison
+  uint8_t *store = (uint8_t *)malloc(spokes * len);
+  for (int r = 0; r < revolutions; r++) {
+    for (size_t s = 0; s < spokes; s++) {
+      data[s % len] ^= (uint8_t)r;
+      memcpy(store + s * len, data, len);
+    }
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  volatile uint8_t keep = store[(spokes / 2) * len];  // so that the copies are not optimized away
+  (void)keep;
+  free(store);
+
+  double n = (double)spokes * revolutions;
+  cout << "INFO: mode " << mode << " " << std::chrono::duration<double, std::nano>(middle - start).count() / n
+       << " ns/spoke, memcpy " << std::chrono::duration<double, std::nano>(end - middle).count() / n << " ns/spoke\n";
+}
+
+int main() {
+  int ret = 0;
+
+  cout << "INFO: the scan filter uses the " << ScanFilterKernelName() << " kernels\n";
+  ret |= CompareKernel("both", SCAN_FILTER_BOTH);
+  ret |= CompareKernel("majority", SCAN_FILTER_MAJORITY);
+  ret |= CompareKernel("average", SCAN_FILTER_AVERAGE);
+  ret |= CheckFilter();
+  for (int mode = SCAN_FILTER_BOTH; mode < SCAN_FILTER_MODES; mode++) {
+    Time(mode);
+  }
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { RadarPlugin::main(); }
@@ -0,0 +1,246 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "ScanFilter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCAN_FILTER_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SCAN_FILTER_NEON
+#include <arm_neon.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+static inline uint8_t Min8(uint8_t a, uint8_t b) { return a < b ? a : b; }
+static inline uint8_t Max8(uint8_t a, uint8_t b) { return a > b ? a : b; }
+
+void ScanFilterBothScalar(uint8_t *data, uint8_t *last, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t now = data[i];
+    data[i] = Min8(now, last[i]);
+    last[i] = now;
+  }
+}
+
+void ScanFilterMajorityScalar(uint8_t *data, const uint8_t *last, uint8_t *older, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t now = data[i];
+    data[i] = Max8(Min8(now, last[i]), Min8(Max8(now, last[i]), older[i]));
+    older[i] = now;
+  }
+}
+
+void ScanFilterAverageScalar(uint8_t *data, uint8_t *average, size_t len) {
+  // Two halving steps, as the SIMD kernels do them
+  for (size_t i = 0; i < len; i++) {
+    uint8_t half = (uint8_t)((average[i] + data[i]) >> 1);
+    average[i] = (uint8_t)((average[i] + half) >> 1);
+    data[i] = average[i];
+  }
+}
+
+#if defined(SCAN_FILTER_SSE2)
+
+// SSE2 only has a halving add that rounds up, so take off what it rounded up
+static inline __m128i HalveSSE2(__m128i a, __m128i b) {
+  return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+void ScanFilterBoth(uint8_t *data, uint8_t *last, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i now = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i previous = _mm_loadu_si128((const __m128i *)(last + i));
+    _mm_storeu_si128((__m128i *)(data + i), _mm_min_epu8(now, previous));
+    _mm_storeu_si128((__m128i *)(last + i), now);
+  }
+  ScanFilterBothScalar(data + i, last + i, len - i);
+}
+
+void ScanFilterMajority(uint8_t *data, const uint8_t *last, uint8_t *older, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i now = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i previous = _mm_loadu_si128((const __m128i *)(last + i));
+    __m128i before = _mm_loadu_si128((const __m128i *)(older + i));
+    __m128i low = _mm_min_epu8(now, previous);
+    __m128i high = _mm_max_epu8(now, previous);
+    _mm_storeu_si128((__m128i *)(data + i), _mm_max_epu8(low, _mm_min_epu8(high, before)));
+    _mm_storeu_si128((__m128i *)(older + i), now);
+  }
+  ScanFilterMajorityScalar(data + i, last + i, older + i, len - i);
+}
+
+void ScanFilterAverage(uint8_t *data, uint8_t *average, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i now = _mm_loadu_si128((const __m128i *)(data + i));
+    __m128i mean = _mm_loadu_si128((const __m128i *)(average + i));
+    mean = HalveSSE2(mean, HalveSSE2(mean, now));
+    _mm_storeu_si128((__m128i *)(data + i), mean);
+    _mm_storeu_si128((__m128i *)(average + i), mean);
+  }
+  ScanFilterAverageScalar(data + i, average + i, len - i);
+}
+
+const char *ScanFilterKernelName() { return "sse2"; }
+
+#elif defined(SCAN_FILTER_NEON)
+
+void ScanFilterBoth(uint8_t *data, uint8_t *last, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    uint8x16_t now = vld1q_u8(data + i);
+    vst1q_u8(data + i, vminq_u8(now, vld1q_u8(last + i)));
+    vst1q_u8(last + i, now);
+  }
+  ScanFilterBothScalar(data + i, last + i, len - i);
+}
+
+void ScanFilterMajority(uint8_t *data, const uint8_t *last, uint8_t *older, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    uint8x16_t now = vld1q_u8(data + i);
+    uint8x16_t previous = vld1q_u8(last + i);
+    uint8x16_t low = vminq_u8(now, previous);
+    uint8x16_t high = vmaxq_u8(now, previous);
+    vst1q_u8(data + i, vmaxq_u8(low, vminq_u8(high, vld1q_u8(older + i))));
+    vst1q_u8(older + i, now);
+  }
+  ScanFilterMajorityScalar(data + i, last + i, older + i, len - i);
+}
+
+void ScanFilterAverage(uint8_t *data, uint8_t *average, size_t len) {
+  size_t i;
+
+  for (i = 0; i + 16 <= len; i += 16) {
+    uint8x16_t mean = vld1q_u8(average + i);
+    mean = vhaddq_u8(mean, vhaddq_u8(mean, vld1q_u8(data + i)));
+    vst1q_u8(data + i, mean);
+    vst1q_u8(average + i, mean);
+  }
+  ScanFilterAverageScalar(data + i, average + i, len - i);
+}
+
+const char *ScanFilterKernelName() { return "neon"; }
+
+#else
+
+void ScanFilterBoth(uint8_t *data, uint8_t *last, size_t len) { ScanFilterBothScalar(data, last, len); }
+
+void ScanFilterMajority(uint8_t *data, const uint8_t *last, uint8_t *older, size_t len) {
+  ScanFilterMajorityScalar(data, last, older, len);
+}
+
+void ScanFilterAverage(uint8_t *data, uint8_t *average, size_t len) { ScanFilterAverageScalar(data, average, len); }
+
+const char *ScanFilterKernelName() { return "scalar"; }
+
+#endif
+
+ScanFilter::ScanFilter(size_t spokes, size_t spoke_len) {
+  m_spokes = spokes;
+  m_spoke_len = spoke_len;
+  m_mode = SCAN_FILTER_OFF;
+  // calloc, so that a radar that never uses the filter does not touch this memory
+  m_scans = (uint8_t *)calloc(spokes * SCAN_FILTER_SCANS, spoke_len);
+  m_state = (BearingState *)calloc(spokes, sizeof(BearingState));
+}
+
+ScanFilter::~ScanFilter() {
+  free(m_scans);
+  free(m_state);
+}
+
+void ScanFilter::Clear() {
+  // The scans themselves are not used until they are written again
+  memset(m_state, 0, m_spokes * sizeof(BearingState));
+}
+
+void ScanFilter::ProcessSpoke(int bearing, uint8_t *data, size_t len, int mode) {
+  if (mode != m_mode) {
+    Clear();
+    m_mode = mode;
+  }
+  if (mode <= SCAN_FILTER_OFF || mode >= SCAN_FILTER_MODES) {
+    return;
+  }
+  if (len > m_spoke_len) {
+    len = m_spoke_len;
+  }
+
+  BearingState *state = &m_state[bearing];
+  int newest = state->newest;
+  int oldest = 1 - newest;
+
+  switch (mode) {
+    case SCAN_FILTER_BOTH:
+      if (state->scans > 0) {
+        ScanFilterBoth(data, Scan(bearing, 0), len);
+      } else {
+        memcpy(Scan(bearing, 0), data, len);
+      }
+      break;
+
+    case SCAN_FILTER_MAJORITY:
+      // This scan takes the place of the oldest
+      if (state->scans == SCAN_FILTER_SCANS) {
+        ScanFilterMajority(data, Scan(bearing, newest), Scan(bearing, oldest), len);
+      } else {
+        memcpy(Scan(bearing, oldest), data, len);
+      }
+      state->newest = (uint8_t)oldest;
+      break;
+
+    case SCAN_FILTER_AVERAGE:
+      if (state->scans > 0) {
+        ScanFilterAverage(data, Scan(bearing, 0), len);
+      } else {
+        memcpy(Scan(bearing, 0), data, len);
+      }
+      break;
+  }
+  if (state->scans < SCAN_FILTER_SCANS) {
+    state->scans++;
+  }
+}
+
+PLUGIN_END_NAMESPACE
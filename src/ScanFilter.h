@@ -0,0 +1,104 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _SCAN_FILTER_H_
+#define _SCAN_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Scan to scan correlation. Rain and sea clutter come and go from one revolution to the next,
+// while real targets stay. The filter combines each spoke with the spokes at the same bearing
+// of the last revolutions, in place, before anything else looks at it:
+//
+//   SCAN_FILTER_BOTH:     the lower of this and the last scan, so an echo must be in both
+//   SCAN_FILTER_MAJORITY: the middle of this and the last two scans, an echo must be in two of three
+//   SCAN_FILTER_AVERAGE:  a running average that gives this scan a weight of 1/4
+//
+// The filter keeps at most two scans per bearing, and only writes one of them per spoke.
+// The kernels work on 16 samples at a time with SSE2 or NEON where the compiler targets these,
+// and must match the scalar versions byte for byte, see ScanFilter-test.cpp.
+//
+
+enum ScanFilterMode { SCAN_FILTER_OFF, SCAN_FILTER_BOTH, SCAN_FILTER_MAJORITY, SCAN_FILTER_AVERAGE, SCAN_FILTER_MODES };
+
+#define SCAN_FILTER_SCANS (2)  // scans stored per bearing
+
+// data = min(data, last), last = old data
+extern void ScanFilterBoth(uint8_t *data, uint8_t *last, size_t len);
+// data = median(data, last, older), older = old data
+extern void ScanFilterMajority(uint8_t *data, const uint8_t *last, uint8_t *older, size_t len);
+// average = average + (data - average) / 4 rounded down, data = average
+extern void ScanFilterAverage(uint8_t *data, uint8_t *average, size_t len);
+
+extern void ScanFilterBothScalar(uint8_t *data, uint8_t *last, size_t len);
+extern void ScanFilterMajorityScalar(uint8_t *data, const uint8_t *last, uint8_t *older, size_t len);
+extern void ScanFilterAverageScalar(uint8_t *data, uint8_t *average, size_t len);
+
+// Name of the kernels used, for logging and the test.
+extern const char *ScanFilterKernelName();
+
+class ScanFilter {
+ public:
+  ScanFilter(size_t spokes, size_t spoke_len);
+  ~ScanFilter();
+
+  bool IsAllocated() { return m_scans && m_state; }
+
+  // Call for every spoke with a ScanFilterMode. Filters data in place. When the mode changes
+  // the stored scans are forgotten, and until a bearing has enough scans its spokes pass as they are.
+  void ProcessSpoke(int bearing, uint8_t *data, size_t len, int mode);
+  void Clear();
+
+ private:
+  struct BearingState {
+    uint8_t scans;   // stored, up to SCAN_FILTER_SCANS
+    uint8_t newest;  // slot of the last scan
+  };
+
+  uint8_t *Scan(int bearing, int slot) { return m_scans + ((size_t)bearing * SCAN_FILTER_SCANS + slot) * m_spoke_len; }
+
+  size_t m_spokes;
+  size_t m_spoke_len;
+  int m_mode;
+
+  uint8_t *m_scans;        // m_spokes * SCAN_FILTER_SCANS * m_spoke_len
+  BearingState *m_state;  // m_spokes
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SCAN_FILTER_H_ */
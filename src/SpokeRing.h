@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _SPOKERING_H_
+#define _SPOKERING_H_
+
+#include <atomic>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// A single producer, single consumer ring buffer of fixed size records.
+//
+// The receive thread of a radar is the only producer and the RadarProcess thread
+// of that radar is the only consumer, so the two indices can be plain atomics:
+// each is written by one side only. Neither side ever takes a lock or waits.
+//
+// The records are filled and drained in place. The producer calls Reserve() to get
+// the next free record, fills it and publishes it with Commit(). The consumer calls
+// Peek() to get the oldest record and returns it with Release() when done.
+//
+// N must be a power of two.
+//
+
+template <typename T, size_t N>
+class SpokeRing {
+ public:
+  SpokeRing() {
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+  }
+
+  // Producer side. Returns 0 when the ring is full.
+  T *Reserve() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+
+    if (head - m_tail.load(std::memory_order_acquire) >= N) {
+      return 0;
+    }
+    return &m_records[head & (N - 1)];
+  }
+
+  // Producer side. Returns true if the ring was empty, e.g. the consumer may be waiting.
+  // The store of m_head and the load of m_tail (and the reverse in Release() and Peek())
+  // are sequentially consistent, otherwise both sides could miss each other's update
+  // and the consumer would go to sleep with a record in the ring.
+  bool Commit() {
+    size_t head = m_head.load(std::memory_order_relaxed);
+
+    m_head.store(head + 1, std::memory_order_seq_cst);
+    return head == m_tail.load(std::memory_order_seq_cst);
+  }
+
+  // Consumer side. Returns 0 when the ring is empty.
+  T *Peek() {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+
+    if (tail == m_head.load(std::memory_order_seq_cst)) {
+      return 0;
+    }
+    return &m_records[tail & (N - 1)];
+  }
+
+  // Consumer side.
+  void Release() { m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst); }
+
+  size_t Count() { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+
+ private:
+  static_assert((N & (N - 1)) == 0, "SpokeRing size must be a power of two");
+
+#define SPOKE_RING_CACHE_LINE (64)
+
+  // Keep the indices on separate cache lines so the two threads don't fight over them.
+  // Padding rather than alignas, as the ring lives on the heap and C++11 new ignores alignment.
+  std::atomic<size_t> m_head;  // Next record to be written, only written by the producer
+  char m_pad_head[SPOKE_RING_CACHE_LINE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> m_tail;  // Next record to be read, only written by the consumer
+  char m_pad_tail[SPOKE_RING_CACHE_LINE - sizeof(std::atomic<size_t>)];
+  T m_records[N];
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _SPOKERING_H_ */
@@ -0,0 +1,524 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Checks that the revolution stamps in TrailAge.h give the same trail colours as
+ * the per pixel age counters that TrailBuffer::UpdateRelativeTrails used to have,
+ * also after the revolution counter has been rebased. Checks that the TrailTiles
+ * torus of a true trails level keeps the same stamps as a flat image when the ship
+ * moves, so that only what scrolls into view is cleared. Times the old and new loops
+ * of both kinds of trails at 2048 spokes of 1024 pixels.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string.h>
+
+#include "TrailAge.h"
+#include "TrailTiles.h"
+
+using namespace std;
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define WEAK_TARGET (50)
+#define STRONG_TARGET (200)
+
+struct Trails {
+  int spokes;
+  int spoke_len;
+  TrailRevolutionsAge *ages;
+  TrailRevolutionStamp *stamps;
+  TrailClock clock;
+  uint8_t colour[TRAIL_MAX_REVOLUTIONS + 1];
+};
+
+// The loop as it was in TrailBuffer::UpdateRelativeTrails
+static void UpdateAges(Trails *t, int angle, uint8_t *data, int len, bool update) {
+  TrailRevolutionsAge *trail = t->ages + angle * t->spoke_len;
+  int radius = 0;
+
+  for (; radius < len - 1; radius++, trail++) {
+    if (data[radius] >= STRONG_TARGET) {
+      *trail = 1;
+    } else if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
+      (*trail)++;
+    }
+    if (update && (data[radius] < WEAK_TARGET)) {
+      data[radius] = t->colour[*trail];
+    }
+  }
+  for (; radius < t->spoke_len; radius++, trail++) {
+    *trail = 0;
+  }
+}
+
+// The loop as it is now
+static void UpdateStamps(Trails *t, int angle, uint8_t *data, int len, bool update) {
+  if (t->clock.Advance(angle, t->spokes)) {
+    t->clock.Rebase(t->stamps, t->spokes * t->spoke_len);
+    t->clock.Restart();
+  }
+  TrailRevolutionStamp now = t->clock.Now();
+  TrailRevolutionStamp *trail = t->stamps + angle * t->spoke_len;
+  int radius = 0;
+
+  if (update) {
+    for (; radius < len - 1; radius++, trail++) {
+      if (data[radius] >= STRONG_TARGET) {
+        *trail = now;
+      } else if (data[radius] < WEAK_TARGET) {
+        data[radius] = t->colour[t->clock.Age(*trail)];
+      }
+    }
+  } else {
+    for (; radius < len - 1; radius++, trail++) {
+      *trail = data[radius] >= STRONG_TARGET ? now : *trail;
+    }
+  }
+  if (radius < t->spoke_len) {
+    memset(trail, 0, (t->spoke_len - radius) * sizeof(TrailRevolutionStamp));
+  }
+}
+
+static void InitTrails(Trails *t, int spokes, int spoke_len) {
+  t->spokes = spokes;
+  t->spoke_len = spoke_len;
+  t->ages = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), spokes * spoke_len);
+  t->stamps = (TrailRevolutionStamp *)calloc(sizeof(TrailRevolutionStamp), spokes * spoke_len);
+  for (int i = 0; i <= TRAIL_MAX_REVOLUTIONS; i++) {
+    t->colour[i] = (uint8_t)i;  // a different colour per age, so every difference shows
+  }
+}
+
+static void FreeTrails(Trails *t) {
+  free(t->ages);
+  free(t->stamps);
+}
+
+// Synthetic spoke: clutter near the center, a coast line and a few targets that move
+// one spoke per revolution. Every 50th revolution the spoke is shorter.
+static int MakeSpoke(uint8_t *data, int spoke_len, int revolution, int angle, int spokes, uint32_t *seed) {
+  int len = revolution % 50 == 49 ? spoke_len / 2 : spoke_len;
+
+  for (int r = 0; r < spoke_len; r++) {
+    *seed = *seed * 1664525 + 1013904223;
+    uint8_t value = (uint8_t)(*seed >> 28);  // noise below WEAK_TARGET
+    if (r < spoke_len / 16 && (*seed >> 24) > 0xe0) {
+      value = 255;
+    }
+    if (angle < spokes / 4 && r > spoke_len * 3 / 4) {
+      value = 220;
+    }
+    for (int target = 1; target <= 4; target++) {
+      if ((angle + revolution * target) % spokes < 2 && r / 8 == spoke_len / 8 * target / 5) {
+        value = 255;
+      }
+    }
+    if (r == spoke_len / 2 && angle % 7 == 0) {
+      value = 100;  // between weak and strong, keeps its colour
+    }
+    data[r] = value;
+  }
+  return len;
+}
+
+// The true trails image used to be a flat array, updated through a polar to cartesian lookup. Now it
+// is one level of TrailTiles, a torus whose origin moves with the ship, that each spoke walks with a
+// fixed point step per bearing as in TrailBuffer::UpdateTrueTrails.
+#define STEP_SHIFT (16)
+
+struct TrueTrails {
+  int spokes;
+  int spoke_len;
+  int size;
+  int *points;  // spokes * spoke_len offsets into the image
+  TrailRevolutionsAge *ages;
+  TrailTilePool pool;
+  TrailTiles *tiles;
+  int offset_x;
+  int offset_y;
+  int *step_x;  // per bearing
+  int *step_y;
+  TrailClock clock;
+  uint8_t colour[TRAIL_MAX_REVOLUTIONS + 1];
+};
+
+static void InitTrueTrails(TrueTrails *t, int spokes, int spoke_len) {
+  t->spokes = spokes;
+  t->spoke_len = spoke_len;
+  t->size = 2 * spoke_len;
+  t->points = (int *)malloc(sizeof(int) * spokes * spoke_len);
+  t->ages = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), t->size * t->size);
+  t->tiles = new TrailTiles(&t->pool, t->size);
+  t->offset_x = 0;
+  t->offset_y = 0;
+  t->step_x = (int *)malloc(sizeof(int) * spokes);
+  t->step_y = (int *)malloc(sizeof(int) * spokes);
+  for (int angle = 0; angle < spokes; angle++) {
+    double a = angle * 2 * 3.14159265358979 / spokes;
+    for (int r = 0; r < spoke_len; r++) {
+      int x = (int)(r * cos(a)) + spoke_len;
+      int y = (int)(r * sin(a)) + spoke_len;
+      t->points[angle * spoke_len + r] = x * t->size + y;
+    }
+    // Slightly less than a cell per pixel, so the spoke stays within the image
+    t->step_x[angle] = (int)floor(cos(a) * 0.999 * (1 << STEP_SHIFT) + 0.5);
+    t->step_y[angle] = (int)floor(sin(a) * 0.999 * (1 << STEP_SHIFT) + 0.5);
+  }
+  for (int i = 0; i <= TRAIL_MAX_REVOLUTIONS; i++) {
+    t->colour[i] = (uint8_t)i;
+  }
+}
+
+static void FreeTrueTrails(TrueTrails *t) {
+  free(t->points);
+  free(t->ages);
+  delete t->tiles;
+  free(t->step_x);
+  free(t->step_y);
+}
+
+// The loops as they were in TrailBuffer::UpdateTrueTrails
+static void UpdateTrueAges(TrueTrails *t, int angle, uint8_t *data, int len, bool update) {
+  const int *point = t->points + angle * t->spoke_len;
+  int radius = 0;
+
+  for (; radius < len - 1; radius++) {
+    TrailRevolutionsAge *trail = t->ages + point[radius];
+    if (data[radius] >= STRONG_TARGET) {
+      *trail = 1;
+    } else if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
+      (*trail)++;
+    }
+    if (update && (data[radius] < WEAK_TARGET)) {
+      data[radius] = t->colour[*trail];
+    }
+  }
+  for (; radius < t->spoke_len; radius++) {
+    TrailRevolutionsAge *trail = t->ages + point[radius];
+    if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
+      (*trail)++;
+    }
+  }
+}
+
+// The loop as it is now
+static void UpdateTrueStamps(TrueTrails *t, int angle, uint8_t *data, int len, bool update) {
+  if (t->clock.Advance(angle, t->spokes)) {
+    t->tiles->Rebase(t->clock);
+    t->clock.Restart();
+  }
+  TrailRevolutionStamp now = t->clock.Now();
+  int fixed_x = (t->size / 2 + t->offset_x) << STEP_SHIFT;
+  int fixed_y = (t->size / 2 + t->offset_y) << STEP_SHIFT;
+
+  for (int radius = 0; radius < len - 1; radius++, fixed_x += t->step_x[angle], fixed_y += t->step_y[angle]) {
+    if (data[radius] < STRONG_TARGET && !(update && data[radius] < WEAK_TARGET)) {
+      continue;
+    }
+    int x = fixed_x >> STEP_SHIFT;
+    int y = fixed_y >> STEP_SHIFT;
+    x = x >= t->size ? x - t->size : x;
+    y = y >= t->size ? y - t->size : y;
+    if (data[radius] >= STRONG_TARGET) {
+      TrailRevolutionStamp *trail = t->tiles->GetForWrite(x, y);
+      if (trail) {
+        *trail = now;
+      }
+    } else {
+      data[radius] = t->colour[t->clock.Age(t->tiles->Get(x, y))];
+    }
+  }
+}
+
+// A level of true trails as TrailBuffer keeps it, next to the same image kept flat around the ship
+struct Torus {
+  int size;
+  TrailTilePool pool;
+  TrailTiles *tiles;
+  int offset_x;
+  int offset_y;
+  TrailRevolutionStamp *flat;  // size * size, relative to the ship
+  TrailClock clock;
+};
+
+#define WRAP(t, x) ((x) >= (t)->size ? (x) - (t)->size : (x))
+
+// As TrailBuffer::ClearLevelRows and ClearLevelColumns
+static void ClearTorusRows(Torus *t, int first, int count) {
+  int start = WRAP(t, first + t->offset_x);
+  int before_wrap = count < t->size - start ? count : t->size - start;
+
+  t->tiles->ClearRows(start, before_wrap);
+  if (count > before_wrap) {
+    t->tiles->ClearRows(0, count - before_wrap);
+  }
+}
+
+static void ClearTorusColumns(Torus *t, int first, int count) {
+  int start = WRAP(t, first + t->offset_y);
+  int before_wrap = count < t->size - start ? count : t->size - start;
+
+  t->tiles->ClearColumns(start, before_wrap);
+  if (count > before_wrap) {
+    t->tiles->ClearColumns(0, count - before_wrap);
+  }
+}
+
+// As TrailBuffer::MoveLevel, with the shift in cells
+static void MoveTorus(Torus *t, int shift_x, int shift_y) {
+  if (shift_x >= t->size || shift_x <= -t->size || shift_y >= t->size || shift_y <= -t->size) {
+    t->tiles->Clear();
+    t->offset_x = 0;
+    t->offset_y = 0;
+    return;
+  }
+  if (shift_x != 0) {
+    t->offset_x = (t->offset_x + shift_x + t->size) % t->size;
+    if (shift_x > 0) {
+      ClearTorusRows(t, t->size - shift_x, shift_x);
+    } else {
+      ClearTorusRows(t, 0, -shift_x);
+    }
+  }
+  if (shift_y != 0) {
+    t->offset_y = (t->offset_y + shift_y + t->size) % t->size;
+    if (shift_y > 0) {
+      ClearTorusColumns(t, t->size - shift_y, shift_y);
+    } else {
+      ClearTorusColumns(t, 0, -shift_y);
+    }
+  }
+}
+
+// The flat image scrolls the other way, and what comes into view is empty
+static void MoveFlat(Torus *t, int shift_x, int shift_y) {
+  TrailRevolutionStamp *moved = (TrailRevolutionStamp *)calloc(sizeof(TrailRevolutionStamp), t->size * t->size);
+
+  for (int x = 0; x < t->size; x++) {
+    for (int y = 0; y < t->size; y++) {
+      int from_x = x + shift_x;
+      int from_y = y + shift_y;
+      if (from_x >= 0 && from_x < t->size && from_y >= 0 && from_y < t->size) {
+        moved[x * t->size + y] = t->flat[from_x * t->size + from_y];
+      }
+    }
+  }
+  free(t->flat);
+  t->flat = moved;
+}
+
+static int CompareTorus(Torus *t) {
+  for (int x = 0; x < t->size; x++) {
+    for (int y = 0; y < t->size; y++) {
+      if (t->tiles->Get(WRAP(t, x + t->offset_x), WRAP(t, y + t->offset_y)) != t->flat[x * t->size + y]) {
+        cout << "ERROR: torus differs at " << x << ", " << y << " with offset " << t->offset_x << ", " << t->offset_y << "\n";
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+// Stamps random cells, moves the ship by shifts that wrap around the torus in both directions, and
+// runs the revolution counter past a rebase.
+static int CheckTorus(int size) {
+  Torus t;
+  uint32_t seed = 4711;
+  int ret = 0;
+  int moves = 0;
+
+  t.size = size;
+  t.tiles = new TrailTiles(&t.pool, size);
+  t.offset_x = 0;
+  t.offset_y = 0;
+  t.flat = (TrailRevolutionStamp *)calloc(sizeof(TrailRevolutionStamp), size * size);
+
+  for (int revolution = 0; revolution < TRAIL_LAST_REVOLUTION + TRAIL_MAX_REVOLUTIONS && ret == 0; revolution++) {
+    t.clock.Advance(3, 4);
+    if (t.clock.Advance(0, 4)) {
+      t.tiles->Rebase(t.clock);
+      t.clock.Rebase(t.flat, size * size);
+      t.clock.Restart();
+    }
+    for (int n = 0; n < 40; n++) {
+      seed = seed * 1664525 + 1013904223;
+      int x = (seed >> 8) % size;
+      int y = (seed >> 20) % size;
+      TrailRevolutionStamp *trail = t.tiles->GetForWrite(WRAP(&t, x + t.offset_x), WRAP(&t, y + t.offset_y));
+      if (trail) {
+        *trail = t.clock.Now();
+      }
+      t.flat[x * size + y] = t.clock.Now();
+    }
+
+    seed = seed * 1664525 + 1013904223;
+    int shift_x = 0;
+    int shift_y = 0;
+    switch (revolution % 8) {
+      case 0:  // less than a tile
+        shift_x = (int)(seed >> 27) - 16;
+        shift_y = (int)((seed >> 22) & 31) - 16;
+        break;
+      case 3:  // more than a tile, less than the image
+        shift_x = (int)((seed >> 8) % (2 * size - 1)) - (size - 1);
+        shift_y = (int)((seed >> 20) % (2 * size - 1)) - (size - 1);
+        break;
+      case 5:  // exactly a tile, so whole tiles are released
+        shift_x = seed & 1 ? TRAIL_TILE_SIZE : -TRAIL_TILE_SIZE;
+        shift_y = seed & 2 ? TRAIL_TILE_SIZE : -TRAIL_TILE_SIZE;
+        break;
+      case 7:
+        if (revolution % 200 == 199) {  // off the image, the level is reset
+          shift_x = size + 3;
+        }
+        break;
+    }
+    if (shift_x == 0 && shift_y == 0) {
+      continue;
+    }
+    MoveTorus(&t, shift_x, shift_y);
+    MoveFlat(&t, shift_x, shift_y);
+    moves++;
+    ret = CompareTorus(&t);
+  }
+  if (ret == 0) {
+    cout << "INFO: " << size << " x " << size << " torus keeps the same stamps over " << moves << " moves\n";
+  }
+  delete t.tiles;
+  free(t.flat);
+  return ret;
+}
+
+static int Compare(int spokes, int spoke_len, int revolutions) {
+  Trails t;
+  uint8_t *expected = (uint8_t *)malloc(spoke_len);
+  uint8_t *actual = (uint8_t *)malloc(spoke_len);
+  uint32_t seed = 4711;
+  int ret = 0;
+
+  InitTrails(&t, spokes, spoke_len);
+  for (int revolution = 0; revolution < revolutions && ret == 0; revolution++) {
+    for (int angle = 0; angle < spokes; angle++) {
+      int len = MakeSpoke(expected, spoke_len, revolution, angle, spokes, &seed);
+      memcpy(actual, expected, spoke_len);
+      UpdateAges(&t, angle, expected, len, true);
+      UpdateStamps(&t, angle, actual, len, true);
+      if (memcmp(expected, actual, spoke_len) != 0) {
+        cout << "ERROR: colours differ in revolution " << revolution << " angle " << angle << "\n";
+        ret = 1;
+        break;
+      }
+    }
+  }
+  if (ret == 0) {
+    cout << "INFO: " << spokes << " x " << spoke_len << " for " << revolutions << " revolutions gives the same colours\n";
+  }
+  FreeTrails(&t);
+  free(expected);
+  free(actual);
+  return ret;
+}
+
+// Lowest time of three runs, in ns per spoke
+template <typename T>
+static double Bench(void (*update)(T *t, int angle, uint8_t *data, int len, bool update), T *t, const uint8_t *spokes,
+                    int revolutions, bool show) {
+  uint8_t *data = (uint8_t *)malloc(t->spoke_len);
+  double best = 0.;
+  volatile unsigned sum = 0;  // so that the compiler can not skip the work
+
+  for (int run = 0; run < 3; run++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int revolution = 0; revolution < revolutions; revolution++) {
+      for (int angle = 0; angle < t->spokes; angle++) {
+        memcpy(data, spokes + angle * t->spoke_len, t->spoke_len);
+        update(t, angle, data, t->spoke_len, show);
+        sum = sum + data[angle % t->spoke_len];
+      }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / (revolutions * t->spokes);
+    if (run == 0 || ns < best) {
+      best = ns;
+    }
+  }
+  free(data);
+  return best;
+}
+
+int main() {
+  int ret = 0;
+
+  ret |= Compare(256, 128, 3 * TRAIL_MAX_REVOLUTIONS);
+  // Long enough for the revolution counter to be rebased
+  ret |= Compare(16, 64, TRAIL_LAST_REVOLUTION + 3 * TRAIL_MAX_REVOLUTIONS);
+  ret |= CheckTorus(4 * TRAIL_TILE_SIZE);
+  ret |= CheckTorus(5 * TRAIL_TILE_SIZE);
+
+  const int spokes = 2048;
+  const int spoke_len = 1024;
+  const int revolutions = 5;
+  Trails t;
+  TrueTrails tt;
+  uint8_t *data = (uint8_t *)malloc(spokes * spoke_len);
+  uint32_t seed = 4711;
+
+  InitTrails(&t, spokes, spoke_len);
+  InitTrueTrails(&tt, spokes, spoke_len);
+  for (int angle = 0; angle < spokes; angle++) {
+    MakeSpoke(data + angle * spoke_len, spoke_len, 0, angle, spokes, &seed);
+  }
+  for (int show = 0; show < 2; show++) {
+    double ages = Bench(UpdateAges, &t, data, revolutions, show);
+    double stamps = Bench(UpdateStamps, &t, data, revolutions, show);
+    double true_ages = Bench(UpdateTrueAges, &tt, data, revolutions, show);
+    double true_stamps = Bench(UpdateTrueStamps, &tt, data, revolutions, show);
+    cout << "INFO: ns per " << spoke_len << " pixel spoke with trails " << (show ? "shown" : "hidden") << ": relative ages "
+         << ages << ", stamps " << stamps << "; true ages " << true_ages << ", stamps " << true_stamps << "\n";
+  }
+  FreeTrails(&t);
+  FreeTrueTrails(&tt);
+  free(data);
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { RadarPlugin::main(); }
@@ -0,0 +1,134 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _TRAIL_AGE_H_
+#define _TRAIL_AGE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define SECONDS_TO_REVOLUTIONS(x) ((x)*2 / 5)
+#define TRAIL_MAX_REVOLUTIONS (SECONDS_TO_REVOLUTIONS(600) + 1)
+
+typedef uint8_t TrailRevolutionsAge;
+
+//
+// The trail buffers store the revolution in which a strong target was last seen
+// in each pixel, not the age of that target. The age is computed when the pixel is
+// read, as the current revolution minus the stamp plus one, and it stops at
+// TRAIL_MAX_REVOLUTIONS. Pixels without an echo need no work at all.
+//
+// A stamp of 0 means that the pixel never saw a target. The stamps are as small as the
+// ages were, so the buffers take no more memory or cache than before. Because of that the
+// revolution counter runs out every TRAIL_LAST_REVOLUTION - TRAIL_FIRST_REVOLUTION revolutions.
+// Rebase() then moves all stamps back in one sequential pass, and Restart() starts the
+// counter again at TRAIL_FIRST_REVOLUTION.
+//
+
+typedef uint8_t TrailRevolutionStamp;
+
+#define TRAIL_FIRST_REVOLUTION (TRAIL_MAX_REVOLUTIONS + 1)
+#define TRAIL_LAST_REVOLUTION (UINT8_MAX)
+
+class TrailClock {
+ public:
+  TrailClock() {
+    m_revolution = TRAIL_FIRST_REVOLUTION;
+    m_last_angle = -1;
+    ComputeAges();
+  }
+
+  // Call for every spoke, with the angle that the spoke is stored at. The revolution
+  // is counted when the angle wraps around. Returns true when the caller must call
+  // Rebase() on all its stamps and then Restart().
+  bool Advance(int angle, int spokes) {
+    bool wrapped = m_last_angle >= 0 && angle < m_last_angle - spokes / 2;
+
+    m_last_angle = angle;
+    if (wrapped) {
+      m_revolution++;
+      ComputeAges();
+      return m_revolution == TRAIL_LAST_REVOLUTION;
+    }
+    return false;
+  }
+
+  TrailRevolutionStamp Now() const { return m_revolution; }
+
+  TrailRevolutionsAge Age(TrailRevolutionStamp stamp) const { return m_age[stamp]; }
+
+  // Move the stamps along so that they keep their age after Restart(). Stamps that have
+  // reached TRAIL_MAX_REVOLUTIONS become 1, which keeps them at that age.
+  void Rebase(TrailRevolutionStamp *stamps, size_t count) const {
+    TrailRevolutionStamp shift = m_revolution - TRAIL_FIRST_REVOLUTION;
+    TrailRevolutionStamp oldest = m_revolution - TRAIL_MAX_REVOLUTIONS + 2;  // older stamps are at the maximum age
+
+    for (size_t i = 0; i < count; i++) {
+      TrailRevolutionStamp stamp = stamps[i];
+      stamps[i] = stamp == 0 ? 0 : stamp < oldest ? 1 : stamp - shift;
+    }
+  }
+
+  // Restart the counter at TRAIL_FIRST_REVOLUTION, once all stamps have been rebased.
+  void Restart() {
+    m_revolution = TRAIL_FIRST_REVOLUTION;
+    ComputeAges();
+  }
+
+  // Continue at a revolution that was saved with the stamps, as when restoring a snapshot.
+  void Set(TrailRevolutionStamp revolution) {
+    m_revolution = revolution < TRAIL_FIRST_REVOLUTION ? TRAIL_FIRST_REVOLUTION : revolution;
+    m_last_angle = -1;
+    ComputeAges();
+  }
+
+ private:
+  // The age of every possible stamp in this revolution, so that Age() is a single lookup
+  void ComputeAges() {
+    m_age[0] = 0;
+    for (int stamp = 1; stamp <= TRAIL_LAST_REVOLUTION; stamp++) {
+      int age = m_revolution - stamp + 1;
+      m_age[stamp] = (TrailRevolutionsAge)(age < 1 ? 0 : age < TRAIL_MAX_REVOLUTIONS ? age : TRAIL_MAX_REVOLUTIONS);
+    }
+  }
+
+  TrailRevolutionStamp m_revolution;
+  int m_last_angle;
+  TrailRevolutionsAge m_age[TRAIL_LAST_REVOLUTION + 1];
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _TRAIL_AGE_H_ */
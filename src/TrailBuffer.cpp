@@ -30,6 +30,7 @@
  */
 
 #include "TrailBuffer.h"
+#include "RadarSnapshot.h"
 
 #undef M_SETTINGS
 #define M_SETTINGS m_ri->m_pi->m_settings
@@ -42,34 +43,58 @@ PLUGIN_BEGIN_NAMESPACE
 // Striding the first dimension makes for better locality because
 // we generally iterate over the range (process one spoke) so those
 // values are now closer together in memory.
-#define M_TRUE_TRAILS_STRIDE m_trail_size
-#define M_TRUE_TRAILS(x, y) m_true_trails[x * M_TRUE_TRAILS_STRIDE + y]
 #define M_RELATIVE_TRAILS_STRIDE m_max_spoke_len
-#define M_RELATIVE_TRAILS(x, y) m_relative_trails[x * M_RELATIVE_TRAILS_STRIDE + y]
+#define M_RELATIVE_TRAILS(x, y) m_relative_trails[(x)*M_RELATIVE_TRAILS_STRIDE + (y)]
+
+// Each level of true trails is a torus, stored in sparse tiles. Coordinates relative to the ship,
+// which run from 0 to m_trail_size with the ship in the middle, are mapped to the level by adding
+// its offset modulo m_trail_size. When the ship moves only the offset changes; the rows and columns
+// that scroll into view on one side are the ones that just scrolled out on the other side.
+#define M_WRAP(x) ((x) >= m_trail_size ? (x)-m_trail_size : (x))
 
 TrailBuffer::TrailBuffer(RadarInfo *ri, size_t spokes, size_t max_spoke_len) {
   m_ri = ri;
   m_spokes = spokes;
   m_max_spoke_len = (int)max_spoke_len;
   m_previous_pixels_per_meter = 0.;
-  m_trail_size = max_spoke_len * 2 + MARGIN * 2;
-  m_true_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_trail_size * m_trail_size);
-  m_relative_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_spokes * m_max_spoke_len);
-  m_copy_true_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_trail_size * m_trail_size);
-  m_copy_relative_trails = (TrailRevolutionsAge *)calloc(sizeof(TrailRevolutionsAge), m_spokes * m_max_spoke_len);
+  m_shown_level = 0;
+  m_trail_size = (max_spoke_len * 2 + TRAIL_TILE_MASK) & ~TRAIL_TILE_MASK;
+  m_relative_trails_mapped = m_ri->m_snapshot != 0;
+  if (m_relative_trails_mapped) {
+    m_relative_trails = m_ri->m_snapshot->GetRelativeTrails();
+  } else {
+    m_relative_trails = (TrailRevolutionStamp *)calloc(sizeof(TrailRevolutionStamp), m_spokes * m_max_spoke_len);
+  }
+  m_copy_relative_trails = (TrailRevolutionStamp *)calloc(sizeof(TrailRevolutionStamp), m_spokes * m_max_spoke_len);
+  m_true_trails_step = (GeoPositionPixels *)calloc(sizeof(GeoPositionPixels), m_spokes);
+  m_true_trails_len = (int *)calloc(sizeof(int), m_spokes);
+
+  bool allocated = m_relative_trails && m_copy_relative_trails && m_true_trails_step && m_true_trails_len;
+  for (int l = 0; l < TRAIL_LEVELS; l++) {
+    m_levels[l].meters_per_cell = TRAIL_LEVEL_0_METERS * (1 << l);
+    m_levels[l].tiles = new TrailTiles(&m_tile_pool, m_trail_size);
+    allocated = allocated && m_levels[l].tiles->IsAllocated();
+  }
 
-  if (!m_true_trails || !m_relative_trails || !m_copy_true_trails || !m_copy_relative_trails) {
+  if (!allocated) {
     wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
     wxAbort();
   }
-  ClearTrails();
+  if (!m_ri->m_snapshot || !m_ri->m_snapshot->TakeTrails() || !RestoreSnapshot(m_ri->m_snapshot)) {
+    ClearTrails();
+  }
 }
 
 TrailBuffer::~TrailBuffer() {
-  free(m_true_trails);
-  free(m_relative_trails);
+  for (int l = 0; l < TRAIL_LEVELS; l++) {
+    delete m_levels[l].tiles;
+  }
+  if (!m_relative_trails_mapped) {
+    free(m_relative_trails);
+  }
   free(m_copy_relative_trails);
-  free(m_copy_true_trails);
+  free(m_true_trails_step);
+  free(m_true_trails_len);
 }
 
 void TrailBuffer::UpdateTrueTrails(SpokeBearing bearing, uint8_t *data, size_t len) {
@@ -79,46 +104,41 @@ void TrailBuffer::UpdateTrueTrails(SpokeBearing bearing, uint8_t *data, size_t l
 
   uint8_t weak_target = M_SETTINGS.threshold_blue;
   uint8_t strong_target = M_SETTINGS.threshold_red;
-  size_t radius = 0;
-
-  for (; radius < len - 1; radius++) {  //  len - 1 : no trails on range circle
-    PointInt point = m_ri->m_polar_lookup->GetPointInt(bearing, radius);
 
-    point.x += m_trail_size / 2 + m_offset.lat;
-    point.y += m_trail_size / 2 + m_offset.lon;
-
-    if (point.x >= 0 && point.x < (int)m_trail_size && point.y >= 0 && point.y < (int)m_trail_size) {
-      uint8_t *trail = &M_TRUE_TRAILS(point.x, point.y);
-      // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
-      // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
-      if (data[radius] >= strong_target) {
-        *trail = 1;
-      } else if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-        (*trail)++;
-      }
-
-      if (update_targets_true && (data[radius] < weak_target)) {
-        data[radius] = m_ri->m_trail_colour[*trail];
-      }
+  if (m_ri->m_pixels_per_meter == 0.) {
+    return;
+  }
+  if (m_true_clock.Advance(bearing, m_spokes)) {
+    for (int l = 0; l < TRAIL_LEVELS; l++) {
+      m_levels[l].tiles->Rebase(m_true_clock);
     }
+    m_true_clock.Restart();
   }
-
-  // Now process the rest of the spoke from len to m_spoke_len_max.
-  // This will only be called when the current spoke length is smaller than the max.
-  // we need to update the trail 'age' for those points.
-  for (; radius < m_ri->m_spoke_len_max; radius++) {
-    PointInt point = m_ri->m_polar_lookup->GetPointInt(bearing, radius);
-
-    point.x += m_trail_size / 2 + m_offset.lat;
-    point.y += m_trail_size / 2 + m_offset.lon;
-
-    if (point.x >= 0 && point.x < (int)m_trail_size && point.y >= 0 && point.y < (int)m_trail_size) {
-      uint8_t *trail = &M_TRUE_TRAILS(point.x, m_trail_size + point.y);
-      // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
-      // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
-      if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-        (*trail)++;
+  TrailRevolutionStamp now = m_true_clock.Now();
+
+  // when ship moves north, offset.lat > 0. Add to move trails image in opposite direction
+  // when ship moves east, offset.lon > 0. Add to move trails image in opposite direction
+  TrailLevel *level = &m_levels[m_shown_level];
+  GeoPositionPixels step = m_true_trails_step[bearing];
+  int fixed_x = (m_trail_size / 2 + level->offset.lat) << TRAIL_STEP_SHIFT;
+  int fixed_y = (m_trail_size / 2 + level->offset.lon) << TRAIL_STEP_SHIFT;
+  int length = wxMin((int)len - 1, m_true_trails_len[bearing]);  //  len - 1 : no trails on range circle
+
+  // Only pixels with an echo, and pixels that are shown as trail, are visited. The age of
+  // all other pixels follows from their stamp, so the part of the spoke beyond len needs no work.
+  for (int radius = 0; radius < length; radius++, fixed_x += step.lat, fixed_y += step.lon) {
+    if (data[radius] < strong_target && !(update_targets_true && data[radius] < weak_target)) {
+      continue;
+    }
+    int x = M_WRAP(fixed_x >> TRAIL_STEP_SHIFT);
+    int y = M_WRAP(fixed_y >> TRAIL_STEP_SHIFT);
+    if (data[radius] >= strong_target) {
+      TrailRevolutionStamp *trail = level->tiles->GetForWrite(x, y);
+      if (trail) {
+        *trail = now;
       }
+    } else {
+      data[radius] = m_ri->m_trail_colour[m_true_clock.Age(level->tiles->Get(x, y))];
     }
   }
 }
@@ -128,38 +148,42 @@ void TrailBuffer::UpdateRelativeTrails(SpokeBearing angle, uint8_t *data, size_t
   RadarControlState trails = m_ri->m_target_trails.GetState();
   bool update_relative_motion = trails != RCS_OFF && motion == TARGET_MOTION_RELATIVE;
 
-  uint8_t *trail = &M_RELATIVE_TRAILS(angle, 0);
+  if (m_relative_clock.Advance(angle, m_spokes)) {
+    m_relative_clock.Rebase(m_relative_trails, m_spokes * m_max_spoke_len);
+    m_relative_clock.Restart();
+  }
+  TrailRevolutionStamp now = m_relative_clock.Now();
+
+  TrailRevolutionStamp *trail = &M_RELATIVE_TRAILS(angle, 0);
   uint8_t weak_target = M_SETTINGS.threshold_blue;
   uint8_t strong_target = M_SETTINGS.threshold_red;
   int radius = 0;
   int length = int(len);
 
-  for (; radius < length - 1; radius++, trail++) {  // len - 1 : no trails on range circle
-    if (data[radius] >= strong_target) {
-      *trail = 1;
-    } else if (*trail > 0 && *trail < TRAIL_MAX_REVOLUTIONS) {
-      (*trail)++;
+  if (update_relative_motion) {
+    for (; radius < length - 1; radius++, trail++) {  // len - 1 : no trails on range circle
+      if (data[radius] >= strong_target) {
+        *trail = now;
+      } else if (data[radius] < weak_target) {
+        data[radius] = m_ri->m_trail_colour[m_relative_clock.Age(*trail)];
+      }
     }
-
-    if (update_relative_motion && (data[radius] < weak_target)) {
-      data[radius] = m_ri->m_trail_colour[*trail];
+  } else {
+    for (; radius < length - 1; radius++, trail++) {
+      *trail = data[radius] >= strong_target ? now : *trail;
     }
   }
 
-  for (; radius < m_max_spoke_len; radius++, trail++)  // And clear out empty bit of spoke when spoke_len < max_spoke_len
-  {
-    *trail = 0;
+  if (radius < m_max_spoke_len) {  // And clear out empty bit of spoke when spoke_len < max_spoke_len
+    memset(trail, 0, (m_max_spoke_len - radius) * sizeof(TrailRevolutionStamp));
   }
 }
 
-// Zooms the trailbuffer (containing image of true trails) in and out
-// This version assumes m_offset.lon and m_offset.lat to be zero (earlier versions did zoom offset as well)
-// zoom_factor > 1 -> zoom in, enlarge image
-void TrailBuffer::ZoomTrails(float zoom_factor) {
-  uint8_t *flip;
-  memset(m_copy_relative_trails, 0, m_spokes * m_max_spoke_len);
 
-  // zoom relative trails
+// Zooms the relative trails in and out, these are stored per spoke pixel.
+// zoom_factor > 1 -> zoom in, enlarge image
+void TrailBuffer::ZoomRelativeTrails(float zoom_factor) {
+  memset(m_copy_relative_trails, 0, m_spokes * m_max_spoke_len * sizeof(TrailRevolutionStamp));
 
   for (int i = 0; i < (int)m_spokes; i++) {
     for (int j = 0; j < m_max_spoke_len; j++) {
@@ -170,85 +194,108 @@ void TrailBuffer::ZoomTrails(float zoom_factor) {
       }
     }
   }
-  // Now exchange the two
-  flip = m_relative_trails;
-  m_relative_trails = m_copy_relative_trails;
-  m_copy_relative_trails = flip;
+  // Copy back, the relative trails may live in the snapshot
+  memcpy(m_relative_trails, m_copy_relative_trails, m_spokes * m_max_spoke_len * sizeof(TrailRevolutionStamp));
+}
 
-  memset(m_copy_true_trails, 0, m_trail_size * m_trail_size);
+// The level that is shown is the one whose cells are closest to a spoke pixel, from 0.7 to 1.4 pixels
+void TrailBuffer::SelectLevel() {
+  double meters_per_pixel = 1. / m_ri->m_pixels_per_meter;
+  int half = m_trail_size / 2;
 
-  // zoom true trails
-  for (int i = MARGIN; i < m_trail_size - MARGIN; i++) {
-    int index_i = (int)(((double)i - (double)m_trail_size / 2) * zoom_factor + (double)m_trail_size / 2);
-    if (index_i >= m_trail_size - 1) {
-      break;  // allow adding an additional pixel later
-    }
-    if (index_i < 0) {
-      continue;
-    }
-    for (int j = MARGIN; j < m_trail_size - MARGIN; j++) {
-      int index_j = (int)(((double)j - (double)m_trail_size / 2) * zoom_factor + (double)m_trail_size / 2);
-      if (index_j >= (int)m_trail_size - 1) {
-        break;
-      }
-      if (index_j < 0) {
+  m_shown_level = 0;
+  while (m_shown_level < TRAIL_LEVELS - 1 && m_levels[m_shown_level].meters_per_cell * sqrt(2.) < meters_per_pixel) {
+    m_shown_level++;
+  }
+  double scale = meters_per_pixel / m_levels[m_shown_level].meters_per_cell;
+
+  // UpdateTrueTrails walks a spoke through the level by adding step, in fixed point, for every
+  // pixel. The bounds check is folded into the spoke length: a spoke that leaves the level does
+  // not come back.
+  for (size_t bearing = 0; bearing < m_spokes; bearing++) {
+    GeoPositionPixels step;
+    step.lat = (int)floor(cos(bearing * 2 * PI / m_spokes) * scale * (1 << TRAIL_STEP_SHIFT) + 0.5);
+    step.lon = (int)floor(sin(bearing * 2 * PI / m_spokes) * scale * (1 << TRAIL_STEP_SHIFT) + 0.5);
+    m_true_trails_step[bearing] = step;
+
+    int most = wxMax(abs(step.lat), abs(step.lon));
+    int64_t length = most ? (((int64_t)(half - 1) << TRAIL_STEP_SHIFT) / most) + 1 : m_max_spoke_len;
+    m_true_trails_len[bearing] = (int)wxMin(length, (int64_t)m_max_spoke_len);
+  }
+  LOG_VERBOSE(wxT("radar_pi: %s showing true trails with %g meters per cell"), m_ri->m_name.c_str(),
+              m_levels[m_shown_level].meters_per_cell);
+}
+
+// Merges the trails of one level into another one, keeping the most recent stamp of each cell.
+// Only called when the level that is shown changes, as echoes are only stamped into that level.
+void TrailBuffer::ResampleLevel(int from_level, int to_level) {
+  TrailLevel *from = &m_levels[from_level];
+  TrailLevel *to = &m_levels[to_level];
+  int half = m_trail_size / 2;
+  int coarser = wxMax(to_level - from_level, 0);     // the cells of to are 2^coarser times as large
+  int cells = 1 << wxMax(from_level - to_level, 0);  // or a cell of from covers cells * cells cells of to
+  int grid = from->tiles->GetGrid();
+
+  for (int tile_x = 0; tile_x < grid; tile_x++) {
+    for (int tile_y = 0; tile_y < grid; tile_y++) {
+      TrailRevolutionStamp *tile = from->tiles->GetTile(tile_x, tile_y);
+      if (!tile) {
         continue;
       }
-      uint8_t pixel = M_TRUE_TRAILS(i, j);
-      if (pixel != 0) {  // many to one mapping, prevent overwriting trails with 0
-        m_copy_true_trails[index_i * M_TRUE_TRAILS_STRIDE + index_j] = pixel;
-        if (zoom_factor > 1.2) {
-          // add an extra pixel in the y direction
-          m_copy_true_trails[index_i * M_TRUE_TRAILS_STRIDE + index_j + 1] = pixel;
-          if (zoom_factor > 1.6) {
-            // also add pixels in the x direction
-            m_copy_true_trails[(index_i + 1) * M_TRUE_TRAILS_STRIDE + index_j] = pixel;
-            m_copy_true_trails[(index_i + 1) * M_TRUE_TRAILS_STRIDE + index_j + 1] = pixel;
+      for (int a = 0; a < TRAIL_TILE_SIZE; a++) {
+        // From the position in the tiles back to the position relative to the ship, and on to the other level
+        int ship_x = ((tile_x << TRAIL_TILE_SHIFT) + a - from->offset.lat + m_trail_size) % m_trail_size - half;
+        int first_x = (ship_x >> coarser) * cells + half;
+        if (first_x + cells <= 0 || first_x >= m_trail_size) {
+          continue;
+        }
+        for (int b = 0; b < TRAIL_TILE_SIZE; b++) {
+          TrailRevolutionStamp stamp = tile[a * TRAIL_TILE_SIZE + b];
+          if (!stamp) {
+            continue;
+          }
+          int ship_y = ((tile_y << TRAIL_TILE_SHIFT) + b - from->offset.lon + m_trail_size) % m_trail_size - half;
+          int first_y = (ship_y >> coarser) * cells + half;
+
+          for (int x = wxMax(first_x, 0); x < wxMin(first_x + cells, m_trail_size); x++) {
+            for (int y = wxMax(first_y, 0); y < wxMin(first_y + cells, m_trail_size); y++) {
+              TrailRevolutionStamp *trail = to->tiles->GetForWrite(M_WRAP(x + to->offset.lat), M_WRAP(y + to->offset.lon));
+              if (trail && *trail < stamp) {
+                *trail = stamp;
+              }
+            }
           }
         }
       }
     }
   }
-  flip = m_true_trails;
-  m_true_trails = m_copy_true_trails;
-  m_copy_true_trails = flip;
 }
 
 void TrailBuffer::UpdateTrailPosition() {
   GeoPosition radar;
-  GeoPositionPixels shift;
-  // When position changes the trail image is not moved, only the pointer to the center
-  // of the image (offset) is changed.
-  // So we move the image around within the m_trails.true_trails buffer (by moving the pointer).
-  // But when there is no room anymore (margin used) the whole trails image is shifted
-  // and the offset is reset
-  if (m_offset.lon >= MARGIN || m_offset.lon <= -MARGIN || m_offset.lat >= MARGIN || m_offset.lat <= -MARGIN) {
-    LOG_INFO(wxT("radar_pi: offset lat %d or lon too large %d"), m_offset.lat, m_offset.lon);
-    ClearTrails();
-    return;
-  }
 
-  // zooming of trails required? First check conditions
+  // Range change? The true trails move to another level, the relative trails are zoomed
   if (m_previous_pixels_per_meter == 0. || m_ri->m_pixels_per_meter == 0.) {
     ClearTrails();
     if (m_ri->m_pixels_per_meter == 0.) {
       return;
     }
     m_previous_pixels_per_meter = m_ri->m_pixels_per_meter;
+    SelectLevel();
   } else if (m_previous_pixels_per_meter != m_ri->m_pixels_per_meter && m_previous_pixels_per_meter != 0.) {
-    // zoom trails
     double zoom_factor = m_ri->m_pixels_per_meter / m_previous_pixels_per_meter;
 
     if (zoom_factor < 0.25 || zoom_factor > 4.00) {
-      ClearTrails();
-      return;
+      memset(m_relative_trails, 0, m_spokes * m_max_spoke_len * sizeof(TrailRevolutionStamp));
+    } else {
+      ZoomRelativeTrails(zoom_factor);
     }
     m_previous_pixels_per_meter = m_ri->m_pixels_per_meter;
-    // center the image before zooming
-    // otherwise the offset might get too large
-    ShiftImageLatToCenter();
-    ShiftImageLonToCenter();
-    ZoomTrails(zoom_factor);
+    int previous_level = m_shown_level;
+    SelectLevel();
+    if (m_shown_level != previous_level) {
+      ResampleLevel(previous_level, m_shown_level);
+    }
   }
 
   if (!m_ri->GetRadarPosition(&radar) || m_ri->m_pi->GetHeadingSource() == HEADING_NONE) {
@@ -264,157 +311,97 @@ void TrailBuffer::UpdateTrailPosition() {
   double dif_lon = radar.lon - m_pos.lon;  // moving east is positive
 
   m_pos = radar;
-  // get (floating point) shift of the ship in radar pixels
-  double fshift_lat = dif_lat * 60. * 1852. * m_ri->m_pixels_per_meter;
-  double fshift_lon = dif_lon * 60. * 1852. * m_ri->m_pixels_per_meter;
-  fshift_lon *= cos(deg2rad(radar.lat));  // at higher latitudes a degree of longitude is fewer meters
-  // Get the integer pixel shift, first add previous rounding error
-  shift.lat = (int)(fshift_lat + m_dif.lat);
-  shift.lon = (int)(fshift_lon + m_dif.lon);
-
-  // Check for changes in the direction of movement, part of the image buffer has to be erased
-
-  if (shift.lat > 0 && m_ri->m_dir_lat <= 0) {
-    // change of direction of movement, moving north now
-    // clear space in trailbuffer above image (this area might not be empty)
-    uint8_t *start_of_area_to_clear = m_true_trails + (m_trail_size - MARGIN + m_offset.lat) * m_trail_size;
-    int number_of_pixels_to_clear = (MARGIN - m_offset.lat) * m_trail_size;
-    memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    m_ri->m_dir_lat = 1;
-  }
-
-  if (shift.lat < 0 && m_ri->m_dir_lat >= 0) {
-    // change of direction of movement, moving south now
-    // clear space in true_trails below image
-    uint8_t *start_of_area_to_clear = m_true_trails;
-    int number_of_pixels_to_clear = (MARGIN + m_offset.lat) * m_trail_size;
-    memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    m_ri->m_dir_lat = -1;
-  }
-
-  if (shift.lon > 0 && m_ri->m_dir_lon <= 0) {
-    // change of direction of movement, moving east now
-    // clear space in true_trails to the right of image
-    int number_of_pixels_to_clear = MARGIN - m_offset.lon;
-    for (int i = 0; i < m_trail_size; i++) {
-      uint8_t *start_of_area_to_clear = m_true_trails + m_trail_size * i + m_trail_size - MARGIN + m_offset.lon;
-      memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    }
-    m_ri->m_dir_lon = 1;
-  }
+  // get the shift of the ship in meters
+  double meters_lat = dif_lat * 60. * 1852.;
+  double meters_lon = dif_lon * 60. * 1852. * cos(deg2rad(radar.lat));  // at higher latitudes a degree of longitude is fewer meters
 
-  if (shift.lon < 0 && m_ri->m_dir_lon >= 0) {
-    // change of direction of movement, moving west now
-    // clear space in true_trails outside image in that direction
-    int number_of_pixels_to_clear = MARGIN + m_offset.lon;
-    for (int i = 0; i < m_trail_size; i++) {
-      uint8_t *start_of_area_to_clear = m_true_trails + m_trail_size * i;
-      memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-    }
-    m_ri->m_dir_lon = -1;
+  for (int l = 0; l < TRAIL_LEVELS; l++) {
+    MoveLevel(&m_levels[l], meters_lat, meters_lon);
   }
+}
 
-  // save the rounding fraction and appy it next time
-  m_dif.lat = fshift_lat + m_dif.lat - (double)shift.lat;
-  m_dif.lon = fshift_lon + m_dif.lon - (double)shift.lon;
+void TrailBuffer::MoveLevel(TrailLevel *level, double meters_lat, double meters_lon) {
+  GeoPositionPixels shift;
 
-  if (shift.lat >= MARGIN || shift.lat <= -MARGIN || shift.lon >= MARGIN || shift.lon <= -MARGIN) {  // huge shift, reset trails
+  // get (floating point) shift of the ship in cells
+  double fshift_lat = meters_lat / level->meters_per_cell;
+  double fshift_lon = meters_lon / level->meters_per_cell;
+  // Get the integer cell shift, first add previous rounding error
+  shift.lat = (int)(fshift_lat + level->dif.lat);
+  shift.lon = (int)(fshift_lon + level->dif.lon);
 
-    LOG_INFO(wxT("radar_pi: %s Large movement trails reset, shift.lat= %f, shift.lon=%f"), m_ri->m_name.c_str(), shift.lat,
-             shift.lon);
-    ClearTrails();
+  // save the rounding fraction and appy it next time
+  level->dif.lat = fshift_lat + level->dif.lat - (double)shift.lat;
+  level->dif.lon = fshift_lon + level->dif.lon - (double)shift.lon;
+
+  if (shift.lat >= m_trail_size || shift.lat <= -m_trail_size || shift.lon >= m_trail_size ||
+      shift.lon <= -m_trail_size) {  // the whole level scrolled out of view, reset it
+    if (level == &m_levels[m_shown_level]) {
+      LOG_INFO(wxT("radar_pi: %s Large movement trails reset, shift.lat= %d, shift.lon=%d"), m_ri->m_name.c_str(), shift.lat,
+               shift.lon);
+    }
+    level->tiles->Clear();
+    level->offset.lat = 0;
+    level->offset.lon = 0;
     return;
   }
 
-  // offset lon too large: shift image
-  if (abs(m_offset.lon + shift.lon) >= MARGIN) {
-    ShiftImageLonToCenter();
+  // Move the origin of the level, and clear what scrolls into view on the side we move to
+  if (shift.lat != 0) {
+    level->offset.lat = (level->offset.lat + shift.lat + m_trail_size) % m_trail_size;
+    if (shift.lat > 0) {
+      ClearLevelRows(level, m_trail_size - shift.lat, shift.lat);  // moving north, clear the top rows
+    } else {
+      ClearLevelRows(level, 0, -shift.lat);  // moving south, clear the bottom rows
+    }
   }
-
-  // offset lat too large: shift image in lat direction
-  if (abs(m_offset.lat + shift.lat) >= MARGIN) {
-    ShiftImageLatToCenter();
+  if (shift.lon != 0) {
+    level->offset.lon = (level->offset.lon + shift.lon + m_trail_size) % m_trail_size;
+    if (shift.lon > 0) {
+      ClearLevelColumns(level, m_trail_size - shift.lon, shift.lon);  // moving east, clear the right columns
+    } else {
+      ClearLevelColumns(level, 0, -shift.lon);  // moving west, clear the left columns
+    }
   }
-  // apply the shifts to the offset
-  m_offset.lat += shift.lat;
-  m_offset.lon += shift.lon;
 }
 
-// shifts the true trails image in lat direction to center
-void TrailBuffer::ShiftImageLatToCenter() {
-  int image_size = m_trail_size * 2 * m_max_spoke_len;  // number of pixels to shift up / down
+// Clears count rows of a level starting at row first, relative to the ship
+void TrailBuffer::ClearLevelRows(TrailLevel *level, int first, int count) {
+  int start = M_WRAP(first + level->offset.lat);
+  int before_wrap = wxMin(count, m_trail_size - start);
 
-  if (m_offset.lat >= MARGIN || m_offset.lat <= -MARGIN) {  // abs not ok
-    LOG_INFO(wxT("radar_pi: offset lat too large %i"), m_offset.lat);
-    ClearTrails();
-    return;
-  }
-  // current starting location of shifted image
-  uint8_t *source_address = m_true_trails + (MARGIN + m_offset.lat) * m_trail_size;
-  // location where centered image should be
-  uint8_t *destination_address = m_true_trails + MARGIN * m_trail_size;
-  // size of image to be shifted, extended to the full width of trailbuffer
-  image_size = m_trail_size * 2 * m_max_spoke_len;
-  memmove(destination_address, source_address, image_size);
-  uint8_t *start_of_area_to_clear;
-  int number_of_pixels_to_clear = MARGIN * m_trail_size;
-  if (m_offset.lat > 0) {
-    // clear upper area of trailbuffer which is now outside the image
-    start_of_area_to_clear = m_true_trails + (m_trail_size - MARGIN) * m_trail_size;
-  } else {
-    // clear lower area of trailbuffer which is now outside the image
-    start_of_area_to_clear = m_true_trails;
+  level->tiles->ClearRows(start, before_wrap);
+  if (count > before_wrap) {
+    level->tiles->ClearRows(0, count - before_wrap);
   }
-  memset(start_of_area_to_clear, 0, number_of_pixels_to_clear);
-  m_offset.lat = 0;
 }
 
-// shifts the true trails image in lon direction to center
-void TrailBuffer::ShiftImageLonToCenter() {
-  if (m_offset.lon >= MARGIN || m_offset.lon <= -MARGIN) {  // abs no good
-    LOG_INFO(wxT("radar_pi: offset lon too large %i"), m_offset.lon);
-    ClearTrails();
-    return;
-  }
-  // number of pixels to shift right / left
-  int line_of_image_size = 2 * m_max_spoke_len;
-  // MARGIN is where the centered line should start
-  // shift per line, rigth / left
-  for (int i = 0; i < m_trail_size; i++) {
-    // current starting location of image
-    uint8_t *source_address = m_true_trails + i * m_trail_size + MARGIN + m_offset.lon;
-    // location where centered image should be
-    uint8_t *destination_address = m_true_trails + i * m_trail_size + MARGIN;
-    memmove(destination_address, source_address, line_of_image_size);
-
-    uint8_t *start_of_area_to_clear;
-    // offset > 0, we shifted to the left, so clear area to the right of image
-    if (m_offset.lon > 0) {
-      // start clear at end of the line minus current margin
-      start_of_area_to_clear = m_true_trails + i * m_trail_size + m_trail_size - MARGIN;
-    }
-    // offset <= 0, we shifted to the right, so clear area to the left of image
-    else {
-      // start clear at start of the line
-      start_of_area_to_clear = m_true_trails + i * m_trail_size;
-    }
-    memset(start_of_area_to_clear, 0, MARGIN);
+// Clears count columns of a level starting at column first, relative to the ship
+void TrailBuffer::ClearLevelColumns(TrailLevel *level, int first, int count) {
+  int start = M_WRAP(first + level->offset.lon);
+  int before_wrap = wxMin(count, m_trail_size - start);
+
+  level->tiles->ClearColumns(start, before_wrap);
+  if (count > before_wrap) {
+    level->tiles->ClearColumns(0, count - before_wrap);
   }
-  m_offset.lon = 0;
 }
 
 void TrailBuffer::ClearTrails() {
-  m_offset.lat = 0;
-  m_offset.lon = 0;
-  m_dif.lat = 0.;
-  m_dif.lon = 0.;
+  for (int l = 0; l < TRAIL_LEVELS; l++) {
+    m_levels[l].tiles->Clear();
+    m_levels[l].offset.lat = 0;
+    m_levels[l].offset.lon = 0;
+    m_levels[l].dif.lat = 0.;
+    m_levels[l].dif.lon = 0.;
+  }
   // prevent zooming of trails in next trail update
   m_previous_pixels_per_meter = m_ri->m_pixels_per_meter;
-  if (m_true_trails) {
-    memset(m_true_trails, 0, m_trail_size * m_trail_size);
+  if (m_previous_pixels_per_meter != 0.) {
+    SelectLevel();
   }
   if (m_relative_trails) {
-    memset(m_relative_trails, 0, m_spokes * m_max_spoke_len);
+    memset(m_relative_trails, 0, m_spokes * m_max_spoke_len * sizeof(TrailRevolutionStamp));
   }
   if (!m_ri->GetRadarPosition(&m_pos)) {
     m_pos.lat = 0.;
@@ -422,4 +409,88 @@ void TrailBuffer::ClearTrails() {
   }
 }
 
+// Takes the trails of the previous run from the snapshot. The relative trails are already
+// in place, as they live in the snapshot. Returns false when the true trails do not fit.
+bool TrailBuffer::RestoreSnapshot(RadarSnapshot *snapshot) {
+  SnapshotHeader *header = snapshot->GetHeader();
+  SnapshotTile *directory = snapshot->GetTileDirectory();
+
+  if (header->trail_size != (uint32_t)m_trail_size || header->tiles > SNAPSHOT_TILES || header->pixels_per_meter == 0.) {
+    return false;
+  }
+  for (int l = 0; l < TRAIL_LEVELS; l++) {
+    m_levels[l].tiles->Clear();
+    m_levels[l].offset.lat = header->level[l].offset_lat;
+    m_levels[l].offset.lon = header->level[l].offset_lon;
+    m_levels[l].dif.lat = header->level[l].dif_lat;
+    m_levels[l].dif.lon = header->level[l].dif_lon;
+  }
+  for (size_t n = 0; n < header->tiles; n++) {
+    SnapshotTile *entry = &directory[n];
+    if (entry->level >= TRAIL_LEVELS || entry->tile_x >= m_levels[0].tiles->GetGrid() ||
+        entry->tile_y >= m_levels[0].tiles->GetGrid()) {
+      continue;
+    }
+    TrailRevolutionStamp *tile =
+        m_levels[entry->level].tiles->GetForWrite(entry->tile_x << TRAIL_TILE_SHIFT, entry->tile_y << TRAIL_TILE_SHIFT);
+    if (tile) {
+      memcpy(tile, snapshot->GetTile(n), TRAIL_TILE_PIXELS * sizeof(TrailRevolutionStamp));
+    }
+  }
+  m_true_clock.Set((TrailRevolutionStamp)header->true_revolution);
+  m_relative_clock.Set((TrailRevolutionStamp)header->relative_revolution);
+  m_pos.lat = header->lat;
+  m_pos.lon = header->lon;
+  m_previous_pixels_per_meter = header->pixels_per_meter;
+  SelectLevel();
+  LOG_INFO(wxT("radar_pi: %s restored %u tiles of true trails"), m_ri->m_name.c_str(), header->tiles);
+  return true;
+}
+
+// Saves the state of the true trails into the snapshot. The snapshot holds at most SNAPSHOT_TILES
+// tiles, so the levels closest to the one that is shown go first.
+void TrailBuffer::SaveSnapshot(RadarSnapshot *snapshot) {
+  SnapshotHeader *header = snapshot->GetHeader();
+  SnapshotTile *directory = snapshot->GetTileDirectory();
+  size_t n = 0;
+
+  header->trail_size = m_trail_size;
+  header->trail_levels = TRAIL_LEVELS;
+  header->pixels_per_meter = m_previous_pixels_per_meter;
+  header->lat = m_pos.lat;
+  header->lon = m_pos.lon;
+  header->true_revolution = m_true_clock.Now();
+  header->relative_revolution = m_relative_clock.Now();
+  for (int l = 0; l < TRAIL_LEVELS; l++) {
+    header->level[l].offset_lat = m_levels[l].offset.lat;
+    header->level[l].offset_lon = m_levels[l].offset.lon;
+    header->level[l].dif_lat = m_levels[l].dif.lat;
+    header->level[l].dif_lon = m_levels[l].dif.lon;
+  }
+
+  for (int distance = 0; distance < TRAIL_LEVELS && n < SNAPSHOT_TILES; distance++) {
+    for (int side = -1; side <= 1 && n < SNAPSHOT_TILES; side += 2) {
+      int l = m_shown_level + side * distance;
+      if (l < 0 || l >= TRAIL_LEVELS || (distance == 0 && side > 0)) {
+        continue;
+      }
+      TrailTiles *tiles = m_levels[l].tiles;
+      for (int tx = 0; tx < tiles->GetGrid() && n < SNAPSHOT_TILES; tx++) {
+        for (int ty = 0; ty < tiles->GetGrid() && n < SNAPSHOT_TILES; ty++) {
+          TrailRevolutionStamp *tile = tiles->GetTile(tx, ty);
+          if (tile) {
+            directory[n].level = (uint16_t)l;
+            directory[n].tile_x = (uint16_t)tx;
+            directory[n].tile_y = (uint16_t)ty;
+            directory[n].unused = 0;
+            memcpy(snapshot->GetTile(n), tile, TRAIL_TILE_PIXELS * sizeof(TrailRevolutionStamp));
+            n++;
+          }
+        }
+      }
+    }
+  }
+  header->tiles = (uint32_t)n;
+}
+
 PLUGIN_END_NAMESPACE
@@ -33,12 +33,21 @@
 #define _TRAIL_BUFFER_H_
 
 #include "RadarInfo.h"
+#include "TrailTiles.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
-typedef uint8_t TrailRevolutionsAge;
+class RadarSnapshot;
 
-#define MARGIN (100)
+//
+// True trails are kept in a pyramid of levels that are fixed in meters per cell, independent of
+// the range of the radar. Every next level has cells twice as large. Echoes are only stamped into
+// the level that is shown. When a change of range shows another level, the trails of the previous
+// one are resampled into it, so they stay; a level that is shown again keeps its own finer detail.
+//
+#define TRAIL_LEVELS (15)
+#define TRAIL_LEVEL_0_METERS (1. / 64.)  // size of the cells in the finest level, the coarsest has 256 m
+#define TRAIL_STEP_SHIFT (16)            // fraction bits of the cells per spoke pixel in m_true_trails_step
 
 class TrailBuffer {
  public:
@@ -49,6 +58,7 @@ class TrailBuffer {
   void UpdateTrailPosition();
   void UpdateTrueTrails(SpokeBearing bearing, uint8_t *data, size_t len);
   void UpdateRelativeTrails(SpokeBearing angle, uint8_t *data, size_t len);
+  void SaveSnapshot(RadarSnapshot *snapshot);
 
   struct GeoPositionPixels {
     int lat;
@@ -56,13 +66,22 @@ class TrailBuffer {
   };
 
   GeoPosition m_pos;
-  GeoPosition m_dif;  // Fraction of a pixel expressed in lat/lon for True Motion Target Trails
-  GeoPositionPixels m_offset;
 
  private:
-  void ShiftImageLonToCenter();
-  void ShiftImageLatToCenter();
-  void ZoomTrails(float zoom_factor);
+  struct TrailLevel {
+    double meters_per_cell;
+    TrailTiles *tiles;         // m_trails_size * m_trails_size
+    GeoPosition dif;           // Fraction of a cell expressed in lat/lon for True Motion Target Trails
+    GeoPositionPixels offset;  // Origin of the level in its tiles, modulo m_trail_size
+  };
+
+  void SelectLevel();
+  void ResampleLevel(int from_level, int to_level);
+  void MoveLevel(TrailLevel *level, double meters_lat, double meters_lon);
+  void ClearLevelRows(TrailLevel *level, int first, int count);
+  void ClearLevelColumns(TrailLevel *level, int first, int count);
+  void ZoomRelativeTrails(float zoom_factor);
+  bool RestoreSnapshot(RadarSnapshot *snapshot);
 
   RadarInfo *m_ri;
   size_t m_spokes;
@@ -70,10 +89,17 @@ class TrailBuffer {
   int m_trail_size;
   double m_previous_pixels_per_meter;
 
-  TrailRevolutionsAge *m_true_trails;           // m_trails_size * m_trails_size
-  TrailRevolutionsAge *m_relative_trails;       // m_spokes * m_max_spoke_len
-  TrailRevolutionsAge *m_copy_true_trails;      // m_trails_size * m_trails_size
-  TrailRevolutionsAge *m_copy_relative_trails;  // m_spokes * m_max_spoke_len
+  TrailClock m_true_clock;
+  TrailClock m_relative_clock;
+
+  TrailTilePool m_tile_pool;
+  TrailLevel m_levels[TRAIL_LEVELS];
+  int m_shown_level;
+  GeoPositionPixels *m_true_trails_step;  // per bearing, cells of the shown level per spoke pixel, fixed point
+  int *m_true_trails_len;                 // per bearing, the part of the spoke that lies within the shown level
+  TrailRevolutionStamp *m_relative_trails;       // m_spokes * m_max_spoke_len, in the snapshot if there is one
+  bool m_relative_trails_mapped;
+  TrailRevolutionStamp *m_copy_relative_trails;  // m_spokes * m_max_spoke_len
 };
 
 PLUGIN_END_NAMESPACE
@@ -0,0 +1,168 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "TrailTiles.h"
+
+#include <string.h>
+
+PLUGIN_BEGIN_NAMESPACE
+
+TrailTilePool::TrailTilePool() {
+  m_free = 0;
+  m_blocks = 0;
+  m_block_count = 0;
+  m_block_space = 0;
+}
+
+TrailTilePool::~TrailTilePool() {
+  for (size_t i = 0; i < m_block_count; i++) {
+    free(m_blocks[i]);
+  }
+  free(m_blocks);
+}
+
+TrailRevolutionStamp *TrailTilePool::Get() {
+  if (!m_free) {
+    if (m_block_count == m_block_space) {
+      size_t space = m_block_space ? m_block_space * 2 : 16;
+      TrailRevolutionStamp **blocks = (TrailRevolutionStamp **)realloc(m_blocks, space * sizeof(TrailRevolutionStamp *));
+      if (!blocks) {
+        return 0;
+      }
+      m_blocks = blocks;
+      m_block_space = space;
+    }
+    TrailRevolutionStamp *block = (TrailRevolutionStamp *)malloc(TRAIL_TILES_PER_BLOCK * TRAIL_TILE_PIXELS * sizeof(TrailRevolutionStamp));
+    if (!block) {
+      return 0;
+    }
+    m_blocks[m_block_count++] = block;
+    for (size_t i = 0; i < TRAIL_TILES_PER_BLOCK; i++) {
+      AddFree(block + i * TRAIL_TILE_PIXELS);
+    }
+  }
+
+  TrailRevolutionStamp *tile = (TrailRevolutionStamp *)m_free;
+  m_free = m_free->next;
+  memset(tile, 0, TRAIL_TILE_PIXELS * sizeof(TrailRevolutionStamp));
+  return tile;
+}
+
+void TrailTilePool::Put(TrailRevolutionStamp *tile) { AddFree(tile); }
+
+void TrailTilePool::AddFree(TrailRevolutionStamp *tile) {
+  FreeTile *free_tile = (FreeTile *)tile;
+  free_tile->next = m_free;
+  m_free = free_tile;
+}
+
+TrailTiles::TrailTiles(TrailTilePool *pool, int size) {
+  m_pool = pool;
+  m_grid = (size + TRAIL_TILE_MASK) >> TRAIL_TILE_SHIFT;
+  m_tiles = (TrailRevolutionStamp **)calloc(m_grid * m_grid, sizeof(TrailRevolutionStamp *));
+}
+
+TrailTiles::~TrailTiles() {
+  if (m_tiles) {
+    Clear();
+    free(m_tiles);
+  }
+}
+
+void TrailTiles::Release(int tile_x, int tile_y) {
+  TrailRevolutionStamp **tile = &m_tiles[tile_x * m_grid + tile_y];
+  if (*tile) {
+    m_pool->Put(*tile);
+    *tile = 0;
+  }
+}
+
+void TrailTiles::ClearRows(int x, int count) {
+  for (int end = x + count; x < end;) {
+    int tile_x = x >> TRAIL_TILE_SHIFT;
+    int first = x & TRAIL_TILE_MASK;
+    int last = first + end - x < TRAIL_TILE_SIZE ? first + end - x : TRAIL_TILE_SIZE;
+
+    for (int tile_y = 0; tile_y < m_grid; tile_y++) {
+      TrailRevolutionStamp *tile = m_tiles[tile_x * m_grid + tile_y];
+      if (!tile) {
+        continue;
+      }
+      if (first == 0 && last == TRAIL_TILE_SIZE) {
+        Release(tile_x, tile_y);
+      } else {
+        memset(tile + first * TRAIL_TILE_SIZE, 0, (last - first) * TRAIL_TILE_SIZE * sizeof(TrailRevolutionStamp));
+      }
+    }
+    x += last - first;
+  }
+}
+
+void TrailTiles::ClearColumns(int y, int count) {
+  for (int end = y + count; y < end;) {
+    int tile_y = y >> TRAIL_TILE_SHIFT;
+    int first = y & TRAIL_TILE_MASK;
+    int last = first + end - y < TRAIL_TILE_SIZE ? first + end - y : TRAIL_TILE_SIZE;
+
+    for (int tile_x = 0; tile_x < m_grid; tile_x++) {
+      TrailRevolutionStamp *tile = m_tiles[tile_x * m_grid + tile_y];
+      if (!tile) {
+        continue;
+      }
+      if (first == 0 && last == TRAIL_TILE_SIZE) {
+        Release(tile_x, tile_y);
+      } else {
+        for (int row = 0; row < TRAIL_TILE_SIZE; row++) {
+          memset(tile + row * TRAIL_TILE_SIZE + first, 0, (last - first) * sizeof(TrailRevolutionStamp));
+        }
+      }
+    }
+    y += last - first;
+  }
+}
+
+void TrailTiles::Clear() {
+  for (int tile_x = 0; tile_x < m_grid; tile_x++) {
+    for (int tile_y = 0; tile_y < m_grid; tile_y++) {
+      Release(tile_x, tile_y);
+    }
+  }
+}
+
+void TrailTiles::Rebase(const TrailClock &clock) {
+  for (int i = 0; i < m_grid * m_grid; i++) {
+    if (m_tiles[i]) {
+      clock.Rebase(m_tiles[i], TRAIL_TILE_PIXELS);
+    }
+  }
+}
+
+PLUGIN_END_NAMESPACE
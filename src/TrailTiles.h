@@ -0,0 +1,125 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _TRAIL_TILES_H_
+#define _TRAIL_TILES_H_
+
+#include "TrailAge.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Sparse storage for the true trails image.
+//
+// The image is cut into square tiles of TRAIL_TILE_SIZE pixels. A tile is only
+// allocated when a target is written into it; a missing tile reads as all zero
+// stamps. Clearing and zooming the image only visit the tiles that exist, so both
+// memory and time scale with the area that actually holds trails. Most of the image
+// is empty water, and that costs nothing beyond one pointer per tile.
+//
+// Tiles come from a TrailTilePool, which allocates them in blocks and keeps the
+// released ones for reuse. Several TrailTiles can share one pool.
+//
+
+#define TRAIL_TILE_SHIFT (6)
+#define TRAIL_TILE_SIZE (1 << TRAIL_TILE_SHIFT)
+#define TRAIL_TILE_MASK (TRAIL_TILE_SIZE - 1)
+#define TRAIL_TILE_PIXELS (TRAIL_TILE_SIZE * TRAIL_TILE_SIZE)
+#define TRAIL_TILES_PER_BLOCK (16)
+
+class TrailTilePool {
+ public:
+  TrailTilePool();
+  ~TrailTilePool();
+
+  // Returns a tile with all stamps zero, or NULL when out of memory.
+  TrailRevolutionStamp *Get();
+  void Put(TrailRevolutionStamp *tile);
+
+ private:
+  void AddFree(TrailRevolutionStamp *tile);
+
+  struct FreeTile {
+    FreeTile *next;
+  };
+
+  FreeTile *m_free;
+  TrailRevolutionStamp **m_blocks;
+  size_t m_block_count;
+  size_t m_block_space;
+};
+
+class TrailTiles {
+ public:
+  TrailTiles(TrailTilePool *pool, int size);
+  ~TrailTiles();
+
+  // x and y are pixels in the image, 0 <= x, y < size.
+  TrailRevolutionStamp Get(int x, int y) {
+    TrailRevolutionStamp *tile = m_tiles[(x >> TRAIL_TILE_SHIFT) * m_grid + (y >> TRAIL_TILE_SHIFT)];
+    return tile ? tile[(x & TRAIL_TILE_MASK) * TRAIL_TILE_SIZE + (y & TRAIL_TILE_MASK)] : 0;
+  }
+
+  // Returns the stamp for writing, allocating its tile when needed. NULL when out of memory.
+  TrailRevolutionStamp *GetForWrite(int x, int y) {
+    TrailRevolutionStamp **tile = &m_tiles[(x >> TRAIL_TILE_SHIFT) * m_grid + (y >> TRAIL_TILE_SHIFT)];
+    if (!*tile) {
+      *tile = m_pool->Get();
+      if (!*tile) {
+        return 0;
+      }
+    }
+    return *tile + (x & TRAIL_TILE_MASK) * TRAIL_TILE_SIZE + (y & TRAIL_TILE_MASK);
+  }
+
+  // Clear count rows starting at row x, or count columns starting at column y.
+  // The range must not pass the end of the image.
+  void ClearRows(int x, int count);
+  void ClearColumns(int y, int count);
+  void Clear();
+
+  void Rebase(const TrailClock &clock);
+
+  bool IsAllocated() { return m_tiles != 0; }
+  int GetGrid() { return m_grid; }
+  TrailRevolutionStamp *GetTile(int tile_x, int tile_y) { return m_tiles[tile_x * m_grid + tile_y]; }
+
+ private:
+  void Release(int tile_x, int tile_y);
+
+  TrailTilePool *m_pool;
+  int m_grid;  // number of tiles in each direction
+  TrailRevolutionStamp **m_tiles;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _TRAIL_TILES_H_ */
@@ -0,0 +1,161 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Minimal stand-ins for the OpenCPN host functions and plugin base classes that the
+ * radar_pi code links against. radar_bench runs without OpenCPN, so none of these
+ * ever show anything; they only satisfy the linker and return neutral values.
+ */
+
+#include "radar_pi.h"
+
+//
+// Plugin base classes. In OpenCPN proper these live in the main executable.
+//
+
+opencpn_plugin::~opencpn_plugin() {}
+int opencpn_plugin::Init(void) { return 0; }
+bool opencpn_plugin::DeInit(void) { return true; }
+int opencpn_plugin::GetAPIVersionMajor() { return 1; }
+int opencpn_plugin::GetAPIVersionMinor() { return 16; }
+int opencpn_plugin::GetPlugInVersionMajor() { return 1; }
+int opencpn_plugin::GetPlugInVersionMinor() { return 0; }
+wxBitmap *opencpn_plugin::GetPlugInBitmap() { return 0; }
+wxString opencpn_plugin::GetCommonName() { return wxEmptyString; }
+wxString opencpn_plugin::GetShortDescription() { return wxEmptyString; }
+wxString opencpn_plugin::GetLongDescription() { return wxEmptyString; }
+void opencpn_plugin::SetDefaults(void) {}
+int opencpn_plugin::GetToolbarToolCount(void) { return 0; }
+int opencpn_plugin::GetToolboxPanelCount(void) { return 0; }
+void opencpn_plugin::SetupToolboxPanel(int page_sel, wxNotebook *pnotebook) {}
+void opencpn_plugin::OnCloseToolboxPanel(int page_sel, int ok_apply_cancel) {}
+void opencpn_plugin::ShowPreferencesDialog(wxWindow *parent) {}
+bool opencpn_plugin::RenderOverlay(wxMemoryDC *pmdc, PlugIn_ViewPort *vp) { return false; }
+void opencpn_plugin::SetCursorLatLon(double lat, double lon) {}
+void opencpn_plugin::SetCurrentViewPort(PlugIn_ViewPort &vp) {}
+void opencpn_plugin::SetPositionFix(PlugIn_Position_Fix &pfix) {}
+void opencpn_plugin::SetNMEASentence(wxString &sentence) {}
+void opencpn_plugin::SetAISSentence(wxString &sentence) {}
+void opencpn_plugin::ProcessParentResize(int x, int y) {}
+void opencpn_plugin::SetColorScheme(PI_ColorScheme cs) {}
+void opencpn_plugin::OnToolbarToolCallback(int id) {}
+void opencpn_plugin::OnContextMenuItemCallback(int id) {}
+void opencpn_plugin::UpdateAuiStatus(void) {}
+wxArrayString opencpn_plugin::GetDynamicChartClassNameArray(void) { return wxArrayString(); }
+
+opencpn_plugin_18::opencpn_plugin_18(void *pmgr) : opencpn_plugin(pmgr) {}
+opencpn_plugin_18::~opencpn_plugin_18() {}
+bool opencpn_plugin_18::RenderOverlay(wxDC &dc, PlugIn_ViewPort *vp) { return false; }
+bool opencpn_plugin_18::RenderGLOverlay(wxGLContext *pcontext, PlugIn_ViewPort *vp) { return false; }
+void opencpn_plugin_18::SetPluginMessage(wxString &message_id, wxString &message_body) {}
+void opencpn_plugin_18::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {}
+
+opencpn_plugin_19::opencpn_plugin_19(void *pmgr) : opencpn_plugin_18(pmgr) {}
+opencpn_plugin_19::~opencpn_plugin_19() {}
+void opencpn_plugin_19::OnSetupOptions(void) {}
+
+opencpn_plugin_110::opencpn_plugin_110(void *pmgr) : opencpn_plugin_19(pmgr) {}
+opencpn_plugin_110::~opencpn_plugin_110() {}
+void opencpn_plugin_110::LateInit(void) {}
+
+opencpn_plugin_111::opencpn_plugin_111(void *pmgr) : opencpn_plugin_110(pmgr) {}
+opencpn_plugin_111::~opencpn_plugin_111() {}
+
+opencpn_plugin_112::opencpn_plugin_112(void *pmgr) : opencpn_plugin_111(pmgr) {}
+opencpn_plugin_112::~opencpn_plugin_112() {}
+bool opencpn_plugin_112::MouseEventHook(wxMouseEvent &event) { return false; }
+void opencpn_plugin_112::SendVectorChartObjectInfo(wxString &chart, wxString &feature, wxString &objname, double lat, double lon,
+                                                   double scale, int nativescale) {}
+
+opencpn_plugin_113::opencpn_plugin_113(void *pmgr) : opencpn_plugin_112(pmgr) {}
+opencpn_plugin_113::~opencpn_plugin_113() {}
+bool opencpn_plugin_113::KeyboardEventHook(wxKeyEvent &event) { return false; }
+void opencpn_plugin_113::OnToolbarToolDownCallback(int id) {}
+void opencpn_plugin_113::OnToolbarToolUpCallback(int id) {}
+
+opencpn_plugin_114::opencpn_plugin_114(void *pmgr) : opencpn_plugin_113(pmgr) {}
+opencpn_plugin_114::~opencpn_plugin_114() {}
+
+opencpn_plugin_115::opencpn_plugin_115(void *pmgr) : opencpn_plugin_114(pmgr) {}
+opencpn_plugin_115::~opencpn_plugin_115() {}
+
+opencpn_plugin_116::opencpn_plugin_116(void *pmgr) : opencpn_plugin_115(pmgr) {}
+opencpn_plugin_116::~opencpn_plugin_116() {}
+bool opencpn_plugin_116::RenderGLOverlayMultiCanvas(wxGLContext *pcontext, PlugIn_ViewPort *vp, int canvasIndex) { return false; }
+bool opencpn_plugin_116::RenderOverlayMultiCanvas(wxDC &dc, PlugIn_ViewPort *vp, int canvasIndex) { return false; }
+void opencpn_plugin_116::PrepareContextMenu(int canvasIndex) {}
+
+//
+// Host API functions used by radar_pi.
+//
+
+extern "C" int InsertPlugInToolSVG(wxString label, wxString SVGfile, wxString SVGfileRollover, wxString SVGfileToggled,
+                                   wxItemKind kind, wxString shortHelp, wxString longHelp, wxObject *clientData, int position,
+                                   int tool_sel, opencpn_plugin *pplugin) {
+  return -1;
+}
+extern "C" void SetToolbarToolBitmapsSVG(int item, wxString SVGfile, wxString SVGfileRollover, wxString SVGfileToggled) {}
+extern "C" int AddCanvasContextMenuItem(wxMenuItem *pitem, opencpn_plugin *pplugin) {
+  delete pitem;
+  return -1;
+}
+extern "C" void RemoveCanvasContextMenuItem(int item) {}
+extern "C" void SetCanvasContextMenuItemViz(int item, bool viz) {}
+extern "C" void SetCanvasContextMenuItemGrey(int item, bool grey) {}
+extern "C" wxFileConfig *GetOCPNConfigObject(void) { return 0; }
+extern "C" void GetCanvasPixLL(PlugIn_ViewPort *vp, wxPoint *pp, double lat, double lon) {
+  pp->x = 0;
+  pp->y = 0;
+}
+extern "C" void GetCanvasLLPix(PlugIn_ViewPort *vp, wxPoint p, double *plat, double *plon) {
+  *plat = 0.;
+  *plon = 0.;
+}
+extern "C" wxWindow *GetOCPNCanvasWindow() { return 0; }
+extern "C" wxFont *OCPNGetFont(wxString TextElement, int default_size) { return wxNORMAL_FONT; }
+extern "C" wxString *GetpSharedDataLocation() {
+  static wxString location;
+  return &location;
+}
+extern "C" wxAuiManager *GetFrameAuiManager(void) { return 0; }
+extern "C" bool AddLocaleCatalog(wxString catalog) { return false; }
+extern "C" void PushNMEABuffer(wxString str) {}
+extern "C" void DimeWindow(wxWindow *) {}
+
+void PlugInPlaySound(wxString &sound_file) {}
+wxFont *GetOCPNScaledFont_PlugIn(wxString TextElement, int default_size) { return wxNORMAL_FONT; }
+wxFont GetOCPNGUIScaledFont_PlugIn(wxString item) { return *wxNORMAL_FONT; }
+wxColour GetFontColour_PlugIn(wxString TextElement) { return *wxBLACK; }
+void PlugInAISDrawGL(wxGLCanvas *glcanvas, const PlugIn_ViewPort &vp) {}
+bool PlugInSetFontColor(const wxString TextElement, const wxColour color) { return false; }
+int GetCanvasIndexUnderMouse() { return 0; }
+wxWindow *GetCanvasByIndex(int canvasIndex) { return 0; }
+int GetCanvasCount() { return 1; }
@@ -0,0 +1,331 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * radar_bench: push synthetic or recorded spokes through RadarInfo::ProcessRadarSpoke
+ * without OpenCPN or an OpenGL context, and report how many nanoseconds each stage of
+ * the receive path costs per spoke.
+ *
+ * Only built when CMake is run with -DRADAR_BENCHMARK=ON.
+ */
+
+#include "GuardZone.h"
+#include "RadarDrawVertex.h"
+#include "RadarFactory.h"
+#include "RadarInfo.h"
+#include "RadarReceive.h"
+#include "replay/PcapReader.h"
+
+#include <wx/cmdline.h>
+#include <wx/init.h>
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define BENCH_RANGE_METERS (3000)
+#define BENCH_TARGETS (16)
+#define BENCH_ROTATION_MILLIS (2500)
+
+static const char *stage_name[SPOKE_STAGES] = {"scan filter", "history", "guard zones", "true trails", "relative trails", "draw ingest"};
+
+/*
+ * Give the settings that the receive path reads the same values that LoadConfig
+ * uses as defaults. There is no config file behind GetOCPNConfigObject here.
+ */
+static void InitBenchSettings(radar_pi *pi, size_t radars) {
+  PersistentSettings &s = pi->m_settings;
+
+  s.radar_count = radars;
+  s.verbose = 0;
+  s.show = 1;
+  s.drawing_method = 0;  // Vertex; the shader needs a GL context to accept spokes
+  s.threshold_red = 200;
+  s.threshold_green = 100;
+  s.threshold_blue = MAX(50, BLOB_HISTORY_MAX + 1);
+  s.max_age = 6;
+  s.trails_on_overlay = false;
+  s.show_extreme_range = false;
+  s.adaptive_threshold = false;
+  s.scan_filter = 0;
+  s.guard_zone_debug_inc = 0;
+  s.overlay_transparency.Update(DEFAULT_OVERLAY_TRANSPARENCY);
+  s.strong_colour = wxColour(255, 0, 0);
+  s.intermediate_colour = wxColour(0, 255, 0);
+  s.weak_colour = wxColour(0, 0, 255);
+  s.arpa_colour = wxColour(255, 255, 255);
+  s.doppler_approaching_colour = wxColour(255, 255, 0);
+  s.doppler_receding_colour = wxColour(0, 255, 255);
+  s.trail_start_colour = wxColour(255, 255, 255);
+  s.trail_end_colour = wxColour(63, 63, 63);
+  s.replay_speed = 1.0;
+}
+
+static RadarInfo *MakeBenchRadar(radar_pi *pi, int r, RadarType type) {
+  RadarInfo *ri = new RadarInfo(pi, r);
+
+  pi->m_radar[r] = ri;
+  ri->m_radar_type = type;
+  ri->m_name = RadarTypeName[type];
+  ri->m_target_trails.Update(2, RCS_MANUAL);  // 60 seconds
+  ri->m_trails_motion.Update(TARGET_MOTION_TRUE, RCS_MANUAL);
+  ri->InitSpokeProcessing();
+
+  GuardZone *zone = ri->m_guard_zone[0];
+  zone->SetType(GZ_CIRCLE);
+  zone->SetInnerRange(BENCH_RANGE_METERS / 10);
+  zone->SetOuterRange(BENCH_RANGE_METERS / 2);
+  zone->SetAlarmOn(1);
+
+  ri->PrepareDraw(true);
+  ri->PrepareDraw(false);
+  return ri;
+}
+
+/*
+ * Deterministic radar picture: speckle clutter close in, a coast line from 70% of the
+ * spoke outwards and a number of small targets that drift a little every revolution.
+ */
+static void MakeSyntheticSpoke(uint8_t *data, size_t len, size_t spokes, SpokeBearing angle, int revolution, uint32_t *seed) {
+  size_t coast = len * 7 / 10 + (size_t)(len / 20 * (1. + sin(angle * 2 * PI / spokes * 3)));
+
+  for (size_t radius = 0; radius < len; radius++) {
+    *seed = *seed * 1664525 + 1013904223;
+    uint8_t noise = (uint8_t)(*seed >> 24);
+
+    if (radius >= coast) {
+      data[radius] = 200 + noise % 56;
+    } else if (radius < len / 8) {
+      data[radius] = noise > 192 ? noise : 0;
+    } else {
+      data[radius] = noise > 250 ? 110 : 0;
+    }
+  }
+
+  for (int t = 0; t < BENCH_TARGETS; t++) {
+    size_t target_angle = (t * spokes / BENCH_TARGETS + revolution * (t % 3)) % spokes;
+    size_t target_radius = len / 4 + t * len / (3 * BENCH_TARGETS) + revolution % (len / 16);
+
+    if ((size_t)abs((int)angle - (int)target_angle) <= 3) {
+      for (size_t radius = target_radius; radius < target_radius + 4 && radius < len; radius++) {
+        data[radius] = 255;
+      }
+    }
+  }
+}
+
+static void RunSynthetic(radar_pi *pi, RadarInfo **radar, size_t radars, int revolutions) {
+  uint8_t data[SPOKE_LEN_MAX];
+  uint32_t seed = 1;
+  GeoPosition boat;
+
+  boat.lat = 52.0;
+  boat.lon = 4.0;
+
+  for (int revolution = 0; revolution < revolutions; revolution++) {
+    boat.lat += 0.00002;  // About 8 knots northwards
+    for (size_t r = 0; r < radars; r++) {
+      radar[r]->SetRadarPosition(boat, 30.);
+    }
+
+    size_t spokes = radar[0]->m_spokes;
+    for (size_t a = 0; a < spokes; a++) {
+      wxLongLong now = wxGetUTCTimeMillis();
+      for (size_t r = 0; r < radars; r++) {
+        RadarInfo *ri = radar[r];
+        SpokeBearing angle = (SpokeBearing)(a * ri->m_spokes / spokes);
+        SpokeBearing bearing = (SpokeBearing)((angle + ri->m_spokes / 12) % ri->m_spokes);  // 30 degrees
+        size_t len = ri->m_spoke_len_max;
+
+        MakeSyntheticSpoke(data, len, ri->m_spokes, angle, revolution, &seed);
+        ri->ProcessRadarSpoke(angle, bearing, data, len, BENCH_RANGE_METERS, now);
+      }
+    }
+  }
+}
+
+/*
+ * Feed every datagram of the capture to the receive object of each radar, as fast as
+ * possible. Every radar sees the same data, so four radars cost four times the work.
+ */
+static bool RunReplay(radar_pi *pi, RadarInfo **radar, size_t radars, const wxString &filename, int passes) {
+  RadarReceive *receive[RADARS];
+
+  for (size_t r = 0; r < radars; r++) {
+    receive[r] = RadarFactory::MakeRadarReceive(radar[r]->m_radar_type, pi, radar[r]);
+    if (!receive[r]) {
+      wxLogError(wxT("radar_pi: cannot create receive object for %s"), radar[r]->m_name.c_str());
+      return false;
+    }
+  }
+
+  for (int pass = 0; pass < passes; pass++) {
+    PcapReader reader;
+    PcapDatagram datagram;
+
+    if (!reader.Open(filename)) {
+      return false;
+    }
+    while (reader.ReadDatagram(&datagram)) {
+      for (size_t r = 0; r < radars; r++) {
+        receive[r]->ProcessReplayPacket(datagram.src, datagram.dst, datagram.data, datagram.len);
+      }
+    }
+  }
+
+  for (size_t r = 0; r < radars; r++) {
+    receive[r]->Delete();  // Releases the thread created but never run
+    delete receive[r];
+  }
+  return true;
+}
+
+static void PrintTiming(const wxString &what, const spoke_timing &timing) {
+  uint64_t total = 0;
+
+  if (!timing.spokes) {
+    printf("%-12s no spokes processed\n", (const char *)what.mb_str());
+    return;
+  }
+  printf("%-12s %10llu spokes", (const char *)what.mb_str(), (unsigned long long)timing.spokes);
+  for (int s = 0; s < SPOKE_STAGES; s++) {
+    printf("  %s %6llu", stage_name[s], (unsigned long long)(timing.nanos[s] / timing.spokes));
+    total += timing.nanos[s];
+  }
+  printf("  total %6llu ns/spoke\n", (unsigned long long)(total / timing.spokes));
+}
+
+static int RadarBench(int argc, char **argv) {
+  static const wxCmdLineEntryDesc options[] = {
+      {wxCMD_LINE_SWITCH, "h", "help", "show this help", wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP},
+      {wxCMD_LINE_OPTION, "r", "radars", "number of radars (default 1)", wxCMD_LINE_VAL_NUMBER},
+      {wxCMD_LINE_OPTION, "t", "type", "radar type, for instance \"Navico Halo A\" (default)", wxCMD_LINE_VAL_STRING},
+      {wxCMD_LINE_OPTION, "n", "revolutions", "synthetic revolutions or capture passes (default 100)", wxCMD_LINE_VAL_NUMBER},
+      {wxCMD_LINE_SWITCH, "a", "adaptive", "use the adaptive threshold (clutter map)", wxCMD_LINE_VAL_NONE},
+      {wxCMD_LINE_OPTION, "f", "filter", "scan to scan filter, 0 = off (default), 1 = both, 2 = majority, 3 = average",
+       wxCMD_LINE_VAL_NUMBER},
+      {wxCMD_LINE_PARAM, 0, 0, "capture file (.pcap or .pcap.gz)", wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL},
+      {wxCMD_LINE_NONE}};
+
+  wxCmdLineParser parser(options, argc, argv);
+  if (parser.Parse() != 0) {
+    return 1;
+  }
+
+  long radars = 1;
+  long revolutions = 100;
+  long filter = 0;
+  wxString type_name = wxT("Navico Halo A");
+  wxString filename;
+  parser.Found(wxT("r"), &radars);
+  parser.Found(wxT("n"), &revolutions);
+  parser.Found(wxT("t"), &type_name);
+  parser.Found(wxT("f"), &filter);
+  if (parser.GetParamCount() > 0) {
+    filename = parser.GetParam(0);
+  }
+
+  if (radars < 1 || radars > RADARS) {
+    fprintf(stderr, "radar_bench: number of radars must be between 1 and %d\n", RADARS);
+    return 1;
+  }
+  int type;
+  for (type = 0; type < RT_MAX; type++) {
+    if (type_name.CmpNoCase(RadarTypeName[type]) == 0) {
+      break;
+    }
+  }
+  if (type == RT_MAX) {
+    fprintf(stderr, "radar_bench: unknown radar type '%s', choose one of:\n", (const char *)type_name.mb_str());
+    for (type = 0; type < RT_MAX; type++) {
+      fprintf(stderr, "  %s\n", (const char *)wxString(RadarTypeName[type]).mb_str());
+    }
+    return 1;
+  }
+
+  wxInitAllImageHandlers();
+  radar_pi *pi = new radar_pi(0);
+  RadarInfo *radar[RADARS];
+
+  InitBenchSettings(pi, radars);
+  pi->m_settings.adaptive_threshold = parser.Found(wxT("a"));
+  pi->m_settings.scan_filter = (int)filter;
+  pi->m_bpos_set = true;
+  pi->m_bpos_timestamp = time(0);
+  pi->SetRadarHeading(30., true);
+  for (int r = 0; r < radars; r++) {
+    radar[r] = MakeBenchRadar(pi, r, (RadarType)type);
+  }
+
+  wxLongLong start = wxGetUTCTimeMillis();
+  if (filename.IsEmpty()) {
+    RunSynthetic(pi, radar, radars, revolutions);
+  } else if (!RunReplay(pi, radar, radars, filename, revolutions)) {
+    return 1;
+  }
+  wxLongLong elapsed = wxGetUTCTimeMillis() - start;
+
+  spoke_timing all;
+  CLEAR_STRUCT(all);
+  for (int r = 0; r < radars; r++) {
+    PrintTiming(wxString::Format(wxT("radar %d"), r), radar[r]->m_spoke_timing);
+    for (int s = 0; s < SPOKE_STAGES; s++) {
+      all.nanos[s] += radar[r]->m_spoke_timing.nanos[s];
+    }
+    all.spokes += radar[r]->m_spoke_timing.spokes;
+  }
+  PrintTiming(wxT("all radars"), all);
+  for (int r = 0; r < radars; r++) {
+    RadarDrawVertex *vertex = dynamic_cast<RadarDrawVertex *>(radar[r]->m_draw_panel.draw);
+    if (vertex) {
+      printf("radar %d      vertex data %llu bytes/revolution\n", r, (unsigned long long)vertex->GetBytesPerRevolution());
+    }
+  }
+  printf("%s, %ld radar(s), %llu ms wall clock\n", (const char *)type_name.mb_str(), radars,
+         (unsigned long long)elapsed.GetValue());
+
+  for (int r = 0; r < radars; r++) {
+    pi->m_radar[r] = 0;
+    delete radar[r];
+  }
+  delete pi;
+  return 0;
+}
+
+PLUGIN_END_NAMESPACE
+
+int main(int argc, char **argv) {
+  wxInitializer initializer(argc, argv);
+
+  if (!initializer.IsOk()) {
+    fprintf(stderr, "radar_bench: failed to initialize wxWidgets\n");
+    return 1;
+  }
+  return PLUGIN_NAMESPACE::RadarBench(argc, argv);
+}
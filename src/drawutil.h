@@ -46,24 +46,17 @@ typedef struct {
   float y;
 } Point;
 
-typedef struct {
-  int16_t x;
-  int16_t y;
-} PointInt;
-
 // Allocated arrays are not two dimensional, so we make
 // up a macro that makes it look that way. Note the 'stride'
 // which is the length of the 2nd dimension, not the 1st.
 #define M_XY_STRIDE m_spoke_len
 #define M_XY(x, y) m_xy[x * M_XY_STRIDE + y]
-#define M_XYI(x, y) m_xyi[x * M_XY_STRIDE + y]
 
 class PolarToCartesianLookup {
  private:
   size_t m_spokes;
   size_t m_spoke_len;
   Point *m_xy;
-  PointInt *m_xyi;
 
  public:
   PolarToCartesianLookup(size_t spokes, size_t spoke_len) {
@@ -71,9 +64,8 @@ class PolarToCartesianLookup {
     m_spoke_len = spoke_len + 1;
 
     m_xy = (Point *)malloc(sizeof(Point) * m_spokes * m_spoke_len);
-    m_xyi = (PointInt *)malloc(sizeof(PointInt) * m_spokes * m_spoke_len);
 
-    if (!m_xy || !m_xyi) {
+    if (!m_xy) {
       wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
       wxAbort();
     }
@@ -86,20 +78,14 @@ class PolarToCartesianLookup {
         float y = (float)radius * sine;
         M_XY(arc, radius).x = x;
         M_XY(arc, radius).y = y;
-        M_XYI(arc, radius).x = (int16_t)x;
-        M_XYI(arc, radius).y = (int16_t)y;
       }
     }
   }
 
-  ~PolarToCartesianLookup() {
-    free(m_xy);
-    free(m_xyi);
-  }
+  ~PolarToCartesianLookup() { free(m_xy); }
 
   // We trust that the optimizer will inline this
   Point GetPoint(size_t angle, size_t radius) { return M_XY((angle + m_spokes) % m_spokes, radius); }
-  PointInt GetPointInt(size_t angle, size_t radius) { return M_XYI((angle + m_spokes) % m_spokes, radius); };
 };
 
 extern void DrawRoundRect(float x, float y, float width, float height, float radius = 0.0);
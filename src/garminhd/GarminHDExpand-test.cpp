@@ -0,0 +1,150 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Checks that GarminHDExpandLine produces exactly the same bytes as the original
+ * bit by bit loop in GarminHDReceive::ProcessFrame, and times both.
+ *
+ * There is no Garmin HD capture in example/, so the data is every byte value,
+ * pseudo random data and a synthetic spoke with sparse echoes.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string.h>
+
+#include "GarminHDExpand.h"
+
+using namespace std;
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define PACKED_LEN (252)  // Longest sub-spoke, see GARMIN_HD_MAX_SPOKE_LEN
+#define TEST_LEN (PACKED_LEN + 40)
+#define BENCH_SPOKES (720 * 200)
+
+// The loop as it was in GarminHDReceive::ProcessFrame
+static void ExpandLineBitwise(const uint8_t *s, size_t packed_len, uint8_t *p) {
+  for (size_t i = 0; i < packed_len; i++, s++) {
+    *p++ = (*s & 0x01) > 0 ? 255 : 0;
+    *p++ = (*s & 0x02) > 0 ? 255 : 0;
+    *p++ = (*s & 0x04) > 0 ? 255 : 0;
+    *p++ = (*s & 0x08) > 0 ? 255 : 0;
+    *p++ = (*s & 0x10) > 0 ? 255 : 0;
+    *p++ = (*s & 0x20) > 0 ? 255 : 0;
+    *p++ = (*s & 0x40) > 0 ? 255 : 0;
+    *p++ = (*s & 0x80) > 0 ? 255 : 0;
+  }
+}
+
+typedef void (*ExpandFunction)(const uint8_t *packed, size_t packed_len, uint8_t *out);
+
+static int Compare(const char *name, ExpandFunction expand) {
+  uint8_t packed[TEST_LEN + 1];
+  uint8_t expected[8 * TEST_LEN + 64];
+  uint8_t actual[8 * TEST_LEN + 64];
+  uint32_t seed = 4711;
+  int ret = 0;
+
+  for (int pass = 0; pass < 2; pass++) {
+    // Pass 0: every byte value, pass 1: pseudo random data
+    for (size_t i = 0; i < sizeof(packed); i++) {
+      seed = seed * 1664525 + 1013904223;
+      packed[i] = pass == 0 ? (uint8_t)i : (uint8_t)(seed >> 24);
+    }
+    for (size_t len = 0; len <= TEST_LEN; len++) {
+      for (size_t offset = 0; offset < 2; offset++) {
+        memset(expected, 0xaa, sizeof(expected));
+        memset(actual, 0xaa, sizeof(actual));
+        ExpandLineBitwise(packed + offset, len, expected + offset);
+        expand(packed + offset, len, actual + offset);
+        if (memcmp(expected, actual, sizeof(expected)) != 0) {
+          cout << "ERROR: " << name << " differs from the bitwise loop for len=" << len << " offset=" << offset << "\n";
+          ret = 1;
+        }
+      }
+    }
+  }
+  if (ret == 0) {
+    cout << "INFO: " << name << " matches the bitwise loop\n";
+  }
+  return ret;
+}
+
+static double Bench(ExpandFunction expand, const uint8_t *packed, uint8_t *out) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  unsigned sum = 0;
+
+  for (int n = 0; n < BENCH_SPOKES; n++) {
+    expand(packed + (n & 7), PACKED_LEN, out);
+    sum += out[n % (8 * PACKED_LEN)];  // so that the compiler can not skip the work
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  if (sum == 1) {
+    cout << "";
+  }
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / BENCH_SPOKES;
+}
+
+int main() {
+  int ret = 0;
+  uint8_t packed[PACKED_LEN + 8];
+  uint8_t out[8 * PACKED_LEN];
+
+  GarminHDExpandInit();
+
+  ret |= Compare("GarminHDExpandLineTable", GarminHDExpandLineTable);
+  ret |= Compare("GarminHDExpandLine", GarminHDExpandLine);
+
+  // Synthetic spoke: clutter near the center, a few targets further out
+  memset(packed, 0, sizeof(packed));
+  for (size_t i = 0; i < sizeof(packed); i++) {
+    if (i < 20 || i % 37 == 0 || (i > 180 && i < 190)) {
+      packed[i] = (uint8_t)(i * 73 + 5);
+    }
+  }
+  double bitwise = Bench(ExpandLineBitwise, packed, out);
+  double table = Bench(GarminHDExpandLineTable, packed, out);
+  double simd = Bench(GarminHDExpandLine, packed, out);
+  cout << "INFO: ns per " << PACKED_LEN << " byte sub-spoke: bitwise " << bitwise << ", table " << table << ", GarminHDExpandLine "
+       << simd << "\n";
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { RadarPlugin::main(); }
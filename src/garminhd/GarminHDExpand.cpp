@@ -0,0 +1,116 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "GarminHDExpand.h"
+
+#include <string.h>
+
+// SSE2 is part of every x86-64 CPU, and NEON of every aarch64 CPU, so no
+// runtime detection is needed here.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GARMIN_HD_EXPAND_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GARMIN_HD_EXPAND_NEON
+#include <arm_neon.h>
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+static uint8_t lookupBits[256][8];
+
+void GarminHDExpandInit() {
+  if (lookupBits[255][7] == 0) {
+    for (int j = 0; j <= UINT8_MAX; j++) {
+      for (int bit = 0; bit < 8; bit++) {
+        lookupBits[j][bit] = (j & (1 << bit)) ? 255 : 0;
+      }
+    }
+  }
+}
+
+void GarminHDExpandLineTable(const uint8_t *packed, size_t packed_len, uint8_t *out) {
+  for (size_t i = 0; i < packed_len; i++) {
+    memcpy(out + 8 * i, lookupBits[packed[i]], 8);  // a single 64 bit store
+  }
+}
+
+#ifdef GARMIN_HD_EXPAND_SSE2
+
+// Spread two input bytes over the two halves of a register, then test bit n of
+// the byte in lane n (mod 8).
+void GarminHDExpandLine(const uint8_t *packed, size_t packed_len, uint8_t *out) {
+  const __m128i bits = _mm_set_epi8((char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1, (char)0x80, 0x40, 0x20, 0x10, 8, 4, 2, 1);
+  size_t i = 0;
+
+  for (; i + 16 <= packed_len; i += 16) {
+    __m128i in = _mm_loadu_si128((const __m128i *)(packed + i));
+    __m128i b2[2], b4[4];
+
+    b2[0] = _mm_unpacklo_epi8(in, in);  // each byte twice
+    b2[1] = _mm_unpackhi_epi8(in, in);
+    for (int k = 0; k < 2; k++) {
+      b4[2 * k] = _mm_unpacklo_epi16(b2[k], b2[k]);  // each byte four times
+      b4[2 * k + 1] = _mm_unpackhi_epi16(b2[k], b2[k]);
+    }
+    for (int k = 0; k < 4; k++) {
+      __m128i lo = _mm_unpacklo_epi32(b4[k], b4[k]);  // two bytes, eight times each
+      __m128i hi = _mm_unpackhi_epi32(b4[k], b4[k]);
+      _mm_storeu_si128((__m128i *)(out + 8 * i + 32 * k), _mm_cmpeq_epi8(_mm_and_si128(lo, bits), bits));
+      _mm_storeu_si128((__m128i *)(out + 8 * i + 32 * k + 16), _mm_cmpeq_epi8(_mm_and_si128(hi, bits), bits));
+    }
+  }
+  GarminHDExpandLineTable(packed + i, packed_len - i, out + 8 * i);
+}
+
+#elif defined(GARMIN_HD_EXPAND_NEON)
+
+void GarminHDExpandLine(const uint8_t *packed, size_t packed_len, uint8_t *out) {
+  static const uint8_t bit_values[16] = {1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80, 1, 2, 4, 8, 0x10, 0x20, 0x40, 0x80};
+  const uint8x16_t bits = vld1q_u8(bit_values);
+  size_t i = 0;
+
+  for (; i + 2 <= packed_len; i += 2) {
+    uint8x16_t in = vcombine_u8(vdup_n_u8(packed[i]), vdup_n_u8(packed[i + 1]));
+    vst1q_u8(out + 8 * i, vtstq_u8(in, bits));  // 0xff where the bit is set
+  }
+  GarminHDExpandLineTable(packed + i, packed_len - i, out + 8 * i);
+}
+
+#else
+
+void GarminHDExpandLine(const uint8_t *packed, size_t packed_len, uint8_t *out) {
+  GarminHDExpandLineTable(packed, packed_len, out);
+}
+
+#endif
+
+PLUGIN_END_NAMESPACE
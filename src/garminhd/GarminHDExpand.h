@@ -0,0 +1,61 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _GARMINHDEXPAND_H_
+#define _GARMINHDEXPAND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Expansion of a Garmin HD spoke from 1 bit per pixel to 8 bits per pixel.
+//
+// Each input byte holds eight pixels, the least significant bit first. A set bit becomes
+// 255, a clear bit 0. GarminHDExpandLine writes 16 output bytes per store where SSE2 or
+// NEON is available, and 8 bytes per store from a lookup table otherwise.
+//
+
+// Builds the lookup table. Call once before GarminHDExpandLine.
+extern void GarminHDExpandInit();
+
+// Expand packed_len bytes into 8 * packed_len bytes.
+extern void GarminHDExpandLine(const uint8_t *packed, size_t packed_len, uint8_t *out);
+
+// The table driven version, also used for the tail that the SIMD loop leaves over.
+extern void GarminHDExpandLineTable(const uint8_t *packed, size_t packed_len, uint8_t *out);
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _GARMINHDEXPAND_H_ */
@@ -85,8 +85,8 @@ void GarminHDReceive::ProcessFrame(radar_line *packet) {
   wxLongLong time_rec = wxGetUTCTimeMillis();
   time_t now = (time_t)(time_rec.GetValue() / MILLISECONDS_PER_SECOND);
   uint8_t line[GARMIN_HD_MAX_SPOKE_LEN];
-  int i;
-  uint8_t *p, *s;
+  size_t len;
+  uint8_t *s;
 
   if (packet->scan_length * 2 > GARMIN_HD_MAX_SPOKE_LEN) {
     LOG_INFO(wxT("radar_pi: %s truncating data, %d longer than expected max length %d"), packet->scan_length * 8,
@@ -123,20 +123,10 @@ void GarminHDReceive::ProcessFrame(radar_line *packet) {
     wxLongLong startup_elapsed = wxGetUTCTimeMillis() - m_pi->GetBootMillis();
     LOG_INFO(wxT("radar_pi: %s first radar spoke received after %llu ms\n"), m_ri->m_name.c_str(), startup_elapsed);
   }
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
-
   for (int j = 0; j < 4; j++) {
     s = &packet->line_data[packet->scan_length / 4 * j];
-    for (p = line, i = 0; i < packet->scan_length / 4; i++, s++) {
-      *p++ = (*s & 0x01) > 0 ? 255 : 0;
-      *p++ = (*s & 0x02) > 0 ? 255 : 0;
-      *p++ = (*s & 0x04) > 0 ? 255 : 0;
-      *p++ = (*s & 0x08) > 0 ? 255 : 0;
-      *p++ = (*s & 0x10) > 0 ? 255 : 0;
-      *p++ = (*s & 0x20) > 0 ? 255 : 0;
-      *p++ = (*s & 0x40) > 0 ? 255 : 0;
-      *p++ = (*s & 0x80) > 0 ? 255 : 0;
-    }
+    len = packet->scan_length / 4 * 8;
+    GarminHDExpandLine(s, packet->scan_length / 4, line);
 
     m_next_spoke = (spoke + 1) % GARMIN_HD_SPOKES;
 
@@ -149,7 +139,7 @@ void GarminHDReceive::ProcessFrame(radar_line *packet) {
     SpokeBearing a = MOD_SPOKES(angle_raw);
     SpokeBearing b = MOD_SPOKES(bearing_raw);
 
-    m_ri->ProcessRadarSpoke(a, b, line, p - line, packet->display_meters, time_rec);
+    m_ri->QueueRadarSpoke(a, b, line, len, packet->display_meters, time_rec);
 
     angle_raw++;
     spoke++;
@@ -32,6 +32,7 @@
 #ifndef _GARMIN_HD_RECEIVE_H_
 #define _GARMIN_HD_RECEIVE_H_
 
+#include "GarminHDExpand.h"
 #include "RadarReceive.h"
 #include "socketutil.h"
 
@@ -57,6 +58,7 @@ class GarminHDReceive : public RadarReceive {
     m_send_socket = GetLocalhostSendTCPSocket(m_receive_socket);
     SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Initializing")));
     m_ri->m_showManualValueInAuto = true;
+    GarminHDExpandInit();
 
     LOG_RECEIVE(wxT("radar_pi: %s receive thread created"), m_ri->m_name.c_str());
   };
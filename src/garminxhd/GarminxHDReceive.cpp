@@ -81,8 +81,6 @@ void GarminxHDReceive::ProcessFrame(const uint8_t *data, size_t len) {
 
   radar_line *packet = (radar_line *)data;
 
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
-
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
   m_ri->m_data_timeout = now + DATA_TIMEOUT;
   m_ri->m_state.Update(RADAR_TRANSMIT);
@@ -125,7 +123,25 @@ void GarminxHDReceive::ProcessFrame(const uint8_t *data, size_t len) {
   SpokeBearing b = MOD_SPOKES(bearing_raw);
 
   m_ri->m_range.Update(packet->range_meters);
-  m_ri->ProcessRadarSpoke(a, b, packet->line_data, len, packet->display_meters, time_rec);
+  m_ri->QueueRadarSpoke(a, b, packet->line_data, len, packet->display_meters, time_rec);
+}
+
+/*
+ * ProcessReplayPacket
+ *
+ * Called by ReplayReceive for every datagram in a capture file.
+ * Garmin xHD uses fixed ports, so the destination port tells us what the datagram contains.
+ */
+bool GarminxHDReceive::ProcessReplayPacket(const NetworkAddress &src, const NetworkAddress &dst, const uint8_t *data,
+                                           size_t len) {
+  if (dst.port == m_data_addr.port) {
+    ProcessFrame(data, len);
+  } else if (dst.port == m_report_addr.port) {
+    ProcessReport(data, len);
+  } else {
+    return false;
+  }
+  return true;
 }
 
 // Check that this interface is valid for
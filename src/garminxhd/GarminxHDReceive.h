@@ -66,6 +66,7 @@ class GarminxHDReceive : public RadarReceive {
   void *Entry(void);
   void Shutdown(void);
   wxString GetInfoStatus();
+  bool ProcessReplayPacket(const NetworkAddress &src, const NetworkAddress &dst, const uint8_t *data, size_t len);
 
   NetworkAddress m_interface_addr;
   NetworkAddress m_data_addr;
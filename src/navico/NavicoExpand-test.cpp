@@ -0,0 +1,131 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+/*
+ * Checks that every SIMD kernel for the Navico 4 to 8 bit expansion that this CPU
+ * supports produces exactly the same bytes as the scalar reference, for all Doppler
+ * modes, all input byte values, odd lengths and unaligned buffers.
+ */
+
+#include <iostream>
+#include <string.h>
+
+#include "NavicoExpand.h"
+
+using namespace std;
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define TEST_LEN (NAVICO_SPOKE_LEN / 2 + 64)
+
+static int CompareKernel(const char *name, NavicoExpandFunction kernel) {
+  uint8_t packed[TEST_LEN + 1];
+  uint8_t expected[2 * TEST_LEN + 64];
+  uint8_t actual[2 * TEST_LEN + 64];
+  uint32_t seed = 12345;
+  int ret = 0;
+
+  if (!kernel) {
+    cout << "INFO: " << name << " kernel not available on this CPU\n";
+    return 0;
+  }
+
+  for (int doppler = 0; doppler < NAVICO_DOPPLER_MODES; doppler++) {
+    for (int pass = 0; pass < 2; pass++) {
+      // Pass 0: every byte value, pass 1: pseudo random data
+      for (size_t i = 0; i < sizeof(packed); i++) {
+        seed = seed * 1664525 + 1013904223;
+        packed[i] = pass == 0 ? (uint8_t)i : (uint8_t)(seed >> 24);
+      }
+
+      for (size_t len = 0; len <= TEST_LEN; len += (len < 80) ? 1 : 61) {
+        for (size_t offset = 0; offset < 2; offset++) {
+          memset(expected, 0xaa, sizeof(expected));
+          memset(actual, 0xaa, sizeof(actual));
+          NavicoExpandLineScalar(packed + offset, len, expected + offset, doppler);
+          kernel(packed + offset, len, actual + offset, doppler);
+
+          if (memcmp(expected, actual, sizeof(expected)) != 0) {
+            for (size_t i = 0; i < sizeof(expected); i++) {
+              if (expected[i] != actual[i]) {
+                cout << "ERROR: " << name << " doppler=" << doppler << " len=" << len << " offset=" << offset
+                     << " differs at byte " << i << ": expected " << (int)expected[i] << " got " << (int)actual[i] << "\n";
+                break;
+              }
+            }
+            ret = 1;
+          }
+        }
+      }
+    }
+  }
+  if (ret == 0) {
+    cout << "INFO: " << name << " kernel matches the scalar version\n";
+  }
+  return ret;
+}
+
+int main() {
+  int ret = 0;
+  uint8_t packed[2] = {0xfe, 0x5f};
+  uint8_t out[4];
+
+  NavicoExpandInit();
+  cout << "INFO: NavicoExpandLine uses the " << NavicoExpandKernelName() << " kernel\n";
+
+  // Spot check the reference itself
+  NavicoExpandLineScalar(packed, sizeof(packed), out, NAVICO_DOPPLER_BOTH);
+  if (out[0] != 0xfe || out[1] != 0xff || out[2] != 0xff || out[3] != 0x50) {
+    cout << "ERROR: scalar Doppler expansion is wrong\n";
+    ret = 1;
+  }
+  NavicoExpandLineScalar(packed, sizeof(packed), out, NAVICO_DOPPLER_APPROACHING);
+  if (out[0] != 0xe0 || out[1] != 0xff || out[2] != 0xff || out[3] != 0x50) {
+    cout << "ERROR: scalar approaching expansion is wrong\n";
+    ret = 1;
+  }
+
+  ret |= CompareKernel("SSE2", NavicoExpandSSE2());
+  ret |= CompareKernel("AVX2", NavicoExpandAVX2());
+  ret |= CompareKernel("NEON", NavicoExpandNEON());
+  ret |= CompareKernel("dispatched", NavicoExpandLine);
+
+  if (ret == 0) {
+    cout << "INFO: TEST PASSED\n";
+  } else {
+    cout << "ERROR: TEST FAILED\n";
+  }
+  exit(ret);
+}
+
+PLUGIN_END_NAMESPACE
+
+int main() { RadarPlugin::main(); }
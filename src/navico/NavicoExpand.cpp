@@ -0,0 +1,296 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "NavicoExpand.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NAVICO_EXPAND_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define NAVICO_EXPAND_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and clang only allow SSE2/AVX2 intrinsics in functions that are compiled for
+// that instruction set, whatever the -m flags of the file are. MSVC allows them anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+#define NAVICO_TARGET(isa) __attribute__((target(isa)))
+#else
+#define NAVICO_TARGET(isa)
+#endif
+
+PLUGIN_BEGIN_NAMESPACE
+
+enum LookupSpokeEnum {
+  LOOKUP_SPOKE_LOW_NORMAL,
+  LOOKUP_SPOKE_LOW_BOTH,
+  LOOKUP_SPOKE_LOW_APPROACHING,
+  LOOKUP_SPOKE_HIGH_NORMAL,
+  LOOKUP_SPOKE_HIGH_BOTH,
+  LOOKUP_SPOKE_HIGH_APPROACHING
+};
+
+static uint8_t lookupData[6][256];
+
+// What the SIMD kernels OR into a pixel that is 0xf0 (approaching) or 0xe0 (receding)
+// after the shift, per NavicoDopplerMode. 0xf0 | 0x0f = 0xff, 0xe0 | 0x1e = 0xfe.
+static const uint8_t fill_approaching[NAVICO_DOPPLER_MODES] = {0x00, 0x0f, 0x0f};
+static const uint8_t fill_receding[NAVICO_DOPPLER_MODES] = {0x00, 0x1e, 0x00};
+
+static NavicoExpandFunction expand_kernel = NavicoExpandLineScalar;
+static const char *expand_kernel_name = "scalar";
+
+static void InitializeLookupData() {
+  if (lookupData[5][255] == 0) {
+    for (int j = 0; j <= UINT8_MAX; j++) {
+      uint8_t low = (j & 0x0f) << 4;
+      uint8_t high = (j & 0xf0);
+
+      lookupData[LOOKUP_SPOKE_LOW_NORMAL][j] = low;
+      lookupData[LOOKUP_SPOKE_HIGH_NORMAL][j] = high;
+
+      switch (low) {
+        case 0xf0:
+          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xff;
+          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = 0xff;
+          break;
+
+        case 0xe0:
+          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xfe;
+          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
+          break;
+
+        default:
+          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = low;
+          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
+      }
+
+      switch (high) {
+        case 0xf0:
+          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xff;
+          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = 0xff;
+          break;
+
+        case 0xe0:
+          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xfe;
+          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
+          break;
+
+        default:
+          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = high;
+          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
+      }
+    }
+  }
+}
+
+static int ValidDoppler(int doppler) {
+  if (doppler < 0 || doppler >= NAVICO_DOPPLER_MODES) {
+    return NAVICO_DOPPLER_NONE;
+  }
+  return doppler;
+}
+
+void NavicoExpandLineScalar(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler) {
+  doppler = ValidDoppler(doppler);
+  const uint8_t *lookup_low = lookupData[LOOKUP_SPOKE_LOW_NORMAL + doppler];
+  const uint8_t *lookup_high = lookupData[LOOKUP_SPOKE_HIGH_NORMAL + doppler];
+
+  for (size_t i = 0; i < packed_len; i++) {
+    out[2 * i] = lookup_low[packed[i]];
+    out[2 * i + 1] = lookup_high[packed[i]];
+  }
+}
+
+#ifdef NAVICO_EXPAND_X86
+
+NAVICO_TARGET("sse2")
+static inline __m128i DopplerSSE2(__m128i pixels, __m128i approaching, __m128i receding) {
+  __m128i a = _mm_and_si128(_mm_cmpeq_epi8(pixels, _mm_set1_epi8((char)0xf0)), approaching);
+  __m128i r = _mm_and_si128(_mm_cmpeq_epi8(pixels, _mm_set1_epi8((char)0xe0)), receding);
+  return _mm_or_si128(pixels, _mm_or_si128(a, r));
+}
+
+NAVICO_TARGET("sse2")
+static void ExpandLineSSE2(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler) {
+  doppler = ValidDoppler(doppler);
+  const __m128i nibble = _mm_set1_epi8((char)0xf0);
+  const __m128i approaching = _mm_set1_epi8((char)fill_approaching[doppler]);
+  const __m128i receding = _mm_set1_epi8((char)fill_receding[doppler]);
+  size_t i;
+
+  for (i = 0; i + 16 <= packed_len; i += 16) {
+    __m128i in = _mm_loadu_si128((const __m128i *)(packed + i));
+    __m128i low = _mm_and_si128(_mm_slli_epi16(in, 4), nibble);
+    __m128i high = _mm_and_si128(in, nibble);
+
+    low = DopplerSSE2(low, approaching, receding);
+    high = DopplerSSE2(high, approaching, receding);
+    _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi8(low, high));
+    _mm_storeu_si128((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(low, high));
+  }
+  NavicoExpandLineScalar(packed + i, packed_len - i, out + 2 * i, doppler);
+}
+
+NAVICO_TARGET("avx2")
+static inline __m256i DopplerAVX2(__m256i pixels, __m256i approaching, __m256i receding) {
+  __m256i a = _mm256_and_si256(_mm256_cmpeq_epi8(pixels, _mm256_set1_epi8((char)0xf0)), approaching);
+  __m256i r = _mm256_and_si256(_mm256_cmpeq_epi8(pixels, _mm256_set1_epi8((char)0xe0)), receding);
+  return _mm256_or_si256(pixels, _mm256_or_si256(a, r));
+}
+
+NAVICO_TARGET("avx2")
+static void ExpandLineAVX2(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler) {
+  doppler = ValidDoppler(doppler);
+  const __m256i nibble = _mm256_set1_epi8((char)0xf0);
+  const __m256i approaching = _mm256_set1_epi8((char)fill_approaching[doppler]);
+  const __m256i receding = _mm256_set1_epi8((char)fill_receding[doppler]);
+  size_t i;
+
+  for (i = 0; i + 32 <= packed_len; i += 32) {
+    __m256i in = _mm256_loadu_si256((const __m256i *)(packed + i));
+    // The unpack instructions work within each 128 bit lane, so put input bytes 0-7 and
+    // 16-23 in the low lane and 8-15 and 24-31 in the high lane first.
+    in = _mm256_permute4x64_epi64(in, 0xd8);
+    __m256i low = _mm256_and_si256(_mm256_slli_epi16(in, 4), nibble);
+    __m256i high = _mm256_and_si256(in, nibble);
+
+    low = DopplerAVX2(low, approaching, receding);
+    high = DopplerAVX2(high, approaching, receding);
+    _mm256_storeu_si256((__m256i *)(out + 2 * i), _mm256_unpacklo_epi8(low, high));
+    _mm256_storeu_si256((__m256i *)(out + 2 * i + 32), _mm256_unpackhi_epi8(low, high));
+  }
+  NavicoExpandLineScalar(packed + i, packed_len - i, out + 2 * i, doppler);
+}
+
+static bool HaveSSE2() {
+#if defined(__x86_64__) || defined(_M_X64)
+  return true;  // Part of the x86-64 base instruction set
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse2");
+#endif
+}
+
+static bool HaveAVX2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info, 1);
+  bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;  // OSXSAVE, and XMM + YMM state enabled
+  __cpuidex(info, 7, 0);
+  return os_saves_ymm && (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+NavicoExpandFunction NavicoExpandSSE2() { return HaveSSE2() ? ExpandLineSSE2 : 0; }
+NavicoExpandFunction NavicoExpandAVX2() { return HaveAVX2() ? ExpandLineAVX2 : 0; }
+
+#else
+
+NavicoExpandFunction NavicoExpandSSE2() { return 0; }
+NavicoExpandFunction NavicoExpandAVX2() { return 0; }
+
+#endif
+
+#ifdef NAVICO_EXPAND_NEON
+
+static void ExpandLineNEON(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler) {
+  doppler = ValidDoppler(doppler);
+  const uint8x16_t nibble = vdupq_n_u8(0xf0);
+  const uint8x16_t approaching_value = vdupq_n_u8(0xf0);
+  const uint8x16_t receding_value = vdupq_n_u8(0xe0);
+  const uint8x16_t approaching = vdupq_n_u8(fill_approaching[doppler]);
+  const uint8x16_t receding = vdupq_n_u8(fill_receding[doppler]);
+  size_t i;
+
+  for (i = 0; i + 16 <= packed_len; i += 16) {
+    uint8x16_t in = vld1q_u8(packed + i);
+    uint8x16x2_t pixels;
+
+    pixels.val[0] = vshlq_n_u8(in, 4);
+    pixels.val[1] = vandq_u8(in, nibble);
+    for (int n = 0; n < 2; n++) {
+      uint8x16_t a = vandq_u8(vceqq_u8(pixels.val[n], approaching_value), approaching);
+      uint8x16_t r = vandq_u8(vceqq_u8(pixels.val[n], receding_value), receding);
+      pixels.val[n] = vorrq_u8(pixels.val[n], vorrq_u8(a, r));
+    }
+    vst2q_u8(out + 2 * i, pixels);  // Stores low and high interleaved
+  }
+  NavicoExpandLineScalar(packed + i, packed_len - i, out + 2 * i, doppler);
+}
+
+NavicoExpandFunction NavicoExpandNEON() { return ExpandLineNEON; }
+
+#else
+
+NavicoExpandFunction NavicoExpandNEON() { return 0; }
+
+#endif
+
+void NavicoExpandInit() {
+  InitializeLookupData();
+
+  if (NavicoExpandAVX2()) {
+    expand_kernel = NavicoExpandAVX2();
+    expand_kernel_name = "AVX2";
+  } else if (NavicoExpandSSE2()) {
+    expand_kernel = NavicoExpandSSE2();
+    expand_kernel_name = "SSE2";
+  } else if (NavicoExpandNEON()) {
+    expand_kernel = NavicoExpandNEON();
+    expand_kernel_name = "NEON";
+  }
+}
+
+void NavicoExpandLine(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler) {
+  expand_kernel(packed, packed_len, out, doppler);
+}
+
+const char *NavicoExpandKernelName() { return expand_kernel_name; }
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,79 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _NAVICOEXPAND_H_
+#define _NAVICOEXPAND_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pi_common.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Expansion of a Navico spoke from 4 bits per pixel to 8 bits per pixel.
+//
+// Each input byte holds two pixels, the low nibble first. Pixel value n becomes n << 4,
+// except when Doppler is on:
+//
+//   NAVICO_DOPPLER_BOTH:        0x0f (approaching) becomes 0xff, 0x0e (receding) becomes 0xfe
+//   NAVICO_DOPPLER_APPROACHING: 0x0f (approaching) becomes 0xff, receding stays as is
+//
+// NavicoExpandLine() uses the fastest kernel that the CPU supports, chosen once by
+// NavicoExpandInit(). NavicoExpandLineScalar() is the table driven reference that the
+// other kernels must match byte for byte, see NavicoExpand-test.cpp.
+//
+
+enum NavicoDopplerMode { NAVICO_DOPPLER_NONE, NAVICO_DOPPLER_BOTH, NAVICO_DOPPLER_APPROACHING, NAVICO_DOPPLER_MODES };
+
+typedef void (*NavicoExpandFunction)(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler);
+
+// Builds the lookup tables and picks the kernel. Call once before NavicoExpandLine.
+extern void NavicoExpandInit();
+
+// Expand packed_len bytes into 2 * packed_len bytes. doppler is a NavicoDopplerMode.
+extern void NavicoExpandLine(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler);
+
+// Name of the kernel used by NavicoExpandLine, for logging.
+extern const char *NavicoExpandKernelName();
+
+extern void NavicoExpandLineScalar(const uint8_t *packed, size_t packed_len, uint8_t *out, int doppler);
+
+// The SIMD kernels, 0 when not compiled in or not supported by this CPU.
+// Only exported so that the test can compare each of them against the scalar version.
+extern NavicoExpandFunction NavicoExpandSSE2();
+extern NavicoExpandFunction NavicoExpandAVX2();
+extern NavicoExpandFunction NavicoExpandNEON();
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _NAVICOEXPAND_H_ */
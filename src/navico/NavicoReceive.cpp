@@ -33,6 +33,7 @@
 #include "NavicoReceive.h"
 #include "MessageBox.h"
 #include "NavicoControl.h"
+#include "NavicoExpand.h"
 
 PLUGIN_BEGIN_NAMESPACE
 
@@ -127,61 +128,6 @@ struct radar_frame_pkt {
 };
 #pragma pack(pop)
 
-enum LookupSpokeEnum {
-  LOOKUP_SPOKE_LOW_NORMAL,
-  LOOKUP_SPOKE_LOW_BOTH,
-  LOOKUP_SPOKE_LOW_APPROACHING,
-  LOOKUP_SPOKE_HIGH_NORMAL,
-  LOOKUP_SPOKE_HIGH_BOTH,
-  LOOKUP_SPOKE_HIGH_APPROACHING
-};
-
-static uint8_t lookupData[6][256];
-
-void NavicoReceive::InitializeLookupData() {
-  if (lookupData[5][255] == 0) {
-    for (int j = 0; j <= UINT8_MAX; j++) {
-      uint8_t low = (j & 0x0f) << 4;
-      uint8_t high = (j & 0xf0);
-
-      lookupData[LOOKUP_SPOKE_LOW_NORMAL][j] = low;
-      lookupData[LOOKUP_SPOKE_HIGH_NORMAL][j] = high;
-
-      switch (low) {
-        case 0xf0:
-          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xff;
-          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = 0xff;
-          break;
-
-        case 0xe0:
-          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = 0xfe;
-          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
-          break;
-
-        default:
-          lookupData[LOOKUP_SPOKE_LOW_BOTH][j] = low;
-          lookupData[LOOKUP_SPOKE_LOW_APPROACHING][j] = low;
-      }
-
-      switch (high) {
-        case 0xf0:
-          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xff;
-          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = 0xff;
-          break;
-
-        case 0xe0:
-          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = 0xfe;
-          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
-          break;
-
-        default:
-          lookupData[LOOKUP_SPOKE_HIGH_BOTH][j] = high;
-          lookupData[LOOKUP_SPOKE_HIGH_APPROACHING][j] = high;
-      }
-    }
-  }
-}
-
 // ProcessFrame
 // ------------
 // Process one radar frame packet, which can contain up to 32 'spokes' or lines extending outwards
@@ -195,8 +141,6 @@ void NavicoReceive::ProcessFrame(const uint8_t *data, size_t len) {
 
   radar_frame_pkt *packet = (radar_frame_pkt *)data;
 
-  wxCriticalSectionLocker lock(m_ri->m_exclusive);
-
   m_ri->m_radar_timeout = now + WATCHDOG_TIMEOUT;
   m_ri->m_data_timeout = now + DATA_TIMEOUT;
   m_ri->m_state.Update(RADAR_TRANSMIT);
@@ -330,14 +274,38 @@ void NavicoReceive::ProcessFrame(const uint8_t *data, size_t len) {
     if (doppler < 0 || doppler > 2) {
       doppler = 0;
     }
-    uint8_t *lookup_low = lookupData[LOOKUP_SPOKE_LOW_NORMAL + doppler];
-    uint8_t *lookup_high = lookupData[LOOKUP_SPOKE_HIGH_NORMAL + doppler];
-    for (int i = 0; i < NAVICO_SPOKE_LEN / 2; i++) {
-      data_highres[2 * i] = lookup_low[line->data[i]];
-      data_highres[2 * i + 1] = lookup_high[line->data[i]];
-    }
-    m_ri->ProcessRadarSpoke(a, b, data_highres, len, range_meters, time_rec);
+    NavicoExpandLine(line->data, NAVICO_SPOKE_LEN / 2, data_highres, doppler);
+    m_ri->QueueRadarSpoke(a, b, data_highres, len, range_meters, time_rec);
+  }
+}
+
+/*
+ * ProcessReplayPacket
+ *
+ * Called by ReplayReceive for every datagram in a capture file.
+ * When the multicast addresses are not known yet (Halo before NavicoLocate has run) the
+ * datagram is recognized by its size: a frame is a header followed by a whole number of lines.
+ */
+bool NavicoReceive::ProcessReplayPacket(const NetworkAddress &src, const NetworkAddress &dst, const uint8_t *data, size_t len) {
+  const size_t frame_header_len = sizeof(((radar_frame_pkt *)0)->frame_hdr);
+  bool is_frame;
+
+  if (!m_info.spoke_data_addr.IsNull() && dst == m_info.spoke_data_addr) {
+    is_frame = true;
+  } else if (!m_info.report_addr.IsNull() && dst == m_info.report_addr) {
+    is_frame = false;
+  } else if (m_info.spoke_data_addr.IsNull()) {
+    is_frame = len >= frame_header_len + sizeof(radar_line) && (len - frame_header_len) % sizeof(radar_line) == 0;
+  } else {
+    return false;  // Data for another radar, for instance the other range of a dual range Halo
+  }
+
+  if (is_frame) {
+    ProcessFrame(data, len);
+  } else {
+    ProcessReport(data, len);
   }
+  return true;
 }
 
 SOCKET NavicoReceive::PickNextEthernetCard() {
@@ -33,6 +33,7 @@
 #define _NAVICORECEIVE_H_
 
 #include "NavicoCommon.h"
+#include "NavicoExpand.h"
 #include "NavicoLocate.h"
 #include "RadarReceive.h"
 #include "socketutil.h"
@@ -63,7 +64,8 @@ class NavicoReceive : public RadarReceive {
     SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Initializing")));
     SetPriority(wxPRIORITY_MAX);
     LOG_INFO(wxT("radar_pi: %s receive thread created, prio= %i"), m_ri->m_name.c_str(), GetPriority());
-    InitializeLookupData();
+    NavicoExpandInit();
+    LOG_VERBOSE(wxT("radar_pi: %s spoke expansion uses %s"), m_ri->m_name.c_str(), NavicoExpandKernelName());
 
     NavicoRadarInfo info = m_pi->GetNavicoRadarInfo(m_ri->m_radar);
     if (info.report_addr.IsNull() && !m_info.report_addr.IsNull()) {
@@ -81,11 +83,10 @@ class NavicoReceive : public RadarReceive {
 
   ~NavicoReceive(){};
 
-  void InitializeLookupData();
-
   void *Entry(void);
   void Shutdown(void);
   wxString GetInfoStatus();
+  bool ProcessReplayPacket(const NetworkAddress &src, const NetworkAddress &dst, const uint8_t *data, size_t len);
 
   NetworkAddress m_interface_addr;
   NavicoRadarInfo m_info;
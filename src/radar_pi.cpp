@@ -36,6 +36,7 @@
 #include "MessageBox.h"
 #include "OptionsDialog.h"
 #include "RadarMarpa.h"
+#include "ScanFilter.h"
 #include "SelectDialog.h"
 #include "icons.h"
 #include "navico/NavicoLocate.h"
@@ -226,6 +227,7 @@ int radar_pi::Init(void) {
   m_radar_heading = nanl("");
   m_vp_rotation = 0.;
   m_arpa_max_range = BASE_ARPA_DIST;
+  m_ais_index_valid = false;
 
   // Set default settings before we load config. Prevents random behavior on uninitalized behavior.
   // For instance, LOG_XXX messages before config is loaded.
@@ -1079,18 +1081,25 @@ void radar_pi::TimedControlUpdate() {
     PassHeadingToOpenCPN();
   }
 
-  if (m_pMessageBox->IsShown() || (m_settings.verbose != 0)) {
-    wxString t;
-    for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
-      if (m_radar[r]->m_state.GetValue() != RADAR_OFF) {
-        wxCriticalSectionLocker lock(m_radar[r]->m_exclusive);
+  // Always take and reset the counters, so they don't show huge numbers after IsShown changes
+  bool show_statistics = m_pMessageBox->IsShown() || (m_settings.verbose != 0);
+  wxString t;
+  for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
+    receive_statistics &statistics = m_radar[r]->m_statistics;
+    int packets = statistics.packets.exchange(0);
+    int broken_packets = statistics.broken_packets.exchange(0);
+    int spokes = statistics.spokes.exchange(0);
+    int broken_spokes = statistics.broken_spokes.exchange(0);
+    int missing_spokes = statistics.missing_spokes.exchange(0);
+    int dropped_spokes = statistics.dropped_spokes.exchange(0);
 
-        t << wxString::Format(wxT("%s\npackets %d/%d\nspokes %d/%d/%d\n"), m_radar[r]->m_name.c_str(),
-                              m_radar[r]->m_statistics.packets, m_radar[r]->m_statistics.broken_packets,
-                              m_radar[r]->m_statistics.spokes, m_radar[r]->m_statistics.broken_spokes,
-                              m_radar[r]->m_statistics.missing_spokes);
-      }
+    if (show_statistics && m_radar[r]->m_state.GetValue() != RADAR_OFF) {
+      t << wxString::Format(wxT("%s\npackets %d/%d\nspokes %d/%d/%d/%d\n"), m_radar[r]->m_name.c_str(), packets, broken_packets,
+                            spokes, broken_spokes, missing_spokes, dropped_spokes);
     }
+  }
+
+  if (show_statistics) {
     m_pMessageBox->SetStatisticsInfo(t);
 
     IF_LOG_AT_LEVEL(LOGLEVEL_RECEIVE) {
@@ -1101,17 +1110,6 @@ void radar_pi::TimedControlUpdate() {
     }
   }
 
-  // Always reset the counters, so they don't show huge numbers after IsShown changes
-  for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
-    wxCriticalSectionLocker lock(m_radar[r]->m_exclusive);
-
-    m_radar[r]->m_statistics.broken_packets = 0;
-    m_radar[r]->m_statistics.broken_spokes = 0;
-    m_radar[r]->m_statistics.missing_spokes = 0;
-    m_radar[r]->m_statistics.packets = 0;
-    m_radar[r]->m_statistics.spokes = 0;
-  }
-
   wxString info;
   switch (m_heading_source) {
     case HEADING_NONE:
@@ -1256,26 +1254,6 @@ bool radar_pi::RenderGLOverlayMultiCanvas(wxGLContext *pcontext, PlugIn_ViewPort
     return true;
   }
 
-  // refresh ARPA targets only with canvas 0
-  if (canvasIndex == 0) {
-    for (size_t r = 0; r < M_SETTINGS.radar_count; r++) {
-      bool arpa_on = false;
-      if (m_radar[r]->m_arpa) {
-        for (int i = 0; i < GUARD_ZONES; i++) {
-          if (m_radar[r]->m_guard_zone[i]->m_arpa_on) {
-            arpa_on = true;
-          }
-        }
-        if (m_radar[r]->m_arpa->GetTargetCount() > 0) {
-          arpa_on = true;
-        }
-      }
-      if (arpa_on) {
-        m_radar[r]->m_arpa->RefreshArpaTargets();
-      }
-    }
-  }
-
   m_vp = vp;
 
   LOG_DIALOG(wxT("radar_pi: RenderGLOverlayMultiCanvas context=%p canvas=%d"), pcontext, canvasIndex);
@@ -1407,6 +1385,8 @@ bool radar_pi::LoadConfig(void) {
       pConf->Read(wxString::Format(wxT("Radar%dNavicoInfo"), r), &s, "");
       m_settings.navico_radar_info[r] = NavicoRadarInfo(s);
 
+      pConf->Read(wxString::Format(wxT("Radar%dReplayFile"), r), &m_settings.replay_file[n], wxT(""));
+      pConf->Read(wxString::Format(wxT("Radar%dSnapshotFile"), r), &m_settings.snapshot_file[n], wxT(""));
       pConf->Read(wxString::Format(wxT("Radar%dRange"), r), &v, 2000);
       ri->m_range.Update(v);
       pConf->Read(wxString::Format(wxT("Radar%dRotation"), r), &v, 0);
@@ -1461,6 +1441,10 @@ bool radar_pi::LoadConfig(void) {
         pConf->Read(wxString::Format(wxT("Radar%dZone%dType"), r, i), &v, 0);
         pConf->Read(wxString::Format(wxT("Radar%dZone%dAlarmOn"), r, i), &ri->m_guard_zone[i]->m_alarm_on, 0);
         pConf->Read(wxString::Format(wxT("Radar%dZone%dArpaOn"), r, i), &ri->m_guard_zone[i]->m_arpa_on, 0);
+        pConf->Read(wxString::Format(wxT("Radar%dZone%dPolygonGeo"), r, i), &ri->m_guard_zone[i]->m_polygon_geo, 0);
+        pConf->Read(wxString::Format(wxT("Radar%dZone%dPolygonExclude"), r, i), &ri->m_guard_zone[i]->m_polygon_exclude, 0);
+        pConf->Read(wxString::Format(wxT("Radar%dZone%dPolygon"), r, i), &s, wxT(""));
+        ri->m_guard_zone[i]->SetPolygon(s);
         ri->m_guard_zone[i]->SetType((GuardZoneType)v);
       }
       pConf->Read(wxT("AlarmPosX"), &x, 25);
@@ -1500,10 +1484,16 @@ bool radar_pi::LoadConfig(void) {
     pConf->Read(wxT("GuardZonesThreshold"), &m_settings.guard_zone_threshold, 5L);
     pConf->Read(wxT("IgnoreRadarHeading"), &m_settings.ignore_radar_heading, 0);
     pConf->Read(wxT("ShowExtremeRange"), &m_settings.show_extreme_range, false);
+    pConf->Read(wxT("AdaptiveThreshold"), &m_settings.adaptive_threshold, false);
+    pConf->Read(wxT("ScanFilter"), &m_settings.scan_filter, 0);
+    if (m_settings.scan_filter < SCAN_FILTER_OFF || m_settings.scan_filter >= SCAN_FILTER_MODES) {
+      m_settings.scan_filter = SCAN_FILTER_OFF;
+    }
     pConf->Read(wxT("MenuAutoHide"), &m_settings.menu_auto_hide, 0);
     pConf->Read(wxT("PassHeadingToOCPN"), &m_settings.pass_heading_to_opencpn, false);
     pConf->Read(wxT("Refreshrate"), &v, 3);
     m_settings.refreshrate.Update(v);
+    pConf->Read(wxT("ReplaySpeed"), &m_settings.replay_speed, 1.0);
     pConf->Read(wxT("ReverseZoom"), &m_settings.reverse_zoom, false);
     pConf->Read(wxT("ScanMaxAge"), &m_settings.max_age, 6);
     pConf->Read(wxT("Show"), &m_settings.show, true);
@@ -1550,10 +1540,13 @@ bool radar_pi::SaveConfig(void) {
     pConf->Write(wxT("GuardZonesThreshold"), m_settings.guard_zone_threshold);
     pConf->Write(wxT("IgnoreRadarHeading"), m_settings.ignore_radar_heading);
     pConf->Write(wxT("ShowExtremeRange"), m_settings.show_extreme_range);
+    pConf->Write(wxT("AdaptiveThreshold"), m_settings.adaptive_threshold);
+    pConf->Write(wxT("ScanFilter"), m_settings.scan_filter);
     pConf->Write(wxT("MenuAutoHide"), m_settings.menu_auto_hide);
     pConf->Write(wxT("PassHeadingToOCPN"), m_settings.pass_heading_to_opencpn);
     pConf->Write(wxT("RangeUnits"), (int)m_settings.range_units);
     pConf->Write(wxT("Refreshrate"), m_settings.refreshrate.GetValue());
+    pConf->Write(wxT("ReplaySpeed"), m_settings.replay_speed);
     pConf->Write(wxT("ReverseZoom"), m_settings.reverse_zoom);
     pConf->Write(wxT("ScanMaxAge"), m_settings.max_age);
     pConf->Write(wxT("Show"), m_settings.show);
@@ -1584,6 +1577,12 @@ bool radar_pi::SaveConfig(void) {
       pConf->Write(wxString::Format(wxT("Radar%dAddress"), r), m_settings.radar_address[r].FormatNetworkAddress());
       pConf->Write(wxString::Format(wxT("Radar%dInterface"), r), m_settings.radar_interface_address[r].FormatNetworkAddress());
       pConf->Write(wxString::Format(wxT("Radar%dRange"), r), m_radar[r]->m_range.GetValue());
+      if (!m_settings.replay_file[r].IsEmpty()) {
+        pConf->Write(wxString::Format(wxT("Radar%dReplayFile"), r), m_settings.replay_file[r]);
+      }
+      if (!m_settings.snapshot_file[r].IsEmpty()) {
+        pConf->Write(wxString::Format(wxT("Radar%dSnapshotFile"), r), m_settings.snapshot_file[r]);
+      }
       pConf->Write(wxString::Format(wxT("Radar%dRotation"), r), m_radar[r]->m_orientation.GetValue());
       pConf->Write(wxString::Format(wxT("Radar%dTransmit"), r), m_radar[r]->m_state.GetValue());
       pConf->Write(wxString::Format(wxT("Radar%dWindowShow"), r), m_settings.show_radar[r]);
@@ -1614,6 +1613,9 @@ bool radar_pi::SaveConfig(void) {
         pConf->Write(wxString::Format(wxT("Radar%dZone%dType"), r, i), (int)m_radar[r]->m_guard_zone[i]->m_type);
         pConf->Write(wxString::Format(wxT("Radar%dZone%dAlarmOn"), r, i), m_radar[r]->m_guard_zone[i]->m_alarm_on);
         pConf->Write(wxString::Format(wxT("Radar%dZone%dArpaOn"), r, i), m_radar[r]->m_guard_zone[i]->m_arpa_on);
+        pConf->Write(wxString::Format(wxT("Radar%dZone%dPolygonGeo"), r, i), m_radar[r]->m_guard_zone[i]->m_polygon_geo);
+        pConf->Write(wxString::Format(wxT("Radar%dZone%dPolygonExclude"), r, i), m_radar[r]->m_guard_zone[i]->m_polygon_exclude);
+        pConf->Write(wxString::Format(wxT("Radar%dZone%dPolygon"), r, i), m_radar[r]->m_guard_zone[i]->GetPolygon());
       }
     }
 
@@ -1850,11 +1852,13 @@ void radar_pi::SetPositionFixEx(PlugIn_Position_Fix_Ex &pfix) {
 
     m_GPS_filter->Predict(&m_last_fixed, &m_expected_position);         // update expected position based on previous positions
     m_GPS_filter->Update_P();                                           // update error covariance matrix
-    m_GPS_filter->SetMeasurement(&GPS_position, &m_expected_position);  // improve expected postition with GPS
+    // improve expected postition with GPS
+    bool measured = m_GPS_filter->SetMeasurement(&GPS_position, &m_expected_position);
 
-    // check validity of this position
-    if (m_expected_position.pos.lat > 90. || m_expected_position.pos.lat < -90. || m_expected_position.pos.lon < -180. ||
-        m_expected_position.pos.lat > 180. || isnan(m_expected_position.pos.lat) || isnan(m_expected_position.pos.lon)) {
+    // check validity of this position, and whether the GPS position could be used at all
+    if (!measured || m_expected_position.pos.lat > 90. || m_expected_position.pos.lat < -90. ||
+        m_expected_position.pos.lon < -180. || m_expected_position.pos.lat > 180. || isnan(m_expected_position.pos.lat) ||
+        isnan(m_expected_position.pos.lon)) {
       // if not valid, reset the Kalman filter
       LOG_INFO(wxT("** error in position, GPSfilter reset lat=%f, lon=%f"), m_expected_position.pos.lat,
                m_expected_position.pos.lon);
@@ -1945,6 +1949,8 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
         break;
       }
     }
+    wxCriticalSectionLocker lock(m_exclusive);  // FindAIS_at_arpaPos runs in the RadarProcess threads
+
     if (arpa_is_present) {
       wxJSONReader reader;
       wxJSONValue message;
@@ -1966,6 +1972,7 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
                 m_ais_in_arpa_zone[i].ais_time_upd = time(0);
                 m_ais_in_arpa_zone[i].ais_lat = f_AISLat;
                 m_ais_in_arpa_zone[i].ais_lon = f_AISLon;
+                m_ais_index_valid = false;
                 updated = true;
                 break;
               }
@@ -1977,6 +1984,7 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
               m_new_ais_target.ais_lat = f_AISLat;
               m_new_ais_target.ais_lon = f_AISLon;
               m_ais_in_arpa_zone.push_back(m_new_ais_target);
+              m_ais_index_valid = false;
             }
           }
         }
@@ -1984,10 +1992,13 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
     }
     // Delete > 3 min old AIS items or at once if no active ARPA
     if (m_ais_in_arpa_zone.size() > 0) {
-      for (size_t i = 0; i < m_ais_in_arpa_zone.size(); i++) {
+      for (size_t i = 0; i < m_ais_in_arpa_zone.size();) {
         if (m_ais_in_arpa_zone[i].ais_mmsi > 0 && (time(0) - m_ais_in_arpa_zone[i].ais_time_upd > 3 * 60 || !arpa_is_present)) {
           m_ais_in_arpa_zone.erase(m_ais_in_arpa_zone.begin() + i);
+          m_ais_index_valid = false;
           m_arpa_max_range = BASE_ARPA_DIST;  // Renew AIS search area
+        } else {
+          i++;
         }
       }
     }
@@ -1995,23 +2006,29 @@ void radar_pi::SetPluginMessage(wxString &message_id, wxString &message_body) {
 }
 
 bool radar_pi::FindAIS_at_arpaPos(const GeoPosition &pos, const double &arpa_dist) {
+  wxCriticalSectionLocker lock(m_exclusive);
+
   m_arpa_max_range = MAX(arpa_dist + 200, m_arpa_max_range);  // For AIS search area
   if (m_ais_in_arpa_zone.size() < 1) return false;
-  bool hit = false;
   // Default 50 >> look 100 meters around + 4% of distance to target
   double offset = (double)m_settings.AISatARPAoffset;
   double dist2target = (4.0 / 100) * arpa_dist;
   offset += dist2target;
   offset = offset / 1852. / 60.;
-  for (size_t i = 0; i < m_ais_in_arpa_zone.size(); i++) {
-    if (m_ais_in_arpa_zone[i].ais_mmsi != 0) {  // Avtive post
-      if (pos.lat + offset > m_ais_in_arpa_zone[i].ais_lat && pos.lat - offset < m_ais_in_arpa_zone[i].ais_lat &&
-          pos.lon + (offset * 1.75) > m_ais_in_arpa_zone[i].ais_lon && pos.lon - (offset * 1.75) < m_ais_in_arpa_zone[i].ais_lon) {
-        hit = true;
-        break;
+
+  // Every ARPA target looks here on every refresh, while the list only changes when AIS
+  // messages arrive. So index the positions once, instead of going through the list each time.
+  if (!m_ais_index_valid) {
+    m_ais_index.Clear();
+    for (size_t i = 0; i < m_ais_in_arpa_zone.size(); i++) {
+      if (m_ais_in_arpa_zone[i].ais_mmsi != 0) {  // Active post
+        m_ais_index.Add((int)i, m_ais_in_arpa_zone[i].ais_lat, m_ais_in_arpa_zone[i].ais_lon);
       }
     }
+    m_ais_index_valid = true;
   }
+  int ais;
+  bool hit = m_ais_index.FindInBox(pos.lat, pos.lon, offset, offset * 1.75, &ais, 1) > 0;
   return hit;
 }
 
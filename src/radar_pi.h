@@ -36,7 +36,9 @@
 #define MY_API_VERSION_MINOR 16  // Needed for PluginAISDrawGL().
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
+#include "GeoIndex.h"
 #include "RadarControlItem.h"
 #include "drawutil.h"
 #include "jsonreader.h"
@@ -69,6 +71,7 @@ class ControlsDialog;
 class MessageBox;
 class OptionsDialog;
 class RadarReceive;
+class RadarProcess;
 class RadarControl;
 class radar_pi;
 class GuardZoneBogey;
@@ -191,15 +194,20 @@ enum RadarState {
 static ToolbarIconColor g_toolbarIconColor[9] = {TB_SEARCHING, TB_STANDBY, TB_SEEN,   TB_SEEN,  TB_SEEN,
                                                  TB_SEEN,      TB_ACTIVE,  TB_ACTIVE, TB_ACTIVE};
 
+// Counted by the receive threads without locking, so the counters are atomic. Once per second
+// TimedControlUpdate takes them and resets them to zero in a single exchange.
 struct receive_statistics {
-  int packets;
-  int broken_packets;
-  int spokes;
-  int broken_spokes;
-  int missing_spokes;
+  std::atomic<int> packets;
+  std::atomic<int> broken_packets;
+  std::atomic<int> spokes;
+  std::atomic<int> broken_spokes;
+  std::atomic<int> missing_spokes;
+  std::atomic<int> dropped_spokes;  // Spokes lost because the RadarProcess ring was full
+
+  receive_statistics() : packets(0), broken_packets(0), spokes(0), broken_spokes(0), missing_spokes(0), dropped_spokes(0) {}
 };
 
-typedef enum GuardZoneType { GZ_ARC, GZ_CIRCLE } GuardZoneType;
+typedef enum GuardZoneType { GZ_ARC, GZ_CIRCLE, GZ_POLYGON } GuardZoneType;
 
 typedef enum RadarType {
 #define DEFINE_RADAR(t, n, s, l, a, b, c, d) t,
@@ -386,6 +394,8 @@ struct PersistentSettings {
   bool ignore_radar_heading;                       // For testing purposes
   bool reverse_zoom;                               // false = normal, true = reverse
   bool show_extreme_range;                         // Show red ring at extreme range and center
+  bool adaptive_threshold;                         // Raise the thresholds for ARPA and guard zones in clutter
+  int scan_filter;                                // ScanFilterMode, 0 = off
   bool reset_radars;                               // True on exit of OptionsDialog when reset of radars is pressed
   int threshold_red;                               // Radar data has to be this strong to show as STRONG
   int threshold_green;                             // Radar data has to be this strong to show as INTERMEDIATE
@@ -397,6 +407,9 @@ struct PersistentSettings {
   wxPoint window_pos[RADARS];                      // Saved position of radar windows, when floating and not docked
   wxPoint alarm_pos;                               // Saved position of alarm window
   wxString alert_audio_file;                       // Filepath of alarm audio file. Must be WAV.
+  wxString replay_file[RADARS];                    // Capture file to replay instead of receiving from the network
+  double replay_speed;                             // Replay pace, 1 = original speed, N = N times faster, 0 = maximum
+  wxString snapshot_file[RADARS];                  // File that keeps history and trails across restarts
   NetworkAddress radar_interface_address[RADARS];  // Saved address of interface used to see radar. Used to speed up next boot.
   NetworkAddress radar_address[RADARS];            // Saved address of IP address of radar.
   NavicoRadarInfo navico_radar_info[RADARS];       // Navico specific stuff (multicast addresses + serial nr)
@@ -581,6 +594,8 @@ class radar_pi : public opencpn_plugin_116, public wxEvtHandler {
 
   // Check for AIS targets inside ARPA zone
   vector<AisArpa> m_ais_in_arpa_zone;  // Array for AIS targets in ARPA zone(s)
+  GeoIndex m_ais_index;                // Positions of m_ais_in_arpa_zone, rebuilt when m_ais_index_valid is false
+  bool m_ais_index_valid;
   bool FindAIS_at_arpaPos(const GeoPosition &pos, const double &arpa_dist);
 #define BASE_ARPA_DIST (750.)
   double m_arpa_max_range;  //  Temporary distance(m) fron own ship to collect AIS targets.
@@ -0,0 +1,368 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "PcapReader.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define PCAP_MAGIC_MICROSECONDS (0xa1b2c3d4)
+#define PCAP_MAGIC_NANOSECONDS (0xa1b23c4d)
+#define PCAPNG_MAGIC (0x0a0d0d0a)
+#define PCAP_MAX_FRAME (16 * 1024 * 1024)  // Anything larger means the file is corrupt
+
+#define LINKTYPE_NULL (0)
+#define LINKTYPE_ETHERNET (1)
+#define LINKTYPE_RAW (101)
+#define LINKTYPE_LINUX_SLL (113)
+#define LINKTYPE_IPV4 (228)
+
+#define ETHERTYPE_IPV4 (0x0800)
+#define ETHERTYPE_VLAN (0x8100)
+#define IP_PROTOCOL_UDP (17)
+
+#pragma pack(push, 1)
+
+struct pcap_file_header {
+  uint32_t magic;
+  uint16_t version_major;
+  uint16_t version_minor;
+  int32_t thiszone;
+  uint32_t sigfigs;
+  uint32_t snaplen;
+  uint32_t linktype;
+};
+
+struct pcap_record_header {
+  uint32_t ts_sec;
+  uint32_t ts_frac;  // micro or nanoseconds, depending on magic
+  uint32_t incl_len;
+  uint32_t orig_len;
+};
+
+#pragma pack(pop)
+
+static uint16_t Get16BE(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+PcapReader::PcapReader() {
+  m_file = 0;
+  m_zlib = 0;
+  m_stream = 0;
+  m_frame = 0;
+  m_frame_size = 0;
+  m_swapped = false;
+  m_nanoseconds = false;
+  m_link_type = 0;
+  m_snap_len = 0;
+  m_frames = 0;
+  m_datagrams = 0;
+  m_dropped_fragments = 0;
+  m_next_slot = 0;
+  CLEAR_STRUCT(m_reassembly);
+}
+
+PcapReader::~PcapReader() {
+  Close();
+  for (size_t i = 0; i < PCAP_REASSEMBLY_SLOTS; i++) {
+    if (m_reassembly[i].data) {
+      free(m_reassembly[i].data);
+      m_reassembly[i].data = 0;
+    }
+  }
+  if (m_frame) {
+    free(m_frame);
+    m_frame = 0;
+  }
+}
+
+void PcapReader::Close() {
+  if (m_zlib) {
+    delete m_zlib;
+    m_zlib = 0;
+  }
+  if (m_file) {
+    delete m_file;
+    m_file = 0;
+  }
+  m_stream = 0;
+}
+
+bool PcapReader::Open(const wxString &filename) {
+  pcap_file_header header;
+
+  Close();
+  m_filename = filename;
+  m_frames = 0;
+  m_datagrams = 0;
+  m_dropped_fragments = 0;
+  for (size_t i = 0; i < PCAP_REASSEMBLY_SLOTS; i++) {
+    m_reassembly[i].received = 0;
+    m_reassembly[i].total = 0;
+  }
+
+  m_file = new wxFFileInputStream(filename);
+  if (!m_file->IsOk()) {
+    wxLogError(wxT("radar_pi: cannot open capture file '%s'"), filename.c_str());
+    Close();
+    return false;
+  }
+  m_stream = m_file;
+  if (filename.Lower().EndsWith(wxT(".gz"))) {
+    m_zlib = new wxZlibInputStream(*m_file, wxZLIB_GZIP);
+    m_stream = m_zlib;
+  }
+
+  if (!ReadExact(&header, sizeof(header))) {
+    wxLogError(wxT("radar_pi: capture file '%s' is too short"), filename.c_str());
+    Close();
+    return false;
+  }
+
+  m_swapped = false;
+  if (header.magic == PCAP_MAGIC_MICROSECONDS || header.magic == PCAP_MAGIC_NANOSECONDS) {
+    m_nanoseconds = header.magic == PCAP_MAGIC_NANOSECONDS;
+  } else if (wxUINT32_SWAP_ALWAYS(header.magic) == PCAP_MAGIC_MICROSECONDS ||
+             wxUINT32_SWAP_ALWAYS(header.magic) == PCAP_MAGIC_NANOSECONDS) {
+    m_swapped = true;
+    m_nanoseconds = wxUINT32_SWAP_ALWAYS(header.magic) == PCAP_MAGIC_NANOSECONDS;
+  } else {
+    if (header.magic == PCAPNG_MAGIC) {
+      wxLogError(wxT("radar_pi: capture file '%s' is in pcapng format, convert it to pcap first"), filename.c_str());
+    } else {
+      wxLogError(wxT("radar_pi: capture file '%s' is not a pcap file"), filename.c_str());
+    }
+    Close();
+    return false;
+  }
+  m_link_type = Get32((uint8_t *)&header.linktype);
+  m_snap_len = Get32((uint8_t *)&header.snaplen);
+
+  switch (m_link_type) {
+    case LINKTYPE_NULL:
+    case LINKTYPE_ETHERNET:
+    case LINKTYPE_RAW:
+    case LINKTYPE_LINUX_SLL:
+    case LINKTYPE_IPV4:
+      break;
+    default:
+      wxLogError(wxT("radar_pi: capture file '%s' has unsupported link type %u"), filename.c_str(), m_link_type);
+      Close();
+      return false;
+  }
+
+  return true;
+}
+
+bool PcapReader::ReadExact(void *buf, size_t len) {
+  if (!m_stream) {
+    return false;
+  }
+  m_stream->Read(buf, len);
+  return m_stream->LastRead() == len;
+}
+
+uint32_t PcapReader::Get32(const uint8_t *p) {
+  uint32_t v;
+
+  memcpy(&v, p, sizeof(v));
+  return m_swapped ? wxUINT32_SWAP_ALWAYS(v) : v;
+}
+
+bool PcapReader::ReadDatagram(PcapDatagram *datagram) {
+  pcap_record_header record;
+
+  while (ReadExact(&record, sizeof(record))) {
+    size_t len = Get32((uint8_t *)&record.incl_len);
+
+    if (len > PCAP_MAX_FRAME) {
+      wxLogError(wxT("radar_pi: capture file '%s' is corrupt, frame length %u"), m_filename.c_str(), (unsigned int)len);
+      return false;
+    }
+    if (len > m_frame_size) {
+      m_frame = (uint8_t *)realloc(m_frame, len);
+      if (!m_frame) {
+        wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+        wxAbort();
+      }
+      m_frame_size = len;
+    }
+    if (!ReadExact(m_frame, len)) {
+      LOG_INFO(wxT("radar_pi: capture file '%s' ends with a truncated frame"), m_filename.c_str());
+      return false;
+    }
+    m_frames++;
+
+    uint32_t frac = Get32((uint8_t *)&record.ts_frac);
+    datagram->time = wxLongLong(Get32((uint8_t *)&record.ts_sec)) * 1000000 + (m_nanoseconds ? frac / 1000 : frac);
+
+    const uint8_t *ip = m_frame;
+    size_t ip_len = len;
+
+    switch (m_link_type) {
+      case LINKTYPE_NULL:
+        // 4 byte address family in the byte order of the capturing host, only IPv4 is interesting
+        if (len < 4 || Get32(m_frame) != AF_INET) {
+          continue;
+        }
+        ip += 4;
+        ip_len -= 4;
+        break;
+
+      case LINKTYPE_ETHERNET: {
+        size_t offset = 12;
+        if (len < offset + 2) {
+          continue;
+        }
+        uint16_t ethertype = Get16BE(m_frame + offset);
+        while (ethertype == ETHERTYPE_VLAN && len >= offset + 6) {
+          offset += 4;
+          ethertype = Get16BE(m_frame + offset);
+        }
+        if (ethertype != ETHERTYPE_IPV4) {
+          continue;
+        }
+        ip += offset + 2;
+        ip_len -= offset + 2;
+        break;
+      }
+
+      case LINKTYPE_LINUX_SLL:
+        if (len < 16 || Get16BE(m_frame + 14) != ETHERTYPE_IPV4) {
+          continue;
+        }
+        ip += 16;
+        ip_len -= 16;
+        break;
+
+      default:  // LINKTYPE_RAW and LINKTYPE_IPV4 start with the IP header
+        break;
+    }
+
+    if (ProcessIPv4(ip, ip_len, datagram)) {
+      m_datagrams++;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool PcapReader::ProcessIPv4(const uint8_t *ip, size_t len, PcapDatagram *datagram) {
+  if (len < 20 || (ip[0] >> 4) != 4) {
+    return false;
+  }
+  size_t header_len = (ip[0] & 0x0f) * 4;
+  size_t total_len = Get16BE(ip + 2);
+  if (header_len < 20 || total_len < header_len || total_len > len || ip[9] != IP_PROTOCOL_UDP) {
+    return false;
+  }
+
+  uint16_t fragment = Get16BE(ip + 6);
+  bool more_fragments = (fragment & 0x2000) != 0;
+  size_t offset = (fragment & 0x1fff) * 8;
+  const uint8_t *payload = ip + header_len;
+  size_t payload_len = total_len - header_len;
+
+  if (!more_fragments && offset == 0) {
+    return ProcessUDP(ip, payload, payload_len, datagram);
+  }
+
+  // Fragmented datagram. Navico sends spoke frames of 17160 bytes, these always arrive fragmented.
+  uint32_t src, dst;
+  uint16_t id = Get16BE(ip + 4);
+  memcpy(&src, ip + 12, sizeof(src));
+  memcpy(&dst, ip + 16, sizeof(dst));
+
+  Reassembly *slot = 0;
+  for (size_t i = 0; i < PCAP_REASSEMBLY_SLOTS; i++) {
+    Reassembly *r = &m_reassembly[i];
+    if (r->received > 0 && r->id == id && r->src == src && r->dst == dst) {
+      slot = r;
+      break;
+    }
+  }
+  if (!slot) {
+    slot = &m_reassembly[m_next_slot];
+    m_next_slot = (m_next_slot + 1) % PCAP_REASSEMBLY_SLOTS;
+    if (slot->received > 0) {
+      m_dropped_fragments++;  // Oldest incomplete datagram is thrown away
+    }
+    if (!slot->data) {
+      slot->data = (uint8_t *)malloc(PCAP_MAX_DATAGRAM);
+      if (!slot->data) {
+        wxLogError(wxT("radar_pi: Out Of Memory, fatal!"));
+        wxAbort();
+      }
+    }
+    slot->src = src;
+    slot->dst = dst;
+    slot->id = id;
+    slot->received = 0;
+    slot->total = 0;
+  }
+
+  if (offset + payload_len > PCAP_MAX_DATAGRAM) {
+    m_dropped_fragments++;
+    slot->received = 0;
+    return false;
+  }
+  memcpy(slot->data + offset, payload, payload_len);
+  slot->received += payload_len;
+  if (!more_fragments) {
+    slot->total = offset + payload_len;
+  }
+  if (slot->total == 0 || slot->received < slot->total) {
+    return false;
+  }
+
+  // Complete. The slot is released, but its data stays valid until it is reused in a later call.
+  slot->received = 0;
+  return ProcessUDP(ip, slot->data, slot->total, datagram);
+}
+
+bool PcapReader::ProcessUDP(const uint8_t *ip, const uint8_t *udp, size_t len, PcapDatagram *datagram) {
+  if (len < 8) {
+    return false;
+  }
+  size_t udp_len = Get16BE(udp + 4);
+  if (udp_len < 8 || udp_len > len) {
+    udp_len = len;  // Some stacks put 0 here for large datagrams, trust the IP length instead
+  }
+
+  memcpy(&datagram->src.addr.s_addr, ip + 12, sizeof(datagram->src.addr.s_addr));
+  memcpy(&datagram->dst.addr.s_addr, ip + 16, sizeof(datagram->dst.addr.s_addr));
+  memcpy(&datagram->src.port, udp, sizeof(datagram->src.port));
+  memcpy(&datagram->dst.port, udp + 2, sizeof(datagram->dst.port));
+  datagram->data = udp + 8;
+  datagram->len = udp_len - 8;
+  return true;
+}
+
+PLUGIN_END_NAMESPACE
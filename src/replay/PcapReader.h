@@ -0,0 +1,113 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _PCAPREADER_H_
+#define _PCAPREADER_H_
+
+#include <wx/wfstream.h>
+#include <wx/zstream.h>
+#include "socketutil.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Reads UDP datagrams from a classic libpcap capture file, optionally gzip compressed,
+// such as the ones in the example/ directory.
+//
+// IPv4 fragments are reassembled, as the Navico spoke frames are larger than the
+// Ethernet MTU. The pcapng format is not supported.
+//
+
+#define PCAP_REASSEMBLY_SLOTS (8)
+#define PCAP_MAX_DATAGRAM (65536)
+
+struct PcapDatagram {
+  wxLongLong time;     // Capture time in microseconds since the epoch
+  NetworkAddress src;  // Sender of the datagram
+  NetworkAddress dst;  // Destination, for radars this is usually a multicast group
+  const uint8_t *data;
+  size_t len;
+};
+
+class PcapReader {
+ public:
+  PcapReader();
+  ~PcapReader();
+
+  bool Open(const wxString &filename);
+  void Close();
+
+  /*
+   * ReadDatagram
+   *
+   * Return the next complete UDP datagram in the file. The data pointer stays valid
+   * until the next call. Returns false at the end of the file or when the file is broken.
+   */
+  bool ReadDatagram(PcapDatagram *datagram);
+
+  size_t m_frames;             // Link layer frames read
+  size_t m_datagrams;          // Complete UDP datagrams returned
+  size_t m_dropped_fragments;  // Fragments that could not be reassembled
+
+ private:
+  struct Reassembly {
+    uint32_t src;
+    uint32_t dst;
+    uint16_t id;
+    size_t received;  // Bytes of payload received so far
+    size_t total;     // Total payload length, known once the last fragment was seen, 0 before
+    uint8_t *data;
+  };
+
+  bool ReadExact(void *buf, size_t len);
+  uint32_t Get32(const uint8_t *p);
+  bool ProcessIPv4(const uint8_t *ip, size_t len, PcapDatagram *datagram);
+  bool ProcessUDP(const uint8_t *ip, const uint8_t *udp, size_t len, PcapDatagram *datagram);
+
+  wxString m_filename;
+  wxFFileInputStream *m_file;
+  wxZlibInputStream *m_zlib;
+  wxInputStream *m_stream;
+
+  bool m_swapped;      // File was written on a machine with different endianness
+  bool m_nanoseconds;  // Timestamps have nanosecond instead of microsecond resolution
+  uint32_t m_link_type;
+  uint32_t m_snap_len;
+
+  uint8_t *m_frame;  // Current link layer frame
+  size_t m_frame_size;
+  Reassembly m_reassembly[PCAP_REASSEMBLY_SLOTS];
+  size_t m_next_slot;
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _PCAPREADER_H_ */
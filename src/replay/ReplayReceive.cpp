@@ -0,0 +1,136 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#include "ReplayReceive.h"
+#include "PcapReader.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+#define MILLIS_PER_SLEEP (50)  // Maximum time between checks for shutdown
+
+/*
+ * Sleep until the capture time of the next datagram, scaled by the replay speed, has come.
+ * Returns false when the thread should stop.
+ */
+bool ReplayReceive::WaitForCaptureTime(wxLongLong start, wxLongLong elapsed_capture) {
+  if (m_speed <= 0.) {
+    return !m_shutdown;
+  }
+
+  wxLongLong due = start + wxLongLong((wxLongLong_t)(elapsed_capture.ToDouble() / 1000. / m_speed));
+  while (!m_shutdown) {
+    wxLongLong wait = due - wxGetUTCTimeMillis();
+    if (wait <= 0) {
+      return true;
+    }
+    wxMilliSleep((unsigned long)wxMin(wait.GetValue(), (wxLongLong_t)MILLIS_PER_SLEEP));
+  }
+  return false;
+}
+
+/*
+ * Entry
+ *
+ * Called by wxThread when the new thread is running.
+ * It should remain running until Shutdown is called.
+ */
+void *ReplayReceive::Entry(void) {
+  NetworkAddress fake(127, 0, 0, 10, 3333);
+  PcapReader reader;
+  PcapDatagram datagram;
+
+  LOG_VERBOSE(wxT("radar_pi: ReplayReceive thread %s starting"), m_ri->m_name.c_str());
+
+  if (!m_target) {
+    SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Replay not supported for this radar type")));
+  } else if (!reader.Open(m_filename)) {
+    SetInfoStatus(wxString::Format(wxT("%s: %s %s"), m_ri->m_name.c_str(), _("Cannot replay"), m_filename.c_str()));
+  } else {
+    m_ri->DetectedRadar(fake, fake);  // Same as the emulator, commands go nowhere
+    SetInfoStatus(wxString::Format(wxT("%s: %s %s"), m_ri->m_name.c_str(), _("Replaying"), m_filename.c_str()));
+
+    wxLongLong start = wxGetUTCTimeMillis();
+    wxLongLong first_capture = 0;
+    wxLongLong last_capture = 0;
+    size_t processed = 0;
+    size_t ignored = 0;
+    size_t bytes = 0;
+
+    while (reader.ReadDatagram(&datagram)) {
+      if (first_capture == 0) {
+        first_capture = datagram.time;
+      }
+      last_capture = datagram.time;
+      if (!WaitForCaptureTime(start, datagram.time - first_capture)) {
+        break;
+      }
+      if (m_target->ProcessReplayPacket(datagram.src, datagram.dst, datagram.data, datagram.len)) {
+        processed++;
+        bytes += datagram.len;
+      } else {
+        ignored++;
+      }
+    }
+
+    wxLongLong elapsed = wxGetUTCTimeMillis() - start;
+    double seconds = wxMax(elapsed.ToDouble(), 1.) / MILLISECONDS_PER_SECOND;
+    LOG_INFO(wxT("radar_pi: %s replayed %u datagrams (%u ignored, %u dropped fragments) of %.1f s capture in %.1f s: ")
+                 wxT("%.0f datagrams/s, %.1f MB/s"),
+             m_ri->m_name.c_str(), (unsigned int)processed, (unsigned int)ignored, (unsigned int)reader.m_dropped_fragments,
+             (last_capture - first_capture).ToDouble() / 1000000., seconds, processed / seconds, bytes / seconds / 1000000.);
+    SetInfoStatus(wxString::Format(wxT("%s: %s %s"), m_ri->m_name.c_str(), _("Replay finished"), m_filename.c_str()));
+  }
+
+  while (!m_shutdown) {
+    wxMilliSleep(MILLIS_PER_SLEEP);
+  }
+
+  LOG_VERBOSE(wxT("radar_pi: %s replay thread stopping"), m_ri->m_name.c_str());
+  m_is_shutdown = true;
+  return 0;
+}
+
+// Called from the main thread to stop this thread.
+// The thread sleeps for at most MILLIS_PER_SLEEP, so it will notice quickly.
+
+void ReplayReceive::Shutdown() {
+  m_shutdown_time_requested = wxGetUTCTimeMillis();
+  m_shutdown = true;
+  LOG_VERBOSE(wxT("radar_pi: %s requested replay thread to stop"), m_ri->m_name.c_str());
+}
+
+wxString ReplayReceive::GetInfoStatus() {
+  wxCriticalSectionLocker lock(m_lock);
+
+  return m_status;
+}
+
+PLUGIN_END_NAMESPACE
@@ -0,0 +1,96 @@
+/******************************************************************************
+ *
+ * Project:  OpenCPN
+ * Purpose:  Radar Plugin
+ * Author:   David Register
+ *           Dave Cowell
+ *           Kees Verruijt
+ *           Douwe Fokkema
+ *           Sean D'Epagnier
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register              bdbcat@yahoo.com *
+ *   Copyright (C) 2012-2013 by Dave Cowell                                *
+ *   Copyright (C) 2012-2016 by Kees Verruijt         canboat@verruijt.net *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ */
+
+#ifndef _REPLAYRECEIVE_H_
+#define _REPLAYRECEIVE_H_
+
+#include "RadarReceive.h"
+#include "socketutil.h"
+
+PLUGIN_BEGIN_NAMESPACE
+
+//
+// Replays a recorded network capture (see example/*.pcap.gz) through the receive
+// class of the configured radar type, and from there through RadarInfo::ProcessRadarSpoke.
+//
+// It is selected by setting the 'secret' Radar<n>ReplayFile key in the ini file.
+// ReplaySpeed sets the pace: 1 = original speed, N = N times faster, 0 = as fast as possible.
+//
+// The wrapped receive thread is never started, so no network sockets are opened.
+//
+
+class ReplayReceive : public RadarReceive {
+ public:
+  ReplayReceive(radar_pi *pi, RadarInfo *ri, RadarReceive *target, wxString filename, double speed) : RadarReceive(pi, ri) {
+    m_target = target;
+    m_filename = filename;
+    m_speed = speed;
+    m_shutdown = false;
+    m_is_shutdown = false;
+    m_shutdown_time_requested = 0;
+    SetInfoStatus(wxString::Format(wxT("%s: %s"), m_ri->m_name.c_str(), _("Initializing")));
+    LOG_RECEIVE(wxT("radar_pi: %s replay thread created for %s"), m_ri->m_name.c_str(), m_filename.c_str());
+  };
+
+  ~ReplayReceive() {
+    if (m_target) {
+      m_target->Delete();  // Releases the thread created but never run
+      delete m_target;
+    }
+  }
+
+  void *Entry(void);
+  void Shutdown(void);
+  wxString GetInfoStatus();
+
+  wxLongLong m_shutdown_time_requested;  // Main thread asks this thread to stop
+  volatile bool m_is_shutdown;
+
+ private:
+  bool WaitForCaptureTime(wxLongLong start, wxLongLong elapsed_capture);
+
+  RadarReceive *m_target;  // Receive object that understands the radar protocol in the capture
+  wxString m_filename;
+  double m_speed;
+  volatile bool m_shutdown;
+
+  wxCriticalSection m_lock;  // Protects m_status
+  wxString m_status;         // Userfriendly string
+
+  void SetInfoStatus(wxString status) {
+    wxCriticalSectionLocker lock(m_lock);
+    m_status = status;
+  }
+};
+
+PLUGIN_END_NAMESPACE
+
+#endif /* _REPLAYRECEIVE_H_ */
@@ -34,14 +34,18 @@
 
 #if defined(WIN32)
 #define SET_FUNCTION_POINTER(name) wglGetProcAddress(name)
+#define CURRENT_CONTEXT() ((void *)wglGetCurrentContext())
 typedef PROC FunctionPointer;
 #elif defined(__WXOSX__)
+#include <OpenGL/OpenGL.h>
 #include <dlfcn.h>
 #define SET_FUNCTION_POINTER(name) dlsym(RTLD_DEFAULT, name)
+#define CURRENT_CONTEXT() ((void *)CGLGetCurrentContext())
 typedef void *FunctionPointer;
 #else
 #include <GL/glx.h>
 #define SET_FUNCTION_POINTER(name) glXGetProcAddress((const GLubyte *)name)
+#define CURRENT_CONTEXT() ((void *)glXGetCurrentContext())
 typedef __GLXextFuncPtr FunctionPointer;
 #endif
 
@@ -70,6 +74,8 @@ GLboolean ShadersSupported(void) {
   return ok;
 }
 
+void *GetCurrentGLContext(void) { return CURRENT_CONTEXT(); }
+
 bool CompileShaderText(GLuint *shader, GLenum shaderType, const char *text) {
   GLint stat;
 
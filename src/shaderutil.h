@@ -25,6 +25,9 @@ struct attrib_info {
 
 extern GLboolean ShadersSupported(void);
 
+/* Identifies the OpenGL context that is current in this thread, 0 when unknown. */
+extern void *GetCurrentGLContext(void);
+
 extern bool CompileShaderText(GLuint *shader, GLenum shaderType, const char *text);
 
 extern GLuint LinkShaders(GLuint vertShader, GLuint fragShader);